@@ -210,6 +210,112 @@ int32_t I2c::read_(void* buf, uint32_t len)
     return ret == ESP_OK ? len : -1;
 }
 
+int32_t I2c::writev_(const WriteVec* vec, uint32_t count)
+{
+#if (ESP_IDF_VERSION_MAJOR == 5) && (ESP_IDF_VERSION_MINOR < 3)
+    // Transmit of multiple buffers is supported since IDF 5.3
+    return ::I2c::writev_(vec, count);
+#else
+    // Take address from parent first if exists
+    int32_t addr = getAddr() >= 0 ? (getAddr() << 1) : -1;
+    if (!isOpen() || addr < 0)
+        return -1;
+
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        assert(vec[i].buf != nullptr);
+        len += vec[i].len;
+    }
+
+#if (ESP_IDF_VERSION_MAJOR == 5)
+    // Buffers list is on stack, more segments are gathered by base class
+    if (count > SERIALDRV_WRITEV_MAX)
+        return ::I2c::writev_(vec, count);
+
+    i2c_master_device_change_address(dev_, getAddr(), timeoutMs);
+
+    // Register is sent as the first buffer of the same transfer
+    uint8_t reg = getReg();
+    i2c_master_transmit_multi_buffer_info_t bufs[SERIALDRV_WRITEV_MAX + 1];
+    uint32_t bufCount = 0;
+    if (getReg() >= 0) {
+        bufs[bufCount].write_buffer = &reg;
+        bufs[bufCount++].buffer_size = 1;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        bufs[bufCount].write_buffer = static_cast<uint8_t*>(const_cast<void*>(vec[i].buf));
+        bufs[bufCount++].buffer_size = vec[i].len;
+    }
+    esp_err_t ret = i2c_master_multi_buffer_transmit(dev_, bufs, bufCount, timeoutMs);
+#else
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr | I2C_MASTER_WRITE, true);
+    if (getReg() >= 0)
+        i2c_master_write_byte(cmd, getReg(), true);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (vec[i].len != 0)
+            i2c_master_write(cmd, static_cast<const uint8_t*>(vec[i].buf), vec[i].len, true);
+    }
+    i2c_master_stop(cmd);
+    esp_err_t ret = i2c_master_cmd_begin(config_.i2c, cmd, timeoutMs);
+    i2c_cmd_link_delete(cmd);
+#endif
+    return ret == ESP_OK ? len : -1;
+#endif
+}
+
+int32_t I2c::readv_(const ReadVec* vec, uint32_t count)
+{
+#if (ESP_IDF_VERSION_MAJOR == 5)
+    // Master driver of IDF 5 receives into single buffer only
+    return ::I2c::readv_(vec, count);
+#else
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        assert(vec[i].buf != nullptr);
+        len += vec[i].len;
+    }
+
+    // Take address from parent first if exists
+    int32_t addr = getAddr() >= 0 ? (getAddr() << 1) : -1;
+    if (!isOpen() || addr < 0 || len == 0)
+        return -1;
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    // Without register just read data as is
+    if (getReg() >= 0) {
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, addr | I2C_MASTER_WRITE, true);
+        i2c_master_write_byte(cmd, getReg(), true);
+    }
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr | I2C_MASTER_READ, true);
+
+    // Only the last byte of transfer is not acknowledged
+    uint32_t rest = len;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t* bytes = static_cast<uint8_t*>(vec[i].buf);
+        const uint32_t segLen = vec[i].len;
+        if (segLen == 0)
+            continue;
+
+        rest -= segLen;
+        if (rest != 0) {
+            i2c_master_read(cmd, bytes, segLen, I2C_MASTER_ACK);
+        } else {
+            if (segLen > 1)
+                i2c_master_read(cmd, bytes, segLen - 1, I2C_MASTER_ACK);
+            i2c_master_read_byte(cmd, &bytes[segLen - 1], I2C_MASTER_NACK);
+        }
+    }
+    i2c_master_stop(cmd);
+    esp_err_t ret = i2c_master_cmd_begin(config_.i2c, cmd, timeoutMs);
+    i2c_cmd_link_delete(cmd);
+    return ret == ESP_OK ? len : -1;
+#endif
+}
+
 bool I2c::ioctl(uint32_t cmd, void* pValue)
 {
     if (!isOpen())
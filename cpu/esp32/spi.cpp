@@ -6,8 +6,11 @@
 
 #include "esp32/spi.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
 
 #include <cassert>
+#include <cstring>
 
 namespace esp32 {
 
@@ -19,6 +22,7 @@ static bool checkConfig(const esp32::SpiConfig* config)
 
 P_Spi::P_Spi(ISpiQueue& rx)
     : rxQueue_(rx)
+    , pool_ {}
 {
 }
 
@@ -60,11 +64,26 @@ bool P_Spi::open()
         .intr_flags = 0,
     };
 
+    // Pool buffers are allocated once, each descriptor has own pair
+    poolBuf_ = static_cast<uint8_t*>(heap_caps_malloc(SPI_QUEUE_SIZE * SPI_POOL_BUF_SIZE * 2,
+        MALLOC_CAP_DMA));
+    if (poolBuf_ == nullptr)
+        return false;
+    for (uint32_t i = 0; i < SPI_QUEUE_SIZE; ++i) {
+        pool_[i] = {};
+        pool_[i].txBuf = &poolBuf_[i * SPI_POOL_BUF_SIZE * 2];
+        pool_[i].rxBuf = &poolBuf_[i * SPI_POOL_BUF_SIZE * 2 + SPI_POOL_BUF_SIZE];
+    }
+    inFlight_ = 0;
+
+    // Chip select of queued transaction is set by driver callbacks
     spi_device_interface_config_t devcfg = {};
     devcfg.mode = static_cast<uint8_t>(config_.polarity);
     devcfg.clock_speed_hz = config_.speed;
     devcfg.spics_io_num = GPIO_NUM_NC;
-    devcfg.queue_size = 1;
+    devcfg.queue_size = SPI_QUEUE_SIZE;
+    devcfg.pre_cb = preTrans;
+    devcfg.post_cb = postTrans;
 
     spi_bus_initialize(config_.spi, &buscfg, SPI_DMA_CH_AUTO);
     spi_bus_add_device(config_.spi, &devcfg, &spi_);
@@ -76,9 +95,12 @@ bool P_Spi::open()
 void P_Spi::close()
 {
     if (isOpen()) {
+        flushQueue();
         spi_bus_remove_device(spi_);
         spi_bus_free(config_.spi);
         spi_ = nullptr;
+        heap_caps_free(poolBuf_);
+        poolBuf_ = nullptr;
         setOpened(false);
     }
 }
@@ -92,6 +114,9 @@ int32_t P_Spi::write_(const void* buf, uint32_t len)
 
     const int32_t reg = getReg();
 
+    // Queued transactions of other devices finish before chip select
+    flushQueue();
+
     // Set chip select
     if (cs_)
         cs_->reset();
@@ -141,6 +166,86 @@ int32_t P_Spi::read_(void* buf, uint32_t len)
     return size;
 }
 
+int32_t P_Spi::writev_(const WriteVec* vec, uint32_t count)
+{
+    if (!isOpen())
+        return -1;
+
+    const int32_t reg = getReg();
+
+    // Queued transactions of other devices finish before chip select
+    flushQueue();
+
+    // Segments are sent by own transactions under single chip select
+    if (cs_)
+        cs_->reset();
+
+    if (reg >= 0) {
+        readWrite(&reg, 1, false);
+    }
+
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        assert(vec[i].buf != nullptr);
+        if (vec[i].len != 0)
+            readWrite(vec[i].buf, vec[i].len);
+        len += vec[i].len;
+    }
+
+    if (cs_)
+        cs_->set();
+
+    return len;
+}
+
+int32_t P_Spi::readv_(const ReadVec* vec, uint32_t count)
+{
+    if (!isOpen())
+        return -1;
+
+    // Received frames are taken from queue segment by segment
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (vec[i].len == 0)
+            continue;
+        const int32_t readed = read_(vec[i].buf, vec[i].len);
+        if (readed <= 0)
+            break;
+        size += readed;
+        if (static_cast<uint32_t>(readed) < vec[i].len)
+            break;
+    }
+    return size;
+}
+
+int32_t P_Spi::transfer_(const void* tx, void* rx, uint32_t len, uint32_t width, Gpio* cs)
+{
+    const size_t frameLen = static_cast<size_t>(config_.frame);
+    if (!isOpen() || len == 0 || width * 8 != frameLen)
+        return -1;
+
+    // Blocking transaction can't be mixed with queued ones, they finish
+    // before chip select, so only one device is selected on bus
+    flushQueue();
+
+    // Device chip select is set for this transfer only
+    Gpio* pin = cs != nullptr ? cs : cs_;
+    if (pin)
+        pin->reset();
+
+    // Received data lands directly into caller buffer
+    spi_transaction_t t = {};
+    t.length = frameLen * len;
+    t.tx_buffer = tx;
+    t.rx_buffer = config_.miso != GPIO_NUM_NC ? rx : NULL;
+    esp_err_t ret = spi_device_transmit(spi_, &t);
+
+    if (pin)
+        pin->set();
+
+    return ret == ESP_OK ? len : -1;
+}
+
 bool P_Spi::ioctl(uint32_t cmd, void* pValue)
 {
     if (!isOpen())
@@ -165,38 +270,207 @@ bool P_Spi::ioctl(uint32_t cmd, void* pValue)
 
 void P_Spi::readWrite(const void* txBuf, uint32_t len, bool save)
 {
-    const size_t frameLen = static_cast<size_t>(config_.frame);
-    const size_t transLen = frameLen * len;
+    const size_t frameBytes = static_cast<size_t>(config_.frame) >> 3;
     const bool misoStageNeeded = save && config_.miso != GPIO_NUM_NC;
-    uint8_t rxBuf[transLen >> 3];
-
-    spi_transaction_t t = {};
-    t.length = transLen;
-    t.tx_buffer = txBuf;
-    t.rx_buffer = misoStageNeeded ? rxBuf : NULL;
-    esp_err_t ret = spi_device_transmit(spi_, &t);
+    const uint8_t* tx = static_cast<const uint8_t*>(txBuf);
+
+    // Blocking transaction can't be mixed with queued ones, so the first
+    // pool buffer is free for reception by chunks. Callers flush queue
+    // before chip select, so here it is already empty
+    flushQueue();
+    const uint32_t chunkMax = SPI_POOL_BUF_SIZE / frameBytes;
+    const uint8_t* rxBuf = pool_[0].rxBuf;
+
+    while (len != 0) {
+        const uint32_t chunk = len < chunkMax ? len : chunkMax;
+        spi_transaction_t t = {};
+        t.length = chunk * frameBytes * 8;
+        t.tx_buffer = tx;
+        t.rx_buffer = misoStageNeeded ? pool_[0].rxBuf : NULL;
+        esp_err_t ret = spi_device_transmit(spi_, &t);
+        if (ret != ESP_OK)
+            break;
 
-    if (ret == ESP_OK && misoStageNeeded) {
-        for (uint32_t i = 0; i < len; ++i) {
+        for (uint32_t i = 0; misoStageNeeded && i < chunk; ++i) {
             if (rxQueue_.full())
                 break;
 
             switch (config_.frame) {
             default:
             case SpiFrame::Frame8Bit:
-                rxQueue_.push(static_cast<const uint8_t*>(t.rx_buffer)[i]);
+                rxQueue_.push(rxBuf[i]);
                 break;
 
             case SpiFrame::Frame16Bit:
-                rxQueue_.push(static_cast<const uint16_t*>(t.rx_buffer)[i]);
+                rxQueue_.push(reinterpret_cast<const uint16_t*>(rxBuf)[i]);
                 break;
 
             case SpiFrame::Frame32Bit:
-                rxQueue_.push(static_cast<const uint32_t*>(t.rx_buffer)[i]);
+                rxQueue_.push(reinterpret_cast<const uint32_t*>(rxBuf)[i]);
                 break;
             }
         }
+        tx += chunk * frameBytes;
+        len -= chunk;
+    }
+}
+
+/**
+ * @brief Queues full-duplex transaction without waiting for its completion.
+ *      Short data is copied into pool buffers, so caller buffers can be
+ *      reused at once. Longer data is sent and received from caller buffers
+ *      which must be valid and DMA-capable until completion
+ *
+ * @param tx frames to send, nullptr for dummy frames: 0xFF.. when data fits
+ *      into pool buffer, longer transaction is sent without TX buffer, so
+ *      MOSI level is left to ESP-IDF driver
+ * @param rx buffer for received frames, nullptr to drop them
+ * @param len frames count
+ * @param cs chip select of device, nullptr to use the one set by kSetCs
+ * @return true if queued otherwise false when pool is exhausted
+ */
+bool P_Spi::queue(const void* tx, void* rx, uint32_t len, Gpio* cs)
+{
+    if (!isOpen() || len == 0)
+        return false;
+
+    if (!lock())
+        return false;
+    SpiTrans* trans = nullptr;
+    for (SpiTrans& item : pool_) {
+        if (!item.busy) {
+            trans = &item;
+            break;
+        }
+    }
+    if (trans == nullptr) {
+        unlock();
+        return false;
+    }
+
+    const size_t bytes = len * (static_cast<size_t>(config_.frame) >> 3);
+    trans->bounce = bytes <= SPI_POOL_BUF_SIZE;
+    trans->cs = cs != nullptr ? cs : cs_;
+    trans->rx = rx;
+    trans->len = len;
+
+    const bool receive = rx != nullptr && config_.miso != GPIO_NUM_NC;
+    trans->t = {};
+    trans->t.length = bytes * 8;
+    trans->t.user = trans;
+    if (trans->bounce) {
+        if (tx != nullptr)
+            memcpy(trans->txBuf, tx, bytes);
+        else
+            memset(trans->txBuf, 0xFF, bytes);
+        trans->t.tx_buffer = trans->txBuf;
+        trans->t.rx_buffer = receive ? trans->rxBuf : NULL;
+    } else {
+        trans->t.tx_buffer = tx;
+        trans->t.rx_buffer = receive ? rx : NULL;
+    }
+
+    const bool queued = spi_device_queue_trans(spi_, &trans->t, 0) == ESP_OK;
+    if (queued) {
+        trans->busy = true;
+        ++inFlight_;
     }
+    unlock();
+    return queued;
+}
+
+/**
+ * @brief Completes finished queued transactions in order of queueing. Data
+ *      from pool buffers is copied into caller buffers and queue delegate is
+ *      called for each transaction
+ *
+ * @param timeoutMs time to wait for the first completion
+ * @return uint32_t completed transactions count
+ */
+uint32_t P_Spi::poll(uint32_t timeoutMs)
+{
+    if (!lock())
+        return 0;
+    const uint32_t done = collect(pdMS_TO_TICKS(timeoutMs));
+    unlock();
+    return done;
+}
+
+/**
+ * @brief Returns count of queued and not completed transactions
+ *
+ * @return uint32_t transactions count
+ */
+uint32_t P_Spi::inFlight() const
+{
+    return inFlight_;
+}
+
+/**
+ * @brief Sets the callback for completed queued transaction
+ *
+ * @param queueCb callback delegate
+ */
+void P_Spi::setQueueDelegate(const QueueDelegate& queueCb)
+{
+    queueCb_ = queueCb;
+}
+
+/**
+ * @brief Takes results of finished transactions and releases descriptors
+ *
+ * @param wait ticks to wait for the first result
+ * @return uint32_t completed transactions count
+ */
+uint32_t P_Spi::collect(TickType_t wait)
+{
+    uint32_t done = 0;
+    spi_transaction_t* t = nullptr;
+    while (inFlight_ != 0
+        && spi_device_get_trans_result(spi_, &t, done == 0 ? wait : 0) == ESP_OK) {
+        SpiTrans* trans = static_cast<SpiTrans*>(t->user);
+        if (trans->bounce && t->rx_buffer != NULL)
+            memcpy(trans->rx, trans->rxBuf, t->length >> 3);
+        trans->busy = false;
+        --inFlight_;
+        ++done;
+        queueCb_.call_if(trans->rx, static_cast<int32_t>(trans->len));
+    }
+    return done;
+}
+
+/**
+ * @brief Waits for completion of all queued transactions
+ */
+void P_Spi::flushQueue()
+{
+    while (inFlight_ != 0) {
+        collect(portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief Sets chip select of queued transaction. Called by driver from IRQ
+ *
+ * @param t transaction
+ */
+void IRAM_ATTR P_Spi::preTrans(spi_transaction_t* t)
+{
+    const SpiTrans* trans = static_cast<const SpiTrans*>(t->user);
+    if (trans != nullptr && trans->cs != nullptr)
+        trans->cs->reset();
+}
+
+/**
+ * @brief Resets chip select of queued transaction. Called by driver from IRQ
+ *
+ * @param t transaction
+ */
+void IRAM_ATTR P_Spi::postTrans(spi_transaction_t* t)
+{
+    const SpiTrans* trans = static_cast<const SpiTrans*>(t->user);
+    if (trans != nullptr && trans->cs != nullptr)
+        trans->cs->set();
 }
 
 }; // namespace esp32
@@ -8,10 +8,19 @@
 
 #include "periph/spi.h"
 #include "periph/gpio.h"
+#include "etl/delegate.h"
 #include "etl/queue.h"
 
 #include "driver/spi_master.h"
 
+#ifndef SPI_QUEUE_SIZE
+#define SPI_QUEUE_SIZE 4
+#endif
+
+#ifndef SPI_POOL_BUF_SIZE
+#define SPI_POOL_BUF_SIZE 64
+#endif
+
 namespace esp32 {
 
 struct SpiConfig {
@@ -25,11 +34,23 @@ struct SpiConfig {
     int miso;
 };
 
-/// @brief Private realization of ESP32 SPI bus peripheral driver
+/**
+ * @brief Private realization of ESP32 SPI bus peripheral driver. Besides
+ *      blocking calls transactions can be queued into driver, up to
+ *      SPI_QUEUE_SIZE of them are in flight. Descriptors and DMA-capable
+ *      bounce buffers of SPI_POOL_BUF_SIZE bytes are taken from fixed pool
+ *      allocated on open, longer transactions use caller buffers directly
+ */
 class P_Spi : public ::Spi {
 public:
     using ISpiQueue = etl::iqueue<uint32_t, etl::memory_model::MEMORY_MODEL_MEDIUM>;
 
+    /**
+     * @brief Callback for completed queued transaction with caller receive
+     *      buffer and transferred frames count
+     */
+    using QueueDelegate = etl::delegate<void(void*, int32_t)>;
+
     P_Spi(ISpiQueue& rx);
 
     bool setConfig(const void* drvConfig) override;
@@ -38,16 +59,47 @@ public:
 
     bool ioctl(uint32_t cmd, void* pValue) override;
 
+    bool queue(const void* tx, void* rx, uint32_t len, Gpio* cs = nullptr);
+    uint32_t poll(uint32_t timeoutMs = 0);
+    uint32_t inFlight() const;
+    void setQueueDelegate(const QueueDelegate& queueCb);
+
 private:
     int32_t write_(const void* buf, uint32_t len) override;
     int32_t read_(void* buf, uint32_t len) override;
+    int32_t writev_(const WriteVec* vec, uint32_t count) override;
+    int32_t readv_(const ReadVec* vec, uint32_t count) override;
+    int32_t transfer_(const void* tx, void* rx, uint32_t len, uint32_t width, Gpio* cs) override;
 
     void readWrite(const void* txBuf, uint32_t len, bool save = true);
 
+    /// @brief Queued transaction descriptor from pool
+    struct SpiTrans {
+        spi_transaction_t t;
+        Gpio* cs;
+        void* rx;       // Caller buffer for received frames
+        uint8_t* txBuf; // DMA-capable bounce buffers of pool
+        uint8_t* rxBuf;
+        uint32_t len;
+        bool bounce;
+        bool busy;
+    };
+
+    uint32_t collect(TickType_t wait);
+    void flushQueue();
+
+    static void preTrans(spi_transaction_t* t);
+    static void postTrans(spi_transaction_t* t);
+
     SpiConfig config_;
     spi_device_handle_t spi_;
     ISpiQueue& rxQueue_;
     Gpio *cs_ = nullptr;
+
+    SpiTrans pool_[SPI_QUEUE_SIZE];
+    uint8_t* poolBuf_ = nullptr;
+    uint32_t inFlight_ = 0;
+    QueueDelegate queueCb_;
 };
 
 /// @brief ESP32 SPI bus peripheral driver
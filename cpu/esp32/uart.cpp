@@ -94,6 +94,45 @@ int32_t Uart::read_(void* buf, uint32_t len)
     return uart_read_bytes(config_.uart, buf, len, 0);
 }
 
+int32_t Uart::writev_(const WriteVec* vec, uint32_t count)
+{
+    if (!isOpen())
+        return -1;
+
+    // Driver copies segments into own ring buffer one after another
+    int32_t size = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        assert(vec[i].buf != nullptr);
+        if (vec[i].len == 0)
+            continue;
+        const int res = uart_write_bytes(config_.uart, vec[i].buf, vec[i].len);
+        if (res < 0)
+            return size != 0 ? size : -1;
+        size += res;
+    }
+    return size;
+}
+
+int32_t Uart::readv_(const ReadVec* vec, uint32_t count)
+{
+    if (!isOpen())
+        return -1;
+
+    int32_t size = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        assert(vec[i].buf != nullptr);
+        if (vec[i].len == 0)
+            continue;
+        const int res = uart_read_bytes(config_.uart, vec[i].buf, vec[i].len, 0);
+        if (res < 0)
+            return size != 0 ? size : -1;
+        size += res;
+        if (static_cast<uint32_t>(res) < vec[i].len)
+            break;
+    }
+    return size;
+}
+
 bool Uart::ioctl(uint32_t cmd, void* pValue)
 {
     if (!isOpen())
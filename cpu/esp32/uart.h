@@ -34,6 +34,8 @@ public:
 private:
     int32_t write_(const void* buf, uint32_t len) override;
     int32_t read_(void* buf, uint32_t len) override;
+    int32_t writev_(const WriteVec* vec, uint32_t count) override;
+    int32_t readv_(const ReadVec* vec, uint32_t count) override;
 
     UartConfig config_;
 };
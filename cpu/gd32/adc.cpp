@@ -5,25 +5,32 @@
  ******************************************************************************/
 
 #include "gd32/adc.h"
+#include "timing.h"
 
 #include <cassert>
 
 namespace gd32 {
 
 #define ADC_COUNT 3
-#define ADC_CH_COUNT (ADC_CHANNEL_18 + 1)
 
 struct AdcState {
     uint32_t adc;
     bool configured;
     uint8_t count;
+    bool scan;          // Whole ADC is owned by scan group
 };
 
 /// @brief ADC state instances pointers table for configure control
 static AdcState adcStates[ADC_COUNT] = { };
 
-/// @brief ADC instances pointers table for IRQ usage
-static Adc* adcInstances[ADC_CH_COUNT] = { nullptr };
+/// @brief Instances with started conversion of each ADC for IRQ usage
+static Adc* adcActive[ADC_COUNT] = { nullptr };
+
+/// @brief Bits of ADCs with started conversion, IRQ visits only them
+static volatile uint32_t adcActiveMask = 0;
+
+/// @brief Count of opened drivers using IRQ
+static uint32_t adcIrqUsers = 0;
 
 /**
  * @brief Check ADC configuration validity
@@ -42,18 +49,56 @@ static bool checkConfig(const gd32::AdcConfig* config)
 }
 
 /**
- * @brief Sets ADC pointer to instances table according to chosen ADC
+ * @brief Returns index of ADC in tables
+ *
+ * @param adc ADC periph
+ * @return uint32_t ADC index
+ */
+static uint32_t adcIndex(uint32_t adc)
+{
+    switch (adc) {
+    case ADC1: return 1;
+#if defined(GD32F4XX_H)
+    case ADC2: return 2;
+#endif
+    default: return 0;
+    }
+}
+
+/**
+ * @brief Returns ADC periph by its index in tables
  *
- * @param channel ADC channel
- * @param arg ADC instance pointer
+ * @param index ADC index
+ * @return uint32_t ADC periph
  */
-static void setHandler(uint32_t channel, Adc* arg)
+static uint32_t adcPeriph(uint32_t index)
 {
-    if (channel < ADC_CH_COUNT) {
-        adcInstances[channel] = arg;
+    switch (index) {
+    case 1: return ADC1;
+#if defined(GD32F4XX_H)
+    case 2: return ADC2;
+#endif
+    default: return ADC0;
     }
 }
 
+/**
+ * @brief Sets instance with started conversion of ADC. Called with ADC
+ *      interrupt disabled, so table is consistent for IRQ
+ *
+ * @param adc ADC periph
+ * @param arg ADC instance pointer, nullptr when conversion is stopped
+ */
+static void setActive(uint32_t adc, Adc* arg)
+{
+    const uint32_t index = adcIndex(adc);
+    adcActive[index] = arg;
+    if (arg != nullptr)
+        adcActiveMask |= 1U << index;
+    else
+        adcActiveMask &= ~(1U << index);
+}
+
 /**
  * @brief Enables ADC clock according to chosen periph
  *
@@ -71,7 +116,7 @@ static void enableClock(uint32_t adc)
         break;
 #if defined(GD32F4XX_H)
     case ADC2:
-        portClk = RCU_ADC1;
+        portClk = RCU_ADC2;
         break;
 #endif
     default:
@@ -80,6 +125,24 @@ static void enableClock(uint32_t adc)
     rcu_periph_clock_enable(portClk);
 }
 
+#if defined(GD32F4XX_H)
+/**
+ * @brief Checks that some other ADC is configured. Clock prescaler and sync
+ *      mode are common for all ADCs, they are set only by the first one
+ *
+ * @param adc ADC periph
+ * @return true if other ADC is configured otherwise false
+ */
+static bool otherConfigured(uint32_t adc)
+{
+    for (int i = 0; i < ADC_COUNT; ++i) {
+        if (adcStates[i].adc != 0 && adcStates[i].adc != adc && adcStates[i].configured)
+            return true;
+    }
+    return false;
+}
+#endif
+
 /**
  * @brief Sets IRQ new state according to chosen ADC
  *
@@ -105,11 +168,12 @@ static void setIrq(bool state)
  * @brief Performs ADC peripheral initialization
  *
  * @param config driver configuration
+ * @return true if ADC initialized otherwise false
  */
-static void initAdcPeriph(const gd32::AdcConfig* config)
+static bool initAdcPeriph(const gd32::AdcConfig* config)
 {
     if (config->adc == 0)
-        return;
+        return false;
 
     // Find existing configuration
     AdcState* adcState = nullptr;
@@ -118,6 +182,8 @@ static void initAdcPeriph(const gd32::AdcConfig* config)
             adcState = &adcStates[i];
         }
     }
+    if (adcState && adcState->scan)
+        return false;
 
     // If not found already configured - take first empty
     if (!adcState) {
@@ -130,6 +196,7 @@ static void initAdcPeriph(const gd32::AdcConfig* config)
         adcState->adc = config->adc;
         adcState->configured = false;
         adcState->count = 1;
+        adcState->scan = false;
     }
 
     // Configure ADC itself
@@ -138,32 +205,32 @@ static void initAdcPeriph(const gd32::AdcConfig* config)
         enableClock(config->adc);
 
 #if defined(GD32F4XX_H)
-        adc_clock_config(static_cast<uint32_t>(config->prescaler));
-        adc_deinit();
+        // Global reset of ADCs would stop other ADCs and scan groups, so
+        // only this ADC is disabled and reconfigured
+        if (!otherConfigured(config->adc)) {
+            adc_clock_config(static_cast<uint32_t>(config->prescaler));
+            adc_sync_mode_config(ADC_SYNC_MODE_INDEPENDENT);
+        }
+        adc_disable(config->adc);
+        adc_dma_mode_disable(config->adc);
         adc_resolution_config(config->adc, config->resolution);
         switch (config->mode) {
         case AdcMode::OneShoot:
-            adc_sync_mode_config(ADC_SYNC_MODE_INDEPENDENT);
             adc_special_function_config(config->adc, ADC_CONTINUOUS_MODE, DISABLE);
             adc_special_function_config(config->adc, ADC_SCAN_MODE, DISABLE);
             adc_data_alignment_config(config->adc, ADC_DATAALIGN_RIGHT);
 
             adc_external_trigger_source_config(config->adc, ADC_ROUTINE_CHANNEL, ADC_EXTTRIG_ROUTINE_T0_CH0);
             adc_external_trigger_config(config->adc, ADC_ROUTINE_CHANNEL, EXTERNAL_TRIGGER_DISABLE);
-            if (config->useIrq)
-                adc_interrupt_enable(config->adc, ADC_INT_EOC);
             break;
 
         case AdcMode::Continuous:
-            adc_sync_mode_config(ADC_SYNC_MODE_INDEPENDENT);
             adc_special_function_config(config->adc, ADC_CONTINUOUS_MODE, ENABLE);
             adc_special_function_config(config->adc, ADC_SCAN_MODE, DISABLE);
             adc_data_alignment_config(config->adc, ADC_DATAALIGN_RIGHT);
 
             adc_external_trigger_source_config(config->adc, ADC_ROUTINE_CHANNEL, ADC_EXTTRIG_ROUTINE_T0_CH0);
             adc_external_trigger_config(config->adc, ADC_ROUTINE_CHANNEL, EXTERNAL_TRIGGER_DISABLE);
-            if (config->useIrq)
-                adc_interrupt_enable(config->adc, ADC_INT_EOC);
             break;
 
         default:
@@ -180,6 +247,7 @@ static void initAdcPeriph(const gd32::AdcConfig* config)
     adc_channel_length_config(config->adc, ADC_ROUTINE_CHANNEL, 1);
     adc_routine_channel_config(config->adc, 0, config->channel, config->sampleTime);
 #endif
+    return true;
 }
 
 /**
@@ -214,11 +282,10 @@ static void deinitAdcPeriph(const gd32::AdcConfig* config)
             adcState->adc = 0;
             adcState->configured = false;
 
-            // Deinit ADC
+            // Disable only this ADC, others may still convert
             if (config->useIrq)
-                adc_interrupt_enable(config->adc, ADC_INT_EOC);
+                adc_interrupt_disable(config->adc, ADC_INT_EOC);
             adc_disable(config->adc);
-            adc_deinit();
         }
     }
 }
@@ -252,9 +319,10 @@ bool Adc::open()
     if (isOpen() && !checkConfig(&config_))
         return false;
 
+    if (!initAdcPeriph(&config_))
+        return false;
     initGpioPeriph(&config_.gpioConfig);
-    initAdcPeriph(&config_);
-    if (config_.useIrq)
+    if (config_.useIrq && adcIrqUsers++ == 0)
         setIrq(true);
     setOpened(true);
 
@@ -271,19 +339,12 @@ void Adc::close()
     if (!isOpen())
         return;
 
+    if (started_)
+        stop();
     deinitGpioPeriph(&config_.gpioConfig);
     deinitAdcPeriph(&config_);
-    setHandler(config_.channel, nullptr);
-    bool chLeft = false;
-    for (uint32_t i = 0; i < ADC_CH_COUNT; ++i) {
-        if (adcInstances[i] != nullptr) {
-            chLeft = true;
-            break;
-        }
-    }
-    if (!chLeft) {
+    if (config_.useIrq && adcIrqUsers != 0 && --adcIrqUsers == 0)
         setIrq(false);
-    }
     setOpened(false);
 }
 
@@ -298,10 +359,19 @@ void Adc::start()
         adc_special_function_config(config_.adc, ADC_CONTINUOUS_MODE, DISABLE);
     }
 
-    setHandler(config_.channel, this);
+    // Routine rank 0 is reconfigured, so this instance replaces the
+    // previous one of the same ADC in IRQ dispatch
+    if (config_.useIrq) {
+        adc_interrupt_disable(config_.adc, ADC_INT_EOC);
+        if (adcActive[adcIndex(config_.adc)] != nullptr)
+            adcActive[adcIndex(config_.adc)]->started_ = false;
+        setActive(config_.adc, this);
+    }
+    started_ = true;
     adc_routine_channel_config(config_.adc, 0, config_.channel, config_.sampleTime);
+    if (config_.useIrq)
+        adc_interrupt_enable(config_.adc, ADC_INT_EOC);
     adc_software_trigger_enable(config_.adc, ADC_ROUTINE_CHANNEL);
-    started_ = true;
 }
 
 /**
@@ -309,8 +379,14 @@ void Adc::start()
  */
 void Adc::stop()
 {
-    setHandler(config_.channel, nullptr);
     adc_special_function_config(config_.adc, ADC_CONTINUOUS_MODE, DISABLE);
+
+    // Late result of stopped conversion must not trigger IRQ without owner
+    if (config_.useIrq && adcActive[adcIndex(config_.adc)] == this) {
+        adc_interrupt_disable(config_.adc, ADC_INT_EOC);
+        adc_interrupt_flag_clear(config_.adc, ADC_INT_FLAG_EOC);
+        setActive(config_.adc, nullptr);
+    }
     started_ = false;
 }
 
@@ -389,29 +465,326 @@ bool Adc::ioctl(uint32_t cmd, void* pValue)
 }
 
 /**
- * @brief ADC IRQ processing handler
+ * @brief ADC IRQ processing handler. Only ADCs with started conversion are
+ *      visited, each has single owner instance, so path is bounded by count
+ *      of active conversions
  */
 void Adc::irqHandler()
 {
-    for (uint32_t i = 0; i < ADC_COUNT; ++i) {
-        uint32_t adc = adcStates[i].adc;
-        if (adc && adc_interrupt_flag_get(adc, ADC_INT_FLAG_EOC) == SET) {
-            adc_interrupt_flag_clear(adc, ADC_INT_FLAG_EOC);
-
-            for (uint32_t j = 0; j < ADC_CH_COUNT; ++j) {
-                if (adcInstances[j] && adcInstances[j]->config_.adc == adc) {
-                    const uint16_t res = adc_routine_data_read(adc);
-                    if (!adcInstances[j]->started_)
-                        break;
-
-                    adcInstances[j]->value_ = res;
-                    adcInstances[j]->ready_ = true;
-                    adcInstances[j]->resultCb()
-                        .call_if(adcInstances[j], res);
-                }
-            }
-        }
+    uint32_t mask = adcActiveMask;
+    while (mask != 0) {
+        const uint32_t index = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        const uint32_t adc = adcPeriph(index);
+        if (adc_interrupt_flag_get(adc, ADC_INT_FLAG_EOC) != SET)
+            continue;
+
+        // Data read clears EOC flag as well
+        adc_interrupt_flag_clear(adc, ADC_INT_FLAG_EOC);
+        const uint16_t res = adc_routine_data_read(adc);
+        Adc* instance = adcActive[index];
+        instance->value_ = res;
+        instance->ready_ = true;
+        instance->resultCb().call_if(instance, res);
+    }
+}
+
+/**
+ * @brief Construct a new P_AdcScan object
+ *
+ * @param buf buffer of both blocks
+ * @param size samples count of buffer
+ */
+P_AdcScan::P_AdcScan(uint16_t* buf, uint32_t size)
+    : config_ {}
+    , buf_(buf)
+    , size_(size)
+    , frames_(0)
+    , started_(false)
+    , lastBlockUs_(0)
+    , sampleRate_(0)
+    , isrLoad_(0)
+    , errors_(0)
+{
+}
+
+/**
+ * @brief Set current driver configuration for further usage
+ *
+ * @param drvConfig driver configuration
+ * @return true if configuration accepted otherwise false
+ */
+bool P_AdcScan::setConfig(const void* drvConfig)
+{
+    if (isOpen())
+        return false;
+
+    const gd32::AdcScanConfig* config = static_cast<const AdcScanConfig*>(drvConfig);
+    assert(config != nullptr);
+    if (config->count == 0 || config->count > ADC_SCAN_MAX || config->dma == nullptr)
+        return false;
+#if defined(GD32F4XX_H)
+    if (config->adc != ADC0 && config->adc != ADC1 && config->adc != ADC2)
+        return false;
+#else
+    if (config->adc != ADC0 && config->adc != ADC1)
+        return false;
+#endif
+
+    config_ = *config;
+    return true;
+}
+
+/**
+ * @brief Open driver with early saved configuration. Configures routine
+ *      sequence of the whole ADC and its DMA channel
+ *
+ * @return true if success opened otherwise false
+ */
+bool P_AdcScan::open()
+{
+    if (isOpen() || config_.count == 0)
+        return false;
+
+#if defined(GD32F4XX_H)
+    // Buffer holds two blocks of whole frames
+    frames_ = size_ / 2 / config_.count;
+    if (frames_ == 0)
+        return false;
+
+    // ADC must be free of single channel drivers
+    AdcState* adcState = nullptr;
+    for (int i = 0; i < ADC_COUNT; ++i) {
+        if (adcStates[i].adc == config_.adc)
+            return false;
+        if (adcStates[i].adc == 0 && !adcState)
+            adcState = &adcStates[i];
+    }
+    if (!adcState || !initDmaPeriph(config_.dma,
+            DmaDelegate::create<P_AdcScan, &P_AdcScan::dmaHandler>(*this)))
+        return false;
+
+    adcState->adc = config_.adc;
+    adcState->configured = true;
+    adcState->count = 1;
+    adcState->scan = true;
+
+    for (uint32_t i = 0; i < config_.gpioCount; ++i) {
+        initGpioPeriph(&config_.gpio[i]);
+    }
+    enableClock(config_.adc);
+    if (!otherConfigured(config_.adc)) {
+        adc_clock_config(static_cast<uint32_t>(config_.prescaler));
+        adc_sync_mode_config(ADC_SYNC_MODE_INDEPENDENT);
+    }
+    adc_disable(config_.adc);
+    adc_resolution_config(config_.adc, config_.resolution);
+    adc_data_alignment_config(config_.adc, ADC_DATAALIGN_RIGHT);
+    adc_special_function_config(config_.adc, ADC_SCAN_MODE, ENABLE);
+    adc_special_function_config(config_.adc, ADC_CONTINUOUS_MODE, DISABLE);
+    adc_external_trigger_config(config_.adc, ADC_ROUTINE_CHANNEL, EXTERNAL_TRIGGER_DISABLE);
+
+    adc_channel_length_config(config_.adc, ADC_ROUTINE_CHANNEL, config_.count);
+    for (uint32_t i = 0; i < config_.count; ++i) {
+        adc_routine_channel_config(config_.adc, i, config_.channels[i], config_.sampleTime);
+    }
+
+    // DMA requests continue after the last conversion of sequence
+    adc_dma_request_after_last_enable(config_.adc);
+    adc_dma_mode_enable(config_.adc);
+    adc_enable(config_.adc);
+    adc_calibration_enable(config_.adc);
+    for (volatile int i = 0; i < 1000; ++i) ; // wait for calibration to finish
+
+    started_ = false;
+    setOpened(true);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Close driver and release ADC
+ */
+void P_AdcScan::close()
+{
+    if (!isOpen())
+        return;
+
+    stop();
+#if defined(GD32F4XX_H)
+    adc_dma_mode_disable(config_.adc);
+    adc_disable(config_.adc);
+#endif
+    deinitDmaPeriph(config_.dma);
+    for (uint32_t i = 0; i < config_.gpioCount; ++i) {
+        deinitGpioPeriph(&config_.gpio[i]);
+    }
+
+    for (int i = 0; i < ADC_COUNT; ++i) {
+        if (adcStates[i].adc == config_.adc)
+            adcStates[i] = {};
+    }
+    setOpened(false);
+}
+
+/**
+ * @brief Execute chosen command on driver. Resolution and sample time are
+ *      changed only for closed driver
+ *
+ * @param cmd command to execute
+ * @param pValue pointer for command data
+ * @return true if command executed successfully otherwise false
+ */
+bool P_AdcScan::ioctl(uint32_t cmd, void* pValue)
+{
+    if (isOpen() || pValue == nullptr)
+        return false;
+
+    switch (static_cast<Adc::IoctlCmd>(cmd)) {
+    case Adc::kSetResolution:
+        config_.resolution = *(static_cast<uint32_t*>(pValue));
+        return true;
+
+    case Adc::kSetSampleTime:
+        config_.sampleTime = *(static_cast<uint32_t*>(pValue));
+        return true;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Starts conversions of sequence by trigger or back-to-back
+ *
+ * @return true if started otherwise false
+ */
+bool P_AdcScan::start()
+{
+    if (!isOpen() || started_)
+        return false;
+
+    lastBlockUs_ = 0;
+    sampleRate_ = 0;
+    isrLoad_ = 0;
+    started_ = true;
+
+#if defined(GD32F4XX_H)
+    // DMA request is held while DMA is disabled, so overrun is cleared
+    // before the first conversion
+    adc_flag_clear(config_.adc, ADC_FLAG_ROVF);
+    startDma(config_.dma, DmaDir::PeriphToMemory, reinterpret_cast<uintptr_t>(&ADC_RDATA(config_.adc)),
+        buf_, frames_ * config_.count * 2, DmaWidth::Bits16, true);
+    adc_dma_mode_enable(config_.adc);
+
+    if (config_.trigger == ADC_SCAN_CONTINUOUS) {
+        adc_special_function_config(config_.adc, ADC_CONTINUOUS_MODE, ENABLE);
+        adc_software_trigger_enable(config_.adc, ADC_ROUTINE_CHANNEL);
+    } else {
+        adc_external_trigger_source_config(config_.adc, ADC_ROUTINE_CHANNEL, config_.trigger);
+        adc_external_trigger_config(config_.adc, ADC_ROUTINE_CHANNEL, EXTERNAL_TRIGGER_RISING);
+    }
+#endif
+    return true;
+}
+
+/**
+ * @brief Stops conversions after current sequence
+ */
+void P_AdcScan::stop()
+{
+    if (!started_)
+        return;
+
+#if defined(GD32F4XX_H)
+    adc_special_function_config(config_.adc, ADC_CONTINUOUS_MODE, DISABLE);
+    adc_external_trigger_config(config_.adc, ADC_ROUTINE_CHANNEL, EXTERNAL_TRIGGER_DISABLE);
+    adc_dma_mode_disable(config_.adc);
+#endif
+    stopDma(config_.dma);
+    started_ = false;
+}
+
+/**
+ * @brief Sets the callback for complete block
+ *
+ * @param blockCb callback delegate
+ */
+void P_AdcScan::setBlockDelegate(const BlockDelegate& blockCb)
+{
+    blockCb_ = blockCb;
+}
+
+/**
+ * @brief Returns achieved sample rate of all channels measured between two
+ *      last blocks
+ *
+ * @return uint32_t samples per second
+ */
+uint32_t P_AdcScan::sampleRate() const
+{
+    return sampleRate_;
+}
+
+/**
+ * @brief Returns CPU load of block handling with block delegate measured
+ *      over the last block period
+ *
+ * @return uint32_t load in permille
+ */
+uint32_t P_AdcScan::isrLoad() const
+{
+    return isrLoad_;
+}
+
+/**
+ * @brief Returns count of DMA errors
+ *
+ * @return uint32_t errors count
+ */
+uint32_t P_AdcScan::errors() const
+{
+    return errors_;
+}
+
+/**
+ * @brief DMA callback, half transfer completes the first block and full
+ *      transfer completes the second one
+ *
+ * @param events DMA events
+ */
+void P_AdcScan::dmaHandler(uint32_t events)
+{
+    if (events & kDmaError)
+        ++errors_;
+    if (events & kDmaHalf)
+        block(buf_);
+    if (events & kDmaFull)
+        block(&buf_[frames_ * config_.count]);
+}
+
+/**
+ * @brief Hands block to delegate and updates rate and load statistics
+ *
+ * @param samples block samples
+ */
+void P_AdcScan::block(const uint16_t* samples)
+{
+    const uint32_t startUs = Time::nowUs();
+    blockCb_.call_if(samples, frames_);
+    const uint32_t endUs = Time::nowUs();
+
+    const uint32_t periodUs = startUs - lastBlockUs_;
+    if (lastBlockUs_ != 0 && periodUs != 0) {
+        sampleRate_ = static_cast<uint64_t>(frames_ * config_.count) * 1000000U / periodUs;
+        isrLoad_ = static_cast<uint64_t>(endUs - startUs) * 1000U / periodUs;
     }
+    lastBlockUs_ = startUs;
 }
 
 #if defined(GD32F4XX_H)
@@ -7,6 +7,7 @@
  #pragma once
 
  #include "gd32/adc_types.h"
+ #include "etl/delegate.h"
 
 namespace gd32 {
 
@@ -34,6 +35,73 @@ private:
     bool started_ = false;
 };
 
+/**
+ * @brief Private realization of GD32 ADC scan group driver. Whole ADC
+ *      converts routine sequence of channels, DMA streams results into
+ *      circular buffer, each half of it is a block of frames handed to block
+ *      delegate while DMA fills another half. ADC is not shared with single
+ *      channel drivers
+ */
+class P_AdcScan : public BaseDrv {
+public:
+    /**
+     * @brief Callback for complete block with interleaved samples of sequence
+     *      channels and frames count. Called from DMA IRQ, block is valid
+     *      until the next callback
+     */
+    using BlockDelegate = etl::delegate<void(const uint16_t*, uint32_t)>;
+
+    P_AdcScan(uint16_t* buf, uint32_t size);
+
+    bool setConfig(const void* drvConfig) override;
+    bool open() override;
+    void close() override;
+    bool ioctl(uint32_t cmd, void* pValue) override;
+
+    bool start();
+    void stop();
+
+    void setBlockDelegate(const BlockDelegate& blockCb);
+
+    uint32_t sampleRate() const;
+    uint32_t isrLoad() const;
+    uint32_t errors() const;
+
+private:
+    void dmaHandler(uint32_t events);
+    void block(const uint16_t* samples);
+
+    AdcScanConfig config_;
+    uint16_t* buf_;
+    uint32_t size_;
+    uint32_t frames_;       // Frames count of single block
+    bool started_;
+    BlockDelegate blockCb_;
+
+    uint32_t lastBlockUs_;
+    uint32_t sampleRate_;
+    uint32_t isrLoad_;
+    uint32_t errors_;
+};
+
+/**
+ * @brief GD32 ADC scan group driver with own buffer
+ *
+ * @tparam SIZE samples count of both blocks, each block holds whole frames
+ *      of sequence channels
+ */
+template <size_t SIZE>
+class AdcScan final : public P_AdcScan {
+public:
+    AdcScan()
+        : P_AdcScan(buf_, SIZE)
+    {
+    }
+
+private:
+    uint16_t buf_[SIZE];
+};
+
 }; // namespace gd32
 
 /***************************** END OF FILE ************************************/
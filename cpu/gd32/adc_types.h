@@ -8,6 +8,14 @@
 
 #include "periph/adc.h"
 #include "gd32/gd32_types.h"
+#include "gd32/dma.h"
+
+#ifndef ADC_SCAN_MAX
+#define ADC_SCAN_MAX 16
+#endif
+
+/// @brief Trigger of scan group for back-to-back continuous conversions
+#define ADC_SCAN_CONTINUOUS 0xFFFFFFFFU
 
 namespace gd32 {
 
@@ -30,13 +38,29 @@ struct AdcConfig {
     uint32_t resolution;
     uint32_t sampleTime;
 #if defined(GD32F4XX_H)
-    AdcPrescaler prescaler;
+    AdcPrescaler prescaler; // Common for ADCs, set by the first opened one
 #endif
     AdcMode mode;
     bool useIrq;
     GpioConfig gpioConfig;
 };
 
+/// @brief ADC scan group configuration data structure
+struct AdcScanConfig {
+    uint32_t adc;
+    uint8_t channels[ADC_SCAN_MAX];     // Routine sequence in conversion order
+    uint32_t count;
+    uint32_t resolution;
+    uint32_t sampleTime;
+#if defined(GD32F4XX_H)
+    AdcPrescaler prescaler; // Common for ADCs, set by the first opened one
+#endif
+    uint32_t trigger;       // Routine external trigger source or ADC_SCAN_CONTINUOUS
+    const DmaConfig* dma;
+    const GpioConfig* gpio; // Optional pins of channels
+    uint32_t gpioCount;
+};
+
 #ifndef GD32F1XX__H
     #define GET_RESOLUTION(RESOLUTION_MACRO) \
         ((RESOLUTION_MACRO == ADC_RESOLUTION_12B) ? 12 : \
@@ -5,6 +5,7 @@
  ******************************************************************************/
 
 #include "gd32/can.h"
+#include "timing.h"
 
 #include <cassert>
 
@@ -47,15 +48,15 @@ static void enableClock(uint32_t port)
 
 static void setIrq(uint32_t port, bool enable)
 {
-    IRQn_Type irqType, irqType2;
+    IRQn_Type irqType, irqType2, irqTypeTx;
     switch (port) {
 #if defined(GD32F4XX_H) || defined(GD32F10X_CL) || defined(GD32F30X_CL)
-    case CAN0: irqType = CAN0_RX0_IRQn; irqType2 = CAN0_RX1_IRQn; break;
+    case CAN0: irqType = CAN0_RX0_IRQn; irqType2 = CAN0_RX1_IRQn; irqTypeTx = CAN0_TX_IRQn; break;
 #else
-    case CAN0: irqType = USBD_LP_CAN0_RX0_IRQn; irqType2 = CAN0_RX1_IRQn; break;
+    case CAN0: irqType = USBD_LP_CAN0_RX0_IRQn; irqType2 = CAN0_RX1_IRQn; irqTypeTx = USBD_HP_CAN0_TX_IRQn; break;
 #endif
 #if defined(GD32F4XX_H) || defined(GD32F10X_CL) || defined(GD32F30X_CL)
-    case CAN1: irqType = CAN1_RX0_IRQn; irqType2 = CAN1_RX1_IRQn; break;
+    case CAN1: irqType = CAN1_RX0_IRQn; irqType2 = CAN1_RX1_IRQn; irqTypeTx = CAN1_TX_IRQn; break;
 #endif
     default: return;
     }
@@ -65,12 +66,49 @@ static void setIrq(uint32_t port, bool enable)
         NVIC_EnableIRQ(irqType);
         NVIC_SetPriority(irqType2, 7);
         NVIC_EnableIRQ(irqType2);
+        NVIC_SetPriority(irqTypeTx, 7);
+        NVIC_EnableIRQ(irqTypeTx);
     } else {
         NVIC_DisableIRQ(irqType);
         NVIC_DisableIRQ(irqType2);
+        NVIC_DisableIRQ(irqTypeTx);
     }
 }
 
+/**
+ * @brief Converts CAN message to transmit message of GD32 library
+ *
+ * @param msg CAN message
+ * @param canMsg transmit message
+ */
+static void toTxMessage(const CanMsg& msg, can_trasnmit_message_struct& canMsg)
+{
+    if (msg.id <= CAN_SFID_MASK) {
+        canMsg.tx_sfid = msg.id;
+        canMsg.tx_efid = 0;
+        canMsg.tx_ff = CAN_FF_STANDARD;
+    } else {
+        canMsg.tx_sfid = 0;
+        canMsg.tx_efid = msg.id;
+        canMsg.tx_ff = CAN_FF_EXTENDED;
+    }
+    canMsg.tx_ft = CAN_FT_DATA;
+    canMsg.tx_dlen = msg.size;
+
+    for (uint8_t i = 0; i < msg.size; ++i) {
+        canMsg.tx_data[i] = msg.data[i];
+    }
+}
+
+/**
+ * @brief Construct a new Can object
+ */
+Can::Can()
+    : config_ {}
+    , rxOverruns_(0)
+{
+}
+
 bool Can::setConfig(const void* drvConfig)
 {
     if (isOpen())
@@ -105,7 +143,8 @@ bool Can::open()
     canParam.auto_wake_up = DISABLE;
     canParam.auto_retrans = DISABLE;
     canParam.rec_fifo_overwrite = DISABLE;
-    canParam.trans_fifo_order = DISABLE;
+    // Messages from TX ring leave mailboxes in order of queueing
+    canParam.trans_fifo_order = ENABLE;
     canParam.working_mode = CAN_NORMAL_MODE;
     canParam.resync_jump_width = CAN_BT_SJW_1TQ;
 
@@ -141,20 +180,34 @@ bool Can::open()
 
     can_deinit(config_.can);
     can_init(config_.can, &canParam);
-    can_interrupt_enable(config_.can, CAN_INT_RFNE0);
-
-    can_filter_parameter_struct canFilter;
-    can_struct_para_init(CAN_FILTER_STRUCT, &canFilter);
-    canFilter.filter_number = 0;
-    canFilter.filter_mode = CAN_FILTERMODE_MASK;
-    canFilter.filter_bits = CAN_FILTERBITS_32BIT;
-    canFilter.filter_list_high = config_.filterId >> 13;
-    canFilter.filter_list_low = config_.filterId << 3;
-    canFilter.filter_mask_high = config_.filterMask >> 13;
-    canFilter.filter_mask_low = config_.filterMask << 3;
-    canFilter.filter_fifo_number = CAN_FIFO0;
-    canFilter.filter_enable = ENABLE;
-    can_filter_init(&canFilter);
+    can_interrupt_enable(config_.can, CAN_INT_RFNE0 | CAN_INT_RFO0 | CAN_INT_RFNE1 | CAN_INT_RFO1);
+
+    // Each controller owns CAN_FILTER_BANKS banks, CAN1 banks follow CAN0
+    if (config_.filters != nullptr) {
+        CanFilter filter;
+        if (!filter.build(config_.filters, config_.filterCount)) {
+            can_deinit(config_.can);
+            return false;
+        }
+        filter.apply(config_.can == CAN0 ? 0 : CAN_FILTER_BANKS);
+    } else {
+        can_filter_parameter_struct canFilter;
+        can_struct_para_init(CAN_FILTER_STRUCT, &canFilter);
+        canFilter.filter_number = 0;
+        canFilter.filter_mode = CAN_FILTERMODE_MASK;
+        canFilter.filter_bits = CAN_FILTERBITS_32BIT;
+        canFilter.filter_list_high = config_.filterId >> 13;
+        canFilter.filter_list_low = config_.filterId << 3;
+        canFilter.filter_mask_high = config_.filterMask >> 13;
+        canFilter.filter_mask_low = config_.filterMask << 3;
+        canFilter.filter_fifo_number = CAN_FIFO0;
+        canFilter.filter_enable = ENABLE;
+        can_filter_init(&canFilter);
+    }
+
+    rxRing_.clear();
+    txRing_.clear();
+    rxOverruns_ = 0;
 
     setHandler(config_.can, this);
     setIrq(config_.can, true);
@@ -185,24 +238,12 @@ int32_t Can::write(const CanMsg& msg)
     if (!isOpen())
         return -1;
 
-    can_trasnmit_message_struct canMsg;
-    if (msg.id <= CAN_SFID_MASK) {
-        canMsg.tx_sfid = msg.id;
-        canMsg.tx_efid = 0;
-        canMsg.tx_ff = CAN_FF_STANDARD;
-    } else {
-        canMsg.tx_sfid = 0;
-        canMsg.tx_efid = msg.id;
-        canMsg.tx_ff = CAN_FF_EXTENDED;
-    }
-    canMsg.tx_ft = CAN_FT_DATA;
-    canMsg.tx_dlen = msg.size;
-
-    for (uint8_t i = 0; i < msg.size; ++i) {
-        canMsg.tx_data[i] = msg.data[i];
-    }
-    const uint8_t txMailbox = can_message_transmit(config_.can, &canMsg);
-    return txMailbox != CAN_NOMAILBOX ? 1 : -1;
+    if (!lock())
+        return -1;
+    const bool pushed = txRing_.push(msg);
+    txKick();
+    unlock();
+    return pushed ? 1 : -1;
 }
 
 /**
@@ -216,13 +257,52 @@ int32_t Can::read(CanMsg& msg)
     if (!isOpen())
         return -1;
 
-    if (!rxQueue_.empty()) {
-        msg = rxQueue_.front();
-        rxQueue_.pop();
-        return 1;
-    } else {
+    return rxRing_.pop(msg) ? 1 : -1;
+}
+
+/**
+ * @brief Writes CAN data messages to driver until TX ring is full. Free
+ *      mailboxes are loaded at once, the rest is sent from IRQ
+ *
+ * @param msgs CAN messages
+ * @return int32_t count of written messages, -1 on error
+ */
+int32_t Can::write(etl::span<const CanMsg> msgs)
+{
+    if (!isOpen())
+        return -1;
+
+    int32_t count = 0;
+    if (!lock())
         return -1;
+    for (const CanMsg& msg : msgs) {
+        if (!txRing_.push(msg))
+            break;
+        ++count;
     }
+    txKick();
+    unlock();
+    return count;
+}
+
+/**
+ * @brief Reads received CAN data messages from driver
+ *
+ * @param msgs buffer for CAN messages
+ * @return int32_t count of read messages, -1 on error
+ */
+int32_t Can::read(etl::span<CanMsg> msgs)
+{
+    if (!isOpen())
+        return -1;
+
+    int32_t count = 0;
+    for (CanMsg& msg : msgs) {
+        if (!rxRing_.pop(msg))
+            break;
+        ++count;
+    }
+    return count;
 }
 
 bool Can::ioctl(uint32_t cmd, void* pValue)
@@ -236,6 +316,18 @@ bool Can::ioctl(uint32_t cmd, void* pValue)
             return true;
         }
         break;
+    case kGetOverruns:
+        if (pValue != nullptr) {
+            *static_cast<uint32_t*>(pValue) = rxOverruns_;
+            return true;
+        }
+        break;
+    case kGetTxDepth:
+        if (pValue != nullptr) {
+            *static_cast<uint32_t*>(pValue) = txRing_.size();
+            return true;
+        }
+        break;
     default:
         break;
     }
@@ -243,16 +335,55 @@ bool Can::ioctl(uint32_t cmd, void* pValue)
     return false;
 }
 
+/**
+ * @brief Loads free TX mailboxes from TX ring and enables mailbox empty IRQ
+ *      for the rest. IRQ is disabled meanwhile, so task and IRQ don't take
+ *      messages from ring concurrently
+ */
+void Can::txKick()
+{
+    can_interrupt_disable(config_.can, CAN_INT_TME);
+    txFill();
+    can_interrupt_enable(config_.can, CAN_INT_TME);
+}
+
+/**
+ * @brief Moves messages from TX ring into free TX mailboxes
+ */
+void Can::txFill()
+{
+    can_trasnmit_message_struct canMsg;
+    while (!txRing_.empty()) {
+        toTxMessage(txRing_.front(), canMsg);
+        if (can_message_transmit(config_.can, &canMsg) == CAN_NOMAILBOX)
+            break;
+        txRing_.pop();
+    }
+}
+
 void Can::irqHandler(Can* can, uint8_t fifo)
 {
     // Check instance pointer
     if (!can)
         return;
 
+    // Hardware FIFO overrun drops incoming message
+    const can_interrupt_flag_enum overrunFlag = fifo == CAN_FIFO0 ? CAN_INT_FLAG_RFO0 : CAN_INT_FLAG_RFO1;
+    if (RESET != can_interrupt_flag_get(can->config_.can, overrunFlag)) {
+        can_interrupt_flag_clear(can->config_.can, overrunFlag);
+        ++can->rxOverruns_;
+    }
+
     CanMsg msg;
     can_receive_message_struct canMsg;
+#if defined(RX_TIMESTAMP_USED)
+    // Time of FIFO drain is taken for all messages at once, hardware time
+    // stamp exists only in time triggered mode and counts bit times
+    msg.timestamp = Time::nowUs();
+#endif
 
-    // Get messages count in FIFO and read it all
+    // Get messages count in FIFO and read it all, FIFO is released even if
+    // RX ring is full
     const uint8_t count = can_receive_message_length_get(can->config_.can, fifo);
     for (uint8_t i = 0; i < count; ++i) {
         can_message_receive(can->config_.can, fifo, &canMsg);
@@ -265,8 +396,27 @@ void Can::irqHandler(Can* can, uint8_t fifo)
         for (uint8_t i = 0; i < msg.size; ++i) {
             msg.data[i] = canMsg.rx_data[i];
         }
-        can->rxQueue_.push(msg);
+        if (!can->rxRing_.push(msg))
+            ++can->rxOverruns_;
     }
+
+    if (count != 0)
+        can->rxCb().call_if();
+}
+
+void Can::txIrqHandler(Can* can)
+{
+    // Check instance pointer
+    if (!can)
+        return;
+
+    can_interrupt_flag_clear(can->config_.can, CAN_INT_FLAG_MTF0);
+    can_interrupt_flag_clear(can->config_.can, CAN_INT_FLAG_MTF1);
+    can_interrupt_flag_clear(can->config_.can, CAN_INT_FLAG_MTF2);
+
+    can->txFill();
+    if (can->txRing_.empty())
+        can_interrupt_disable(can->config_.can, CAN_INT_TME);
 }
 
 extern "C" void CAN0_RX0_IRQHandler(void)
@@ -279,6 +429,24 @@ extern "C" void CAN0_RX1_IRQHandler(void)
     Can::irqHandler(canInstances[0], CAN_FIFO1);
 }
 
+extern "C" void CAN0_TX_IRQHandler(void)
+{
+    Can::txIrqHandler(canInstances[0]);
+}
+
+#if !(defined(GD32F4XX_H) || defined(GD32F10X_CL) || defined(GD32F30X_CL))
+// CAN0 shares vectors with USB device on parts without CAN1
+extern "C" void USBD_LP_CAN0_RX0_IRQHandler(void)
+{
+    Can::irqHandler(canInstances[0], CAN_FIFO0);
+}
+
+extern "C" void USBD_HP_CAN0_TX_IRQHandler(void)
+{
+    Can::txIrqHandler(canInstances[0]);
+}
+#endif
+
 extern "C" void CAN1_RX0_IRQHandler(void)
 {
     Can::irqHandler(canInstances[1], CAN_FIFO0);
@@ -289,6 +457,11 @@ extern "C" void CAN1_RX1_IRQHandler(void)
     Can::irqHandler(canInstances[1], CAN_FIFO1);
 }
 
+extern "C" void CAN1_TX_IRQHandler(void)
+{
+    Can::txIrqHandler(canInstances[1]);
+}
+
 }; // namespace gd32
 
 /***************************** END OF FILE ************************************/
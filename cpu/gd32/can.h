@@ -8,8 +8,18 @@
 
 #include "periph/can.h"
 #include "gd32/gd32_types.h"
+#include "gd32/canfilter.h"
 
-#include "etl/queue.h"
+#include "etl/atomic.h"
+#include "etl/queue_spsc_atomic.h"
+
+#ifndef CAN_RX_SIZE
+#define CAN_RX_SIZE 32
+#endif
+
+#ifndef CAN_TX_SIZE
+#define CAN_TX_SIZE 16
+#endif
 
 namespace gd32 {
 
@@ -20,14 +30,22 @@ struct CanConfig {
     uint32_t filterMask;
     GpioConfig tx;
     GpioConfig rx;
+    const CanFilterRange* filters;  // Optional identifiers ranges instead of single filter
+    uint32_t filterCount;
 };
 
-/// @brief GD32 CAN bus peripheral driver
+/**
+ * @brief GD32 CAN bus peripheral driver. Received and transmitted messages
+ *      pass lock-free rings of CAN_RX_SIZE and CAN_TX_SIZE messages, IRQs
+ *      drain both receive FIFOs into RX ring and refill free TX mailboxes
+ *      from TX ring, so task side works with batches of messages
+ */
 class Can : public ::Can {
 public:
-    using CanQueue = etl::queue<CanMsg, 16, etl::memory_model::MEMORY_MODEL_MEDIUM>;
+    using CanRxRing = etl::queue_spsc_atomic<CanMsg, CAN_RX_SIZE, etl::memory_model::MEMORY_MODEL_MEDIUM>;
+    using CanTxRing = etl::queue_spsc_atomic<CanMsg, CAN_TX_SIZE, etl::memory_model::MEMORY_MODEL_MEDIUM>;
 
-    Can() = default;
+    Can();
 
     bool setConfig(const void* drvConfig) override;
     bool open() override;
@@ -37,12 +55,20 @@ public:
 
     int32_t write(const CanMsg& msg) override;
     int32_t read(CanMsg& msg) override;
+    int32_t write(etl::span<const CanMsg> msgs) override;
+    int32_t read(etl::span<CanMsg> msgs) override;
 
     static void irqHandler(Can* can, uint8_t fifo);
+    static void txIrqHandler(Can* can);
 
 private:
+    void txKick();
+    void txFill();
+
     CanConfig config_;
-    CanQueue rxQueue_;
+    CanRxRing rxRing_;
+    CanTxRing txRing_;
+    etl::atomic<uint32_t> rxOverruns_;
 };
 
 }; // namespace gd32
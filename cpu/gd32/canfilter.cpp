@@ -0,0 +1,475 @@
+/*******************************************************************************
+ * @file    canfilter.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   GD32 CAN filter banks manager.
+ ******************************************************************************/
+
+#include "gd32/canfilter.h"
+#include "gd32/gd32_types.h"
+
+#include <cassert>
+
+namespace gd32 {
+
+// Bits of filter data registers in 32-bit and 16-bit scales
+#define FILTER32_SFID_POS 21
+#define FILTER32_EFID_POS 3
+#define FILTER32_IDE 0x4U
+#define FILTER32_RTR 0x2U
+#define FILTER16_SFID_POS 5
+#define FILTER16_RTR 0x10U
+#define FILTER16_IDE 0x8U
+
+#define CAN_SFID_BITS 0x7FFU
+#define CAN_EFID_BITS 0x1FFFFFFFU
+
+/**
+ * @brief Construct a new empty CanFilter object, which accepts nothing
+ */
+CanFilter::CanFilter()
+    : banks_ {}
+    , count_(0)
+{
+}
+
+/**
+ * @brief Returns banks count of standard frames entries packed into 16-bit
+ *      mask and list banks
+ *
+ * @param masks blocks count
+ * @param ids single identifiers count
+ * @return uint32_t banks count
+ */
+static uint32_t stdBanks(uint32_t masks, uint32_t ids)
+{
+    // Odd block shares mask bank with single identifier
+    if ((masks & 1) != 0 && ids != 0)
+        --ids;
+    return (masks + 1) / 2 + (ids + 3) / 4;
+}
+
+/**
+ * @brief Packs ranges of identifiers into the least count of filter banks.
+ *      Ranges are split into the largest aligned blocks, every exact cover of
+ *      ranges by aligned blocks is a refinement of this split. Extended
+ *      blocks take a bank each and extended identifiers two per bank, odd
+ *      list bank takes standard identifier into its spare slot. Standard
+ *      blocks of 2 or 4 identifiers are cheaper as single identifiers in
+ *      some counts, so all counts of such expanded blocks are tried and the
+ *      one with the least banks is taken. Larger blocks and other
+ *      refinements never reduce banks count
+ *
+ * @param ranges accepted identifiers, can overlap
+ * @param count ranges count, at most CAN_FILTER_RANGES_MAX
+ * @return true if ranges fit into CAN_FILTER_BANKS banks otherwise false
+ */
+bool CanFilter::build(const CanFilterRange* ranges, uint32_t count)
+{
+    count_ = 0;
+    if (count > CAN_FILTER_RANGES_MAX || (count != 0 && ranges == nullptr))
+        return false;
+
+    CanFilterRange merged[CAN_FILTER_RANGES_MAX];
+    const uint32_t mergedCount = merge(ranges, count, merged);
+
+    // Single identifiers and blocks of each frame format are packed apart
+    Entry stdIds[CAN_FILTER_BANKS * 4];
+    Entry stdMasks[CAN_FILTER_BANKS * 4];
+    Entry extIds[CAN_FILTER_BANKS * 2];
+    Entry extMasks[CAN_FILTER_BANKS];
+    uint32_t stdIdCount = 0, stdMaskCount = 0, extIdCount = 0, extMaskCount = 0;
+    uint32_t pairs = 0, quads = 0;
+
+    for (uint32_t i = 0; i < mergedCount; ++i) {
+        const CanFilterRange& range = merged[i];
+        const uint32_t fullMask = idMask(range.extended);
+
+        // Split range into the largest aligned blocks of power of two size
+        uint64_t first = range.first;
+        while (first <= range.last) {
+            uint64_t size = 1;
+            while ((first & (size * 2 - 1)) == 0 && first + size * 2 - 1 <= range.last) {
+                size *= 2;
+            }
+
+            const Entry entry = { static_cast<uint32_t>(first),
+                fullMask & ~static_cast<uint32_t>(size - 1), range.extended };
+            if (size == 1 && !range.extended && stdIdCount < CAN_FILTER_BANKS * 4)
+                stdIds[stdIdCount++] = entry;
+            else if (size == 1 && range.extended && extIdCount < CAN_FILTER_BANKS * 2)
+                extIds[extIdCount++] = entry;
+            else if (size != 1 && !range.extended && stdMaskCount < CAN_FILTER_BANKS * 4)
+                stdMasks[stdMaskCount++] = entry;
+            else if (size != 1 && range.extended && extMaskCount < CAN_FILTER_BANKS)
+                extMasks[extMaskCount++] = entry;
+            else
+                return false;
+
+            if (!range.extended && size == 2)
+                ++pairs;
+            else if (!range.extended && size == 4)
+                ++quads;
+            first += size;
+        }
+    }
+
+    // Choose counts of standard blocks expanded into single identifiers
+    const bool extSpare = (extIdCount & 1) != 0;
+    uint32_t bestBanks = UINT32_MAX, bestPairs = 0, bestQuads = 0;
+    for (uint32_t p = 0; p <= pairs; ++p) {
+        for (uint32_t q = 0; q <= quads; ++q) {
+            uint32_t ids = stdIdCount + p * 2 + q * 4;
+            if (ids > CAN_FILTER_BANKS * 4)
+                continue;
+            if (extSpare && ids != 0)
+                --ids;
+            const uint32_t banks = stdBanks(stdMaskCount - p - q, ids);
+            if (banks < bestBanks) {
+                bestBanks = banks;
+                bestPairs = p;
+                bestQuads = q;
+            }
+        }
+    }
+    if (bestBanks == UINT32_MAX || bestBanks + extMaskCount + (extIdCount + 1) / 2 > CAN_FILTER_BANKS)
+        return false;
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < stdMaskCount; ++i) {
+        const Entry& block = stdMasks[i];
+        const uint32_t size = (~block.mask & CAN_SFID_BITS) + 1;
+        uint32_t* expand = size == 2 ? &bestPairs : size == 4 ? &bestQuads : nullptr;
+        if (expand != nullptr && *expand != 0) {
+            --*expand;
+            for (uint32_t j = 0; j < size; ++j) {
+                stdIds[stdIdCount++] = { block.id + j, CAN_SFID_BITS, false };
+            }
+        } else {
+            stdMasks[kept++] = block;
+        }
+    }
+    stdMaskCount = kept;
+
+    // Spare slot of odd extended list bank takes standard identifier
+    const Entry* spare = nullptr;
+    if (extSpare && stdIdCount != 0)
+        spare = &stdIds[--stdIdCount];
+
+    // Odd standard block shares mask bank with single identifier, the rest
+    // of identifiers go to list banks. Unused slots repeat the last entry
+    for (uint32_t i = 0; i < stdMaskCount; i += 2) {
+        const Entry& a = stdMasks[i];
+        const Entry& b = i + 1 < stdMaskCount ? stdMasks[i + 1]
+            : stdIdCount != 0                 ? stdIds[--stdIdCount]
+                                              : a;
+        const bool ok = addBank(false, false,
+            (encode({ a.mask, a.mask, false }, false) | FILTER16_RTR | FILTER16_IDE) << 16 | encode(a, false),
+            (encode({ b.mask, b.mask, false }, false) | FILTER16_RTR | FILTER16_IDE) << 16 | encode(b, false));
+        if (!ok)
+            return false;
+    }
+    for (uint32_t i = 0; i < stdIdCount; i += 4) {
+        uint32_t ids[4];
+        for (uint32_t j = 0; j < 4; ++j) {
+            ids[j] = encode(stdIds[i + j < stdIdCount ? i + j : stdIdCount - 1], false);
+        }
+        if (!addBank(true, false, ids[1] << 16 | ids[0], ids[3] << 16 | ids[2]))
+            return false;
+    }
+    for (uint32_t i = 0; i < extIdCount; i += 2) {
+        const Entry& b = i + 1 < extIdCount ? extIds[i + 1]
+            : spare != nullptr              ? *spare
+                                            : extIds[i];
+        if (!addBank(true, true, encode(extIds[i], true), encode(b, true)))
+            return false;
+    }
+    for (uint32_t i = 0; i < extMaskCount; ++i) {
+        const Entry& a = extMasks[i];
+        const uint32_t mask = encode({ a.mask, a.mask, true }, true) | FILTER32_RTR;
+        if (!addBank(false, true, encode(a, true), mask))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks that banks accept exactly identifiers of ranges. Banks are
+ *      decoded back from register format, decoded blocks must be disjoint,
+ *      lie inside ranges and cover them completely
+ *
+ * @param ranges accepted identifiers, can overlap
+ * @param count ranges count, at most CAN_FILTER_RANGES_MAX
+ * @return true if coverage is exact otherwise false
+ */
+bool CanFilter::verify(const CanFilterRange* ranges, uint32_t count) const
+{
+    if (count > CAN_FILTER_RANGES_MAX || (count != 0 && ranges == nullptr))
+        return false;
+
+    CanFilterRange merged[CAN_FILTER_RANGES_MAX];
+    const uint32_t mergedCount = merge(ranges, count, merged);
+    uint64_t expected = 0;
+    for (uint32_t i = 0; i < mergedCount; ++i) {
+        expected += static_cast<uint64_t>(merged[i].last) - merged[i].first + 1;
+    }
+
+    Entry entries[CAN_FILTER_BANKS * 4];
+    const uint32_t entryCount = decodeBanks(entries);
+    if (entryCount == UINT32_MAX)
+        return false;
+
+    uint64_t covered = 0;
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        const Entry& entry = entries[i];
+        const uint32_t fullMask = idMask(entry.extended);
+        const uint32_t span = ~entry.mask & fullMask;
+        if ((span & (span + 1)) != 0 || (entry.id & ~entry.mask) != 0)
+            return false;
+
+        // Repeated entries fill unused slots of banks
+        bool repeated = false;
+        for (uint32_t j = 0; j < i && !repeated; ++j) {
+            const Entry& other = entries[j];
+            if (other.extended != entry.extended)
+                continue;
+            if (other.id == entry.id && other.mask == entry.mask) {
+                repeated = true;
+            } else if (((other.id ^ entry.id) & other.mask & entry.mask) == 0) {
+                return false;
+            }
+        }
+        if (repeated)
+            continue;
+
+        bool inside = false;
+        for (uint32_t j = 0; j < mergedCount && !inside; ++j) {
+            inside = merged[j].extended == entry.extended && merged[j].first <= entry.id
+                && entry.id + span <= merged[j].last;
+        }
+        if (!inside)
+            return false;
+        covered += static_cast<uint64_t>(span) + 1;
+    }
+    return covered == expected;
+}
+
+/**
+ * @brief Programs banks into hardware and disables the rest of banks
+ *
+ * @param firstBank number of the first bank of CAN controller
+ */
+void CanFilter::apply(uint32_t firstBank) const
+{
+    can_filter_parameter_struct canFilter;
+    for (uint32_t i = 0; i < CAN_FILTER_BANKS; ++i) {
+        can_struct_para_init(CAN_FILTER_STRUCT, &canFilter);
+        canFilter.filter_number = firstBank + i;
+        if (i >= count_) {
+            canFilter.filter_enable = DISABLE;
+            can_filter_init(&canFilter);
+            continue;
+        }
+
+        // GD32 library places halves of registers differently for scales
+        const CanFilterBank& bank = banks_[i];
+        canFilter.filter_mode = bank.list ? CAN_FILTERMODE_LIST : CAN_FILTERMODE_MASK;
+        canFilter.filter_bits = bank.wide ? CAN_FILTERBITS_32BIT : CAN_FILTERBITS_16BIT;
+        canFilter.filter_fifo_number = bank.fifo == 0 ? CAN_FIFO0 : CAN_FIFO1;
+        if (bank.wide) {
+            canFilter.filter_list_high = bank.data0 >> 16;
+            canFilter.filter_list_low = bank.data0 & 0xFFFF;
+            canFilter.filter_mask_high = bank.data1 >> 16;
+            canFilter.filter_mask_low = bank.data1 & 0xFFFF;
+        } else {
+            canFilter.filter_list_low = bank.data0 & 0xFFFF;
+            canFilter.filter_mask_low = bank.data0 >> 16;
+            canFilter.filter_list_high = bank.data1 & 0xFFFF;
+            canFilter.filter_mask_high = bank.data1 >> 16;
+        }
+        canFilter.filter_enable = ENABLE;
+        can_filter_init(&canFilter);
+    }
+}
+
+/**
+ * @brief Returns count of used banks
+ *
+ * @return uint32_t banks count
+ */
+uint32_t CanFilter::bankCount() const
+{
+    return count_;
+}
+
+/**
+ * @brief Returns used bank
+ *
+ * @param index bank index less than bankCount()
+ * @return const CanFilterBank& bank
+ */
+const CanFilterBank& CanFilter::bank(uint32_t index) const
+{
+    assert(index < count_);
+    return banks_[index];
+}
+
+/**
+ * @brief Sorts ranges and merges overlapping or adjacent ones of the same
+ *      frame format. Identifiers are limited by frame format
+ *
+ * @param ranges source ranges
+ * @param count source ranges count, at most CAN_FILTER_RANGES_MAX
+ * @param merged buffer for merged ranges
+ * @return uint32_t merged ranges count
+ */
+uint32_t CanFilter::merge(const CanFilterRange* ranges, uint32_t count, CanFilterRange* merged)
+{
+    uint32_t sorted = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        CanFilterRange range = ranges[i];
+        const uint32_t fullMask = idMask(range.extended);
+        if (range.last > fullMask)
+            range.last = fullMask;
+        if (range.first > range.last)
+            continue;
+
+        uint32_t pos = sorted++;
+        while (pos != 0
+            && (merged[pos - 1].extended > range.extended
+                || (merged[pos - 1].extended == range.extended && merged[pos - 1].first > range.first))) {
+            merged[pos] = merged[pos - 1];
+            --pos;
+        }
+        merged[pos] = range;
+    }
+
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < sorted; ++i) {
+        if (result != 0 && merged[result - 1].extended == merged[i].extended
+            && static_cast<uint64_t>(merged[result - 1].last) + 1 >= merged[i].first) {
+            if (merged[i].last > merged[result - 1].last)
+                merged[result - 1].last = merged[i].last;
+        } else {
+            merged[result++] = merged[i];
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Returns identifier bits of frame format
+ *
+ * @param extended true for extended frame
+ * @return uint32_t identifier bits
+ */
+uint32_t CanFilter::idMask(bool extended)
+{
+    return extended ? CAN_EFID_BITS : CAN_SFID_BITS;
+}
+
+/**
+ * @brief Encodes identifier into filter register format. Standard frames
+ *      are encoded in 16-bit scale, extended in 32-bit scale
+ *
+ * @param entry identifier
+ * @param wide true for 32-bit scale
+ * @return uint32_t register value
+ */
+uint32_t CanFilter::encode(const Entry& entry, bool wide)
+{
+    if (!wide)
+        return entry.id << FILTER16_SFID_POS;
+    return entry.extended ? (entry.id << FILTER32_EFID_POS | FILTER32_IDE) : entry.id << FILTER32_SFID_POS;
+}
+
+/**
+ * @brief Decodes identifier and mask from filter register format
+ *
+ * @param value identifier in register format
+ * @param mask mask in register format
+ * @param wide true for 32-bit scale
+ * @param entry decoded entry
+ * @return true if entry accepts data frames of single format otherwise false
+ */
+bool CanFilter::decode(uint32_t value, uint32_t mask, bool wide, Entry& entry)
+{
+    if (wide) {
+        if ((mask & (FILTER32_IDE | FILTER32_RTR)) != (FILTER32_IDE | FILTER32_RTR) || (value & FILTER32_RTR) != 0)
+            return false;
+        entry.extended = (value & FILTER32_IDE) != 0;
+        if (entry.extended) {
+            entry.id = value >> FILTER32_EFID_POS;
+            entry.mask = mask >> FILTER32_EFID_POS;
+        } else {
+            if ((value & (CAN_EFID_BITS >> 11) << FILTER32_EFID_POS) != 0)
+                return false;
+            entry.id = value >> FILTER32_SFID_POS;
+            entry.mask = mask >> FILTER32_SFID_POS;
+        }
+    } else {
+        if ((mask & (FILTER16_IDE | FILTER16_RTR)) != (FILTER16_IDE | FILTER16_RTR)
+            || (value & (FILTER16_IDE | FILTER16_RTR | 0x7U)) != 0)
+            return false;
+        entry.extended = false;
+        entry.id = (value >> FILTER16_SFID_POS) & CAN_SFID_BITS;
+        entry.mask = (mask >> FILTER16_SFID_POS) & CAN_SFID_BITS;
+    }
+    entry.id &= idMask(entry.extended);
+    entry.mask &= idMask(entry.extended);
+    return true;
+}
+
+/**
+ * @brief Appends bank, receive FIFOs are used in turn
+ *
+ * @param list true for list mode
+ * @param wide true for 32-bit scale
+ * @param data0 the first register value
+ * @param data1 the second register value
+ * @return true if bank is added otherwise false
+ */
+bool CanFilter::addBank(bool list, bool wide, uint32_t data0, uint32_t data1)
+{
+    if (count_ >= CAN_FILTER_BANKS)
+        return false;
+
+    banks_[count_] = { data0, data1, list, wide, static_cast<uint8_t>(count_ & 1) };
+    ++count_;
+    return true;
+}
+
+/**
+ * @brief Decodes all entries of used banks
+ *
+ * @param entries buffer for CAN_FILTER_BANKS * 4 entries
+ * @return uint32_t entries count or UINT32_MAX if bank is invalid
+ */
+uint32_t CanFilter::decodeBanks(Entry* entries) const
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < count_; ++i) {
+        const CanFilterBank& bank = banks_[i];
+        bool ok;
+        if (bank.wide && bank.list) {
+            ok = decode(bank.data0, UINT32_MAX, true, entries[count++])
+                && decode(bank.data1, UINT32_MAX, true, entries[count++]);
+        } else if (bank.wide) {
+            ok = decode(bank.data0, bank.data1, true, entries[count++]);
+        } else if (bank.list) {
+            ok = decode(bank.data0 & 0xFFFF, 0xFFFF, false, entries[count++])
+                && decode(bank.data0 >> 16, 0xFFFF, false, entries[count++])
+                && decode(bank.data1 & 0xFFFF, 0xFFFF, false, entries[count++])
+                && decode(bank.data1 >> 16, 0xFFFF, false, entries[count++]);
+        } else {
+            ok = decode(bank.data0 & 0xFFFF, bank.data0 >> 16, false, entries[count++])
+                && decode(bank.data1 & 0xFFFF, bank.data1 >> 16, false, entries[count++]);
+        }
+        if (!ok)
+            return UINT32_MAX;
+    }
+    return count;
+}
+
+}; // namespace gd32
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * @file    canfilter.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of GD32 CAN filter banks manager.
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#ifndef CAN_FILTER_BANKS
+#define CAN_FILTER_BANKS 14
+#endif
+
+#ifndef CAN_FILTER_RANGES_MAX
+#define CAN_FILTER_RANGES_MAX 16
+#endif
+
+namespace gd32 {
+
+/// @brief Range of accepted CAN identifiers, single ID has first equal to last
+struct CanFilterRange {
+    uint32_t first;
+    uint32_t last;
+    bool extended;
+};
+
+/// @brief Filter bank in format of GD32 filter data registers
+struct CanFilterBank {
+    uint32_t data0;
+    uint32_t data1;
+    bool list;      // List mode, otherwise mask mode
+    bool wide;      // 32-bit scale, otherwise 16-bit
+    uint8_t fifo;
+};
+
+/**
+ * @brief Manager of GD32 CAN hardware filter banks. Ranges are merged and
+ *      split into aligned blocks of identifiers, single identifiers are put
+ *      into list mode banks, blocks into mask mode banks. Standard frames
+ *      use 16-bit scale with 4 identifiers or 2 masks per bank, extended
+ *      frames use 32-bit scale with 2 identifiers or 1 mask per bank. Small
+ *      standard blocks are expanded into identifiers and free slots are
+ *      shared between formats when it saves banks, so the least count of
+ *      banks is used. Banks are spread between both receive FIFOs. Only data
+ *      frames are accepted
+ */
+class CanFilter {
+public:
+    CanFilter();
+
+    bool build(const CanFilterRange* ranges, uint32_t count);
+    bool verify(const CanFilterRange* ranges, uint32_t count) const;
+    void apply(uint32_t firstBank) const;
+
+    uint32_t bankCount() const;
+    const CanFilterBank& bank(uint32_t index) const;
+
+private:
+    /// @brief Aligned block of identifiers, exact identifier has full mask
+    struct Entry {
+        uint32_t id;
+        uint32_t mask;
+        bool extended;
+    };
+
+    static uint32_t merge(const CanFilterRange* ranges, uint32_t count, CanFilterRange* merged);
+    static uint32_t idMask(bool extended);
+    static uint32_t encode(const Entry& entry, bool wide);
+    static bool decode(uint32_t value, uint32_t mask, bool wide, Entry& entry);
+
+    bool addBank(bool list, bool wide, uint32_t data0, uint32_t data1);
+    uint32_t decodeBanks(Entry* entries) const;
+
+    CanFilterBank banks_[CAN_FILTER_BANKS];
+    uint32_t count_;
+};
+
+}; // namespace gd32
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,259 @@
+/*******************************************************************************
+ * @file    dma.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   GD32 DMA channels helper for peripheral drivers.
+ ******************************************************************************/
+
+#include "gd32/dma.h"
+
+#include <cassert>
+
+namespace gd32 {
+
+#if defined(GD32F4XX_H) && defined(DMA_USED)
+
+#define DMA_CH_COUNT 8
+
+/// @brief DMA channels callbacks table for IRQ usage
+static DmaDelegate dmaHandlers[DMA_CH_COUNT * 2];
+
+/**
+ * @brief Check DMA configuration validity
+ *
+ * @param config DMA configuration
+ * @return true if configuration is valid otherwise false
+ */
+static bool checkConfig(const gd32::DmaConfig* config)
+{
+    assert(config != nullptr);
+    return (config->dma == DMA0 || config->dma == DMA1)
+        && config->channel < DMA_CH_COUNT;
+}
+
+/**
+ * @brief Returns index of DMA channel in callbacks table
+ *
+ * @param config DMA configuration
+ * @return uint32_t channel index
+ */
+static uint32_t channelIndex(const gd32::DmaConfig* config)
+{
+    return (config->dma == DMA1 ? DMA_CH_COUNT : 0) + config->channel;
+}
+
+/**
+ * @brief Returns SDK value of DMA width
+ *
+ * @param width transfer item width
+ * @return uint32_t peripheral and memory width
+ */
+static uint32_t dmaWidth(DmaWidth width)
+{
+    switch (width) {
+    default:
+    case DmaWidth::Bits8: return DMA_PERIPH_WIDTH_8BIT;
+    case DmaWidth::Bits16: return DMA_PERIPH_WIDTH_16BIT;
+    case DmaWidth::Bits32: return DMA_PERIPH_WIDTH_32BIT;
+    }
+}
+
+/**
+ * @brief Sets IRQ new state according to chosen DMA channel
+ *
+ * @param config DMA configuration
+ * @param enable new IRQ state
+ */
+static void setIrq(const gd32::DmaConfig* config, bool enable)
+{
+    static const IRQn_Type irqTypes[DMA_CH_COUNT * 2] = {
+        DMA0_Channel0_IRQn, DMA0_Channel1_IRQn, DMA0_Channel2_IRQn, DMA0_Channel3_IRQn,
+        DMA0_Channel4_IRQn, DMA0_Channel5_IRQn, DMA0_Channel6_IRQn, DMA0_Channel7_IRQn,
+        DMA1_Channel0_IRQn, DMA1_Channel1_IRQn, DMA1_Channel2_IRQn, DMA1_Channel3_IRQn,
+        DMA1_Channel4_IRQn, DMA1_Channel5_IRQn, DMA1_Channel6_IRQn, DMA1_Channel7_IRQn,
+    };
+
+    // Priority is the same as of peripheral IRQs, so DMA and peripheral
+    // handlers of one driver don't preempt each other
+    const IRQn_Type irqType = irqTypes[channelIndex(config)];
+    if (enable) {
+        NVIC_SetPriority(irqType, 7);
+        NVIC_EnableIRQ(irqType);
+    } else {
+        NVIC_DisableIRQ(irqType);
+    }
+}
+
+/**
+ * @brief Calls callback of DMA channel with happened events
+ *
+ * @param dma DMA periph
+ * @param channel DMA channel
+ */
+static void irqHandler(uint32_t dma, uint32_t channel)
+{
+    const dma_channel_enum ch = static_cast<dma_channel_enum>(channel);
+    uint32_t events = 0;
+    if (RESET != dma_interrupt_flag_get(dma, ch, DMA_INT_FLAG_HTF)) {
+        dma_interrupt_flag_clear(dma, ch, DMA_INT_FLAG_HTF);
+        events |= kDmaHalf;
+    }
+    if (RESET != dma_interrupt_flag_get(dma, ch, DMA_INT_FLAG_FTF)) {
+        dma_interrupt_flag_clear(dma, ch, DMA_INT_FLAG_FTF);
+        events |= kDmaFull;
+    }
+    if (RESET != dma_interrupt_flag_get(dma, ch, DMA_INT_FLAG_TAE)) {
+        dma_interrupt_flag_clear(dma, ch, DMA_INT_FLAG_TAE);
+        events |= kDmaError;
+    }
+
+    dmaHandlers[(dma == DMA1 ? DMA_CH_COUNT : 0) + channel].call_if(events);
+}
+
+/**
+ * @brief Enables DMA clock, resets channel and sets its IRQ callback
+ *
+ * @param config DMA configuration
+ * @param cb callback for channel events
+ * @return true if channel initialized otherwise false
+ */
+bool initDmaPeriph(const DmaConfig* config, const DmaDelegate& cb)
+{
+    if (!checkConfig(config))
+        return false;
+
+    rcu_periph_clock_enable(config->dma == DMA0 ? RCU_DMA0 : RCU_DMA1);
+    dma_deinit(config->dma, static_cast<dma_channel_enum>(config->channel));
+    dmaHandlers[channelIndex(config)] = cb;
+    setIrq(config, true);
+    return true;
+}
+
+/**
+ * @brief Stops DMA channel and disables its IRQ
+ *
+ * @param config DMA configuration
+ */
+void deinitDmaPeriph(const DmaConfig* config)
+{
+    if (!checkConfig(config))
+        return;
+
+    stopDma(config);
+    setIrq(config, false);
+    dmaHandlers[channelIndex(config)].clear();
+}
+
+/**
+ * @brief Starts DMA transfer between peripheral register and memory
+ *
+ * @param config DMA configuration
+ * @param direction transfer direction
+ * @param periphAddr peripheral data register address
+ * @param mem memory buffer
+ * @param len transfers count
+ * @param width width of peripheral and memory items
+ * @param circular true for circular mode with half transfer events
+ * @param memoryInc false to use single memory item for all transfers
+ */
+void startDma(const DmaConfig* config, DmaDir direction, uint32_t periphAddr,
+    const void* mem, uint32_t len, DmaWidth width, bool circular, bool memoryInc)
+{
+    const dma_channel_enum ch = static_cast<dma_channel_enum>(config->channel);
+    dma_channel_disable(config->dma, ch);
+    dma_flag_clear(config->dma, ch, DMA_FLAG_HTF | DMA_FLAG_FTF | DMA_FLAG_TAE);
+
+    dma_single_data_parameter_struct param;
+    dma_single_data_para_struct_init(&param);
+    param.periph_addr = periphAddr;
+    param.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+    param.memory0_addr = reinterpret_cast<uintptr_t>(mem);
+    param.memory_inc = memoryInc ? DMA_MEMORY_INCREASE_ENABLE : DMA_MEMORY_INCREASE_DISABLE;
+    param.periph_memory_width = dmaWidth(width);
+    param.circular_mode = circular ? DMA_CIRCULAR_MODE_ENABLE : DMA_CIRCULAR_MODE_DISABLE;
+    param.direction = direction == DmaDir::MemoryToPeriph ? DMA_MEMORY_TO_PERIPH : DMA_PERIPH_TO_MEMORY;
+    param.number = len;
+    param.priority = config->priority;
+    dma_single_data_mode_init(config->dma, ch, &param);
+    dma_channel_subperipheral_select(config->dma, ch,
+        static_cast<dma_subperipheral_enum>(config->subperiph));
+
+    dma_interrupt_enable(config->dma, ch, DMA_CHXCTL_FTFIE | DMA_CHXCTL_TAEIE
+        | (circular ? DMA_CHXCTL_HTFIE : 0));
+    dma_channel_enable(config->dma, ch);
+}
+
+/**
+ * @brief Stops DMA transfer
+ *
+ * @param config DMA configuration
+ */
+void stopDma(const DmaConfig* config)
+{
+    const dma_channel_enum ch = static_cast<dma_channel_enum>(config->channel);
+    dma_interrupt_disable(config->dma, ch, DMA_CHXCTL_HTFIE | DMA_CHXCTL_FTFIE | DMA_CHXCTL_TAEIE);
+    dma_channel_disable(config->dma, ch);
+}
+
+/**
+ * @brief Returns count of remaining transfers. In circular mode it is
+ *      reloaded after each full transfer
+ *
+ * @param config DMA configuration
+ * @return uint32_t remaining transfers count
+ */
+uint32_t dmaRemaining(const DmaConfig* config)
+{
+    return dma_transfer_number_get(config->dma, static_cast<dma_channel_enum>(config->channel));
+}
+
+extern "C" void DMA0_Channel0_IRQHandler(void) { irqHandler(DMA0, 0); }
+extern "C" void DMA0_Channel1_IRQHandler(void) { irqHandler(DMA0, 1); }
+extern "C" void DMA0_Channel2_IRQHandler(void) { irqHandler(DMA0, 2); }
+extern "C" void DMA0_Channel3_IRQHandler(void) { irqHandler(DMA0, 3); }
+extern "C" void DMA0_Channel4_IRQHandler(void) { irqHandler(DMA0, 4); }
+extern "C" void DMA0_Channel5_IRQHandler(void) { irqHandler(DMA0, 5); }
+extern "C" void DMA0_Channel6_IRQHandler(void) { irqHandler(DMA0, 6); }
+extern "C" void DMA0_Channel7_IRQHandler(void) { irqHandler(DMA0, 7); }
+extern "C" void DMA1_Channel0_IRQHandler(void) { irqHandler(DMA1, 0); }
+extern "C" void DMA1_Channel1_IRQHandler(void) { irqHandler(DMA1, 1); }
+extern "C" void DMA1_Channel2_IRQHandler(void) { irqHandler(DMA1, 2); }
+extern "C" void DMA1_Channel3_IRQHandler(void) { irqHandler(DMA1, 3); }
+extern "C" void DMA1_Channel4_IRQHandler(void) { irqHandler(DMA1, 4); }
+extern "C" void DMA1_Channel5_IRQHandler(void) { irqHandler(DMA1, 5); }
+extern "C" void DMA1_Channel6_IRQHandler(void) { irqHandler(DMA1, 6); }
+extern "C" void DMA1_Channel7_IRQHandler(void) { irqHandler(DMA1, 7); }
+
+#else
+
+// DMA channels are used when enabled by DMA_USED define and supported on
+// GD32F4xx only, otherwise drivers work without DMA. Direction and width
+// are helper enumerations, so drivers don't use SDK values of one family
+
+bool initDmaPeriph(const DmaConfig* config, const DmaDelegate& cb)
+{
+    return false;
+}
+
+void deinitDmaPeriph(const DmaConfig* config)
+{
+}
+
+void startDma(const DmaConfig* config, DmaDir direction, uint32_t periphAddr,
+    const void* mem, uint32_t len, DmaWidth width, bool circular, bool memoryInc)
+{
+}
+
+void stopDma(const DmaConfig* config)
+{
+}
+
+uint32_t dmaRemaining(const DmaConfig* config)
+{
+    return 0;
+}
+
+#endif
+
+}; // namespace gd32
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * @file    dma.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of GD32 DMA channels helper.
+ ******************************************************************************/
+
+#pragma once
+
+#include "gd32/gd32_types.h"
+
+#include "etl/delegate.h"
+
+namespace gd32 {
+
+/// @brief DMA channel configuration data structure
+struct DmaConfig {
+    uint32_t dma;
+    uint32_t channel;
+    uint32_t subperiph;
+    uint32_t priority;
+};
+
+/// @brief DMA channel events for IRQ callback
+enum DmaEvent : uint32_t {
+    kDmaHalf = 0x1,
+    kDmaFull = 0x2,
+    kDmaError = 0x4,
+};
+
+/// @brief DMA transfer direction
+enum class DmaDir : uint8_t {
+    PeriphToMemory,
+    MemoryToPeriph,
+};
+
+/// @brief Width of DMA transfer item, the same for peripheral and memory
+enum class DmaWidth : uint8_t {
+    Bits8,
+    Bits16,
+    Bits32,
+};
+
+/// @brief Callback for DMA channel IRQ with DmaEvent flags
+using DmaDelegate = etl::delegate<void(uint32_t)>;
+
+bool initDmaPeriph(const DmaConfig* config, const DmaDelegate& cb);
+void deinitDmaPeriph(const DmaConfig* config);
+
+void startDma(const DmaConfig* config, DmaDir direction, uint32_t periphAddr,
+    const void* mem, uint32_t len, DmaWidth width, bool circular, bool memoryInc = true);
+void stopDma(const DmaConfig* config);
+uint32_t dmaRemaining(const DmaConfig* config);
+
+}; // namespace gd32
+
+/***************************** END OF FILE ************************************/
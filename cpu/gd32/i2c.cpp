@@ -5,30 +5,46 @@
  ******************************************************************************/
 
 #include "gd32/i2c.h"
+#include "timing.h"
 
 #include <cassert>
 
 namespace gd32 {
 
-enum class State {
-    Start,
-    SendAddress,
-    TransmitReg,
-    TransmitData,
-    Stop,
-};
+static I2c* i2cInstances[3] = { nullptr };
 
-static bool waitForFlagSet(int32_t i2c, i2c_flag_enum flag)
+/**
+ * @brief Waits for previous stop condition sending with bounded time
+ *
+ * @param i2c I2C periph
+ * @return true if stop is sent otherwise false
+ */
+static bool waitForStop(uint32_t i2c)
 {
     const uint32_t timeout = 5000;
     uint32_t time = 0;
-    // Wait until flag bit is set
-    while (!i2c_flag_get(i2c, flag) && time < timeout) {
+    while ((I2C_CTL0(i2c) & I2C_CTL0_STOP) && time < timeout) {
         ++time;
     }
     return time < timeout;
 }
 
+/**
+ * @brief Sets DMA requests of I2C. DMA helper works on GD32F4xx only, so
+ *      other families never come here with DMA channels
+ *
+ * @param i2c I2C periph
+ * @param enable new DMA requests state
+ * @param last true to not acknowledge the last received byte
+ */
+static void setDma(uint32_t i2c, bool enable, bool last)
+{
+#if defined(GD32F4XX_H) && defined(DMA_USED)
+    i2c_dma_last_transfer_config(i2c, last ? I2C_DMALST_ON : I2C_DMALST_OFF);
+    i2c_dma_config(i2c, enable ? I2C_DMA_ON : I2C_DMA_OFF);
+#endif
+}
+
 static bool checkConfig(const gd32::I2cConfig* config)
 {
     assert(config != nullptr);
@@ -40,6 +56,68 @@ static bool checkConfig(const gd32::I2cConfig* config)
         ;
 }
 
+static void setHandler(uint32_t i2c, I2c* arg)
+{
+    switch (i2c) {
+    case I2C0: i2cInstances[0] = arg; break;
+    case I2C1: i2cInstances[1] = arg; break;
+#ifdef I2C2
+    case I2C2: i2cInstances[2] = arg; break;
+#endif
+    default: return;
+    }
+}
+
+static void setIrq(uint32_t i2c, bool enable)
+{
+    IRQn_Type evIrq;
+    IRQn_Type erIrq;
+    switch (i2c) {
+    case I2C0: evIrq = I2C0_EV_IRQn; erIrq = I2C0_ER_IRQn; break;
+    case I2C1: evIrq = I2C1_EV_IRQn; erIrq = I2C1_ER_IRQn; break;
+#ifdef I2C2
+    case I2C2: evIrq = I2C2_EV_IRQn; erIrq = I2C2_ER_IRQn; break;
+#endif
+    default: return;
+    }
+
+    // Priority is the same as of DMA IRQs, so they don't preempt each other
+    if (enable) {
+        NVIC_SetPriority(evIrq, 7);
+        NVIC_SetPriority(erIrq, 7);
+        NVIC_EnableIRQ(evIrq);
+        NVIC_EnableIRQ(erIrq);
+    } else {
+        NVIC_DisableIRQ(evIrq);
+        NVIC_DisableIRQ(erIrq);
+    }
+}
+
+I2c::I2c()
+    : config_ {}
+    , state_(State::Idle)
+    , receiver_(false)
+    , rx_(false)
+    , dma_(false)
+    , async_(false)
+    , devAddr_(-1)
+    , devReg_(-1)
+    , txVec_(nullptr)
+    , rxVec_(nullptr)
+    , txSingle_ {}
+    , rxSingle_ {}
+    , count_(0)
+    , seg_(0)
+    , pos_(0)
+    , len_(0)
+    , cnt_(0)
+    , result_(-1)
+{
+#if defined(FREERTOS_USED)
+    done_ = xSemaphoreCreateBinary();
+#endif
+}
+
 bool I2c::setConfig(const void* drvConfig)
 {
     if (isOpen())
@@ -80,6 +158,20 @@ bool I2c::open()
     i2c_mode_addr_config(config_.i2c, I2C_I2CMODE_ENABLE, I2C_ADDFORMAT_7BITS, 0);
     i2c_enable(config_.i2c);
     i2c_ack_config(config_.i2c, I2C_ACK_ENABLE);
+
+    // Without DMA channel payload is moved byte by byte in IRQ
+    if (config_.rxDma != nullptr && !initDmaPeriph(config_.rxDma,
+            DmaDelegate::create<I2c, &I2c::rxDmaHandler>(*this))) {
+        config_.rxDma = nullptr;
+    }
+    if (config_.txDma != nullptr && !initDmaPeriph(config_.txDma,
+            DmaDelegate::create<I2c, &I2c::txDmaHandler>(*this))) {
+        config_.txDma = nullptr;
+    }
+
+    state_ = State::Idle;
+    setHandler(config_.i2c, this);
+    setIrq(config_.i2c, true);
     setOpened(true);
     return true;
 }
@@ -87,6 +179,13 @@ bool I2c::open()
 void I2c::close()
 {
     if (isOpen()) {
+        abort();
+        setIrq(config_.i2c, false);
+        setHandler(config_.i2c, nullptr);
+        if (config_.rxDma != nullptr)
+            deinitDmaPeriph(config_.rxDma);
+        if (config_.txDma != nullptr)
+            deinitDmaPeriph(config_.txDma);
         i2c_disable(config_.i2c);
         i2c_deinit(config_.i2c);
         deinitGpioPeriph(&config_.scl);
@@ -99,194 +198,46 @@ int32_t I2c::write_(const void* buf, uint32_t len)
 {
     assert(buf != nullptr);
 
-    // Take address from parent first if exists
-    int32_t addr = getAddr() >= 0 ? (getAddr() << 1) : -1;
-    if (!isOpen() || addr < 0 || i2c_flag_get(config_.i2c, I2C_FLAG_I2CBSY))
-        return -1;
-
-    const uint8_t* bytes = static_cast<const uint8_t*>(buf);
-    const int32_t reg = getReg();
-    bool cycle = true;
-    State state = State::Start;
-    int32_t res = -1;
-    uint32_t cnt = 0;
-
-    while (cycle) {
-        switch (state) {
-        default:
-        case State::Start:
-            i2c_start_on_bus(config_.i2c);
-            if (waitForFlagSet(config_.i2c, I2C_FLAG_SBSEND)) {
-                state = State::SendAddress;
-            } else {
-                cycle = false;
-            }
-            break;
-
-        case State::SendAddress:
-            i2c_master_addressing(config_.i2c, addr, I2C_TRANSMITTER);
-            if (waitForFlagSet(config_.i2c, I2C_FLAG_ADDSEND)) {
-                i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
-                state = reg >= 0 ? State::TransmitReg : State::TransmitData;
-            } else {
-                cycle = false;
-            }
-            break;
-
-        case State::TransmitReg:
-            i2c_data_transmit(config_.i2c, reg);
-            state = State::TransmitData;
-            break;
-
-        case State::TransmitData:
-            if (cnt < len) {
-                i2c_data_transmit(config_.i2c, bytes[cnt++]);
-                if (!waitForFlagSet(config_.i2c, I2C_FLAG_TBE)) {
-                    cycle = false;
-                }
-            } else {
-                state = State::Stop;
-            }
-            break;
-
-        case State::Stop:
-            i2c_stop_on_bus(config_.i2c);
-            while (I2C_CTL0(config_.i2c) & 0x0200);
-            res = len;
-            cycle = false;
-            break;
-        }
-    }
-
-    return res;
+    const WriteVec vec = { buf, len };
+    return writev_(&vec, 1);
 }
 
 int32_t I2c::read_(void* buf, uint32_t len)
 {
     assert(buf != nullptr);
 
-    // Take address from parent first if exists
-    int32_t addr = getAddr() >= 0 ? (getAddr() << 1) : -1;
-    if (!isOpen() || addr < 0 || len == 0 || i2c_flag_get(config_.i2c, I2C_FLAG_I2CBSY))
-        return -1;
-
-    uint8_t* bytes = static_cast<uint8_t*>(buf);
-    const int32_t reg = getReg();
-    bool cycle = true;
-    State state = State::Start;
-    int32_t res = -1;
-    uint32_t cnt = 0;
-
-    if (len == 2) {
-        i2c_ackpos_config(config_.i2c, I2C_ACKPOS_NEXT);
-    }
-
-    while (cycle) {
-        switch (state) {
-        default:
-        case State::Start:
-            i2c_start_on_bus(config_.i2c);
-            if (waitForFlagSet(config_.i2c, I2C_FLAG_SBSEND)) {
-                state = State::SendAddress;
-            } else {
-                cycle = false;
-            }
-            break;
+    const ReadVec vec = { buf, len };
+    return readv_(&vec, 1);
+}
 
-        case State::SendAddress:
-            if (reg >= 0) {
-                i2c_master_addressing(config_.i2c, addr, I2C_TRANSMITTER);
-                if (waitForFlagSet(config_.i2c, I2C_FLAG_ADDSEND)) {
-                    i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
-                    state = State::TransmitReg;
-                } else {
-                    cycle = false;
-                }
-            } else {
-                i2c_master_addressing(config_.i2c, addr, I2C_RECEIVER);
-                if (len < 3) {
-                    i2c_ack_config(config_.i2c, I2C_ACK_DISABLE);
-                }
-
-                if (waitForFlagSet(config_.i2c, I2C_FLAG_ADDSEND)) {
-                    i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
-                    if (len == 1) {
-                        i2c_stop_on_bus(config_.i2c);
-                    }
-                    state = State::TransmitData;
-                } else {
-                    cycle = false;
-                }
-            }
-            break;
+int32_t I2c::writev_(const WriteVec* vec, uint32_t count)
+{
+    if (!start(vec, nullptr, count, false))
+        return -1;
+    return wait();
+}
 
-        case State::TransmitReg:
-            i2c_data_transmit(config_.i2c, reg);
-            if (!waitForFlagSet(config_.i2c, I2C_FLAG_BTC)) {
-                cycle = false;
-            } else {
-                i2c_start_on_bus(config_.i2c);
-                if (waitForFlagSet(config_.i2c, I2C_FLAG_SBSEND)) {
-                    i2c_master_addressing(config_.i2c, addr, I2C_RECEIVER);
-                    if (len < 3) {
-                        i2c_ack_config(config_.i2c, I2C_ACK_DISABLE);
-                    }
-
-                    if (waitForFlagSet(config_.i2c, I2C_FLAG_ADDSEND)) {
-                        i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
-                        if (len == 1) {
-                            i2c_stop_on_bus(config_.i2c);
-                        }
-                        state = State::TransmitData;
-                    } else {
-                        cycle = false;
-                    }
-                } else {
-                    cycle = false;
-                }
-            }
-            state = State::TransmitData;
-            break;
+int32_t I2c::readv_(const ReadVec* vec, uint32_t count)
+{
+    if (!start(nullptr, vec, count, false))
+        return -1;
+    return wait();
+}
 
-        case State::TransmitData:
-            if (len >= 3 && cnt == len - 3) {
-                if (waitForFlagSet(config_.i2c, I2C_FLAG_BTC)) {
-                    i2c_ack_config(config_.i2c, I2C_ACK_DISABLE);
-                } else {
-                    cycle = false;
-                    break;
-                }
-            }
-            if (len >= 2 && cnt == len - 2) {
-                if (waitForFlagSet(config_.i2c, I2C_FLAG_BTC)) {
-                    i2c_stop_on_bus(config_.i2c);
-                } else {
-                    cycle = false;
-                    break;
-                }
-            }
+DrvResult I2c::writeAsync_(const void* buf, uint32_t len)
+{
+    assert(buf != nullptr);
 
-            if (cnt < len) {
-                if (waitForFlagSet(config_.i2c, I2C_FLAG_RBNE)) {
-                    bytes[cnt++] = i2c_data_receive(config_.i2c);
-                } else {
-                    cycle = false;
-                }
-            } else {
-                state = State::Stop;
-            }
-            break;
+    txSingle_ = { buf, len };
+    return start(&txSingle_, nullptr, 1, true) ? DrvResult::InProgress : DrvResult::Error;
+}
 
-        case State::Stop:
-            while (I2C_CTL0(config_.i2c) & 0x0200);
-            res = len;
-            cycle = false;
-            break;
-        }
-    }
+DrvResult I2c::readAsync_(void* buf, uint32_t len)
+{
+    assert(buf != nullptr);
 
-    i2c_ack_config(config_.i2c, I2C_ACK_ENABLE);
-    return res;
+    rxSingle_ = { buf, len };
+    return start(nullptr, &rxSingle_, 1, true) ? DrvResult::InProgress : DrvResult::Error;
 }
 
 bool I2c::ioctl(uint32_t cmd, void* pValue)
@@ -313,6 +264,406 @@ bool I2c::ioctl(uint32_t cmd, void* pValue)
     return false;
 }
 
+/**
+ * @brief Starts transfer by start condition, the rest is done in IRQ
+ *
+ * @param txVec data segments to write, nullptr for read
+ * @param rxVec data segments to read, nullptr for write
+ * @param count segments count
+ * @param async true if completed by asynchronous delegate
+ * @return true if transfer started otherwise false
+ */
+bool I2c::start(const WriteVec* txVec, const ReadVec* rxVec, uint32_t count, bool async)
+{
+    // Take address from parent first if exists
+    const int32_t addr = getAddr() >= 0 ? (getAddr() << 1) : -1;
+    if (!isOpen() || addr < 0 || state_ != State::Idle || !waitForStop(config_.i2c)
+        || i2c_flag_get(config_.i2c, I2C_FLAG_I2CBSY))
+        return false;
+
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        assert(txVec == nullptr || txVec[i].buf != nullptr);
+        assert(rxVec == nullptr || rxVec[i].buf != nullptr);
+        len += txVec != nullptr ? txVec[i].len : rxVec[i].len;
+    }
+    if (rxVec != nullptr && len == 0)
+        return false;
+
+    devAddr_ = addr;
+    devReg_ = getReg();
+    txVec_ = txVec;
+    rxVec_ = rxVec;
+    count_ = count;
+    seg_ = 0;
+    pos_ = 0;
+    len_ = len;
+    cnt_ = 0;
+    rx_ = rxVec != nullptr;
+    async_ = async;
+    result_ = -1;
+
+    // DMA moves single contiguous segment only, reception needs at least two
+    // bytes for automatic NACK of the last byte
+    const DmaConfig* dma = rx_ ? config_.rxDma : config_.txDma;
+    dma_ = dma != nullptr && count == 1 && len >= I2C_DMA_MIN && len >= 2;
+
+#if defined(FREERTOS_USED)
+    // Drop completion of previously aborted transfer
+    xSemaphoreTake(done_, 0);
+#endif
+
+    i2c_flag_clear(config_.i2c, I2C_FLAG_AERR);
+    i2c_flag_clear(config_.i2c, I2C_FLAG_BERR);
+    i2c_flag_clear(config_.i2c, I2C_FLAG_LOSTARB);
+    i2c_flag_clear(config_.i2c, I2C_FLAG_OUERR);
+    i2c_ackpos_config(config_.i2c, I2C_ACKPOS_CURRENT);
+    i2c_ack_config(config_.i2c, I2C_ACK_ENABLE);
+
+    state_ = State::Start;
+    i2c_interrupt_enable(config_.i2c, I2C_INT_ERR);
+    i2c_interrupt_enable(config_.i2c, I2C_INT_EV);
+    i2c_interrupt_enable(config_.i2c, I2C_INT_BUF);
+    i2c_start_on_bus(config_.i2c);
+    return true;
+}
+
+/**
+ * @brief Waits for transfer completion. With FreeRTOS task is blocked, so
+ *      other tasks run during transfer
+ *
+ * @return int32_t transferred data length, -1 on error or timeout
+ */
+int32_t I2c::wait()
+{
+#if defined(FREERTOS_USED)
+    if (xSemaphoreTake(done_, pdMS_TO_TICKS(I2C_TIMEOUT_MS)) != pdTRUE)
+        abort();
+#else
+    const Time startTime = Time::now();
+    while (state_ != State::Idle) {
+        if ((Time::now() - startTime).toMsec() >= I2C_TIMEOUT_MS) {
+            abort();
+            break;
+        }
+    }
+#endif
+    return result_;
+}
+
+/**
+ * @brief Stops hung transfer from task context. Transfer completed by IRQ
+ *      meanwhile is left as is
+ */
+void I2c::abort()
+{
+    i2c_interrupt_disable(config_.i2c, I2C_INT_ERR);
+    i2c_interrupt_disable(config_.i2c, I2C_INT_EV);
+    i2c_interrupt_disable(config_.i2c, I2C_INT_BUF);
+    if (dma_) {
+        stopDma(rx_ ? config_.rxDma : config_.txDma);
+    }
+    if (state_ == State::Idle)
+        return;
+
+    i2c_stop_on_bus(config_.i2c);
+    release();
+    result_ = -1;
+    state_ = State::Idle;
+    if (async_) {
+        async_ = false;
+        finishAsync(-1, rx_ ? Direction::Rx : Direction::Tx);
+    }
+}
+
+/**
+ * @brief Completes transfer from IRQ
+ *
+ * @param res transferred data length, -1 on error
+ */
+void I2c::finish(int32_t res)
+{
+    i2c_interrupt_disable(config_.i2c, I2C_INT_ERR);
+    i2c_interrupt_disable(config_.i2c, I2C_INT_EV);
+    i2c_interrupt_disable(config_.i2c, I2C_INT_BUF);
+    if (dma_) {
+        stopDma(rx_ ? config_.rxDma : config_.txDma);
+    }
+    release();
+    result_ = res;
+    state_ = State::Idle;
+
+    if (async_) {
+        async_ = false;
+        finishAsyncFromIsr(res, rx_ ? Direction::Rx : Direction::Tx);
+        return;
+    }
+#if defined(FREERTOS_USED)
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(done_, &woken);
+    portYIELD_FROM_ISR(woken);
+#endif
+}
+
+/**
+ * @brief Restores peripheral settings changed during transfer
+ */
+void I2c::release()
+{
+    if (dma_)
+        setDma(config_.i2c, false, false);
+    i2c_ackpos_config(config_.i2c, I2C_ACKPOS_CURRENT);
+    i2c_ack_config(config_.i2c, I2C_ACK_ENABLE);
+}
+
+/**
+ * @brief Handles address acknowledge. Register is written at once, payload
+ *      is started by DMA or left for next IRQs
+ */
+void I2c::addressSent()
+{
+    if (!receiver_) {
+        i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
+        state_ = State::TransmitData;
+        if (devReg_ >= 0) {
+            i2c_data_transmit(config_.i2c, devReg_);
+        } else if (len_ == 0) {
+            // Exchange without data like destination test
+            i2c_stop_on_bus(config_.i2c);
+            finish(0);
+            return;
+        }
+
+        if (dma_ && !rx_) {
+            i2c_interrupt_disable(config_.i2c, I2C_INT_BUF);
+            setDma(config_.i2c, true, false);
+            startDma(config_.txDma, DmaDir::MemoryToPeriph,
+                reinterpret_cast<uintptr_t>(&I2C_DATA(config_.i2c)),
+                txVec_[0].buf, len_, DmaWidth::Bits8, false);
+        }
+        return;
+    }
+
+    state_ = State::ReceiveData;
+    if (dma_) {
+        // The last byte is not acknowledged by DMA last transfer flag
+        i2c_interrupt_disable(config_.i2c, I2C_INT_BUF);
+        setDma(config_.i2c, true, true);
+        startDma(config_.rxDma, DmaDir::PeriphToMemory,
+            reinterpret_cast<uintptr_t>(&I2C_DATA(config_.i2c)),
+            rxVec_[0].buf, len_, DmaWidth::Bits8, false);
+        i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
+    } else if (len_ == 1) {
+        i2c_ack_config(config_.i2c, I2C_ACK_DISABLE);
+        i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
+        i2c_stop_on_bus(config_.i2c);
+    } else if (len_ == 2) {
+        // Both bytes are taken on byte transfer complete
+        i2c_ack_config(config_.i2c, I2C_ACK_DISABLE);
+        i2c_ackpos_config(config_.i2c, I2C_ACKPOS_NEXT);
+        i2c_interrupt_disable(config_.i2c, I2C_INT_BUF);
+        i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
+    } else {
+        i2c_flag_clear(config_.i2c, I2C_FLAG_ADDSEND);
+    }
+}
+
+/**
+ * @brief Handles transmission events. Segments are sent one by one in the
+ *      same transfer. After the last byte transfer is stopped or restarted
+ *      for reception from register
+ */
+void I2c::transmitEvent()
+{
+    // Reading from register has only register byte in this phase
+    const bool txDma = dma_ && !rx_;
+    const uint32_t txLen = rx_ ? 0 : len_;
+    if (cnt_ < txLen && !txDma) {
+        if (i2c_flag_get(config_.i2c, I2C_FLAG_TBE)) {
+            while (pos_ == txVec_[seg_].len) {
+                ++seg_;
+                pos_ = 0;
+            }
+            i2c_data_transmit(config_.i2c, static_cast<const uint8_t*>(txVec_[seg_].buf)[pos_++]);
+            ++cnt_;
+        }
+        return;
+    }
+
+    const bool sent = !txDma || dmaRemaining(config_.txDma) == 0;
+    if (i2c_flag_get(config_.i2c, I2C_FLAG_BTC) && sent) {
+        if (rx_) {
+            state_ = State::Restart;
+            i2c_start_on_bus(config_.i2c);
+        } else {
+            i2c_stop_on_bus(config_.i2c);
+            finish(len_);
+        }
+    } else if (i2c_flag_get(config_.i2c, I2C_FLAG_TBE)) {
+        // Wait for the last byte shifting out
+        i2c_interrupt_disable(config_.i2c, I2C_INT_BUF);
+    }
+}
+
+/**
+ * @brief Stores received byte into current segment
+ */
+void I2c::receiveByte()
+{
+    while (pos_ == rxVec_[seg_].len) {
+        ++seg_;
+        pos_ = 0;
+    }
+    static_cast<uint8_t*>(rxVec_[seg_].buf)[pos_++] = i2c_data_receive(config_.i2c);
+    ++cnt_;
+}
+
+/**
+ * @brief Handles reception events. The last two bytes are taken on byte
+ *      transfer complete, so NACK and stop are set in time
+ */
+void I2c::receiveEvent()
+{
+    if (dma_)
+        return;
+
+    const uint32_t rest = len_ - cnt_;
+    if (rest >= 2 && rest <= 3 && i2c_flag_get(config_.i2c, I2C_FLAG_BTC)) {
+        if (rest == 3) {
+            i2c_ack_config(config_.i2c, I2C_ACK_DISABLE);
+            receiveByte();
+        } else {
+            i2c_stop_on_bus(config_.i2c);
+            receiveByte();
+            receiveByte();
+            finish(len_);
+        }
+    } else if (i2c_flag_get(config_.i2c, I2C_FLAG_RBNE)) {
+        if (rest > 3) {
+            receiveByte();
+        } else if (rest == 1) {
+            receiveByte();
+            finish(len_);
+        } else {
+            i2c_interrupt_disable(config_.i2c, I2C_INT_BUF);
+        }
+    }
+}
+
+void I2c::rxDmaHandler(uint32_t events)
+{
+    if (state_ != State::ReceiveData)
+        return;
+
+    i2c_stop_on_bus(config_.i2c);
+    if (events & kDmaError) {
+        finish(-1);
+    } else if (events & kDmaFull) {
+        finish(len_);
+    }
+}
+
+void I2c::txDmaHandler(uint32_t events)
+{
+    // Completion is handled on byte transfer complete event
+    if (state_ == State::TransmitData && (events & kDmaError)) {
+        i2c_stop_on_bus(config_.i2c);
+        finish(-1);
+    }
+}
+
+void I2c::evIrqHandler(I2c* i2c)
+{
+    // Check instance pointer
+    if (!i2c)
+        return;
+
+    const uint32_t port = i2c->config_.i2c;
+    switch (i2c->state_) {
+    case State::Start:
+    case State::Restart:
+        if (i2c_flag_get(port, I2C_FLAG_SBSEND)) {
+            // Reading from register starts with its writing
+            i2c->receiver_ = i2c->rx_ && (i2c->devReg_ < 0 || i2c->state_ == State::Restart);
+            i2c->state_ = State::SendAddress;
+            i2c_master_addressing(port, i2c->devAddr_,
+                i2c->receiver_ ? I2C_RECEIVER : I2C_TRANSMITTER);
+            if (i2c->receiver_ && !i2c->dma_)
+                i2c_interrupt_enable(port, I2C_INT_BUF);
+        }
+        break;
+
+    case State::SendAddress:
+        if (i2c_flag_get(port, I2C_FLAG_ADDSEND))
+            i2c->addressSent();
+        break;
+
+    case State::TransmitData:
+        i2c->transmitEvent();
+        break;
+
+    case State::ReceiveData:
+        i2c->receiveEvent();
+        break;
+
+    default:
+        // Unexpected event without transfer
+        i2c_interrupt_disable(port, I2C_INT_EV);
+        i2c_interrupt_disable(port, I2C_INT_BUF);
+        break;
+    }
+}
+
+void I2c::erIrqHandler(I2c* i2c)
+{
+    // Check instance pointer
+    if (!i2c)
+        return;
+
+    // Address or data not acknowledged, bus error or arbitration lost
+    const uint32_t port = i2c->config_.i2c;
+    i2c_flag_clear(port, I2C_FLAG_AERR);
+    i2c_flag_clear(port, I2C_FLAG_BERR);
+    i2c_flag_clear(port, I2C_FLAG_LOSTARB);
+    i2c_flag_clear(port, I2C_FLAG_OUERR);
+    if (i2c->state_ != State::Idle) {
+        i2c_stop_on_bus(port);
+        i2c->finish(-1);
+    }
+}
+
+extern "C" void I2C0_EV_IRQHandler(void)
+{
+    I2c::evIrqHandler(i2cInstances[0]);
+}
+
+extern "C" void I2C0_ER_IRQHandler(void)
+{
+    I2c::erIrqHandler(i2cInstances[0]);
+}
+
+extern "C" void I2C1_EV_IRQHandler(void)
+{
+    I2c::evIrqHandler(i2cInstances[1]);
+}
+
+extern "C" void I2C1_ER_IRQHandler(void)
+{
+    I2c::erIrqHandler(i2cInstances[1]);
+}
+
+#ifdef I2C2
+extern "C" void I2C2_EV_IRQHandler(void)
+{
+    I2c::evIrqHandler(i2cInstances[2]);
+}
+
+extern "C" void I2C2_ER_IRQHandler(void)
+{
+    I2c::erIrqHandler(i2cInstances[2]);
+}
+#endif
+
 }; // namespace gd32
 
 /***************************** END OF FILE ************************************/
@@ -8,6 +8,15 @@
 
 #include "periph/i2c.h"
 #include "gd32/gd32_types.h"
+#include "gd32/dma.h"
+
+#ifndef I2C_DMA_MIN
+#define I2C_DMA_MIN 4
+#endif
+
+#ifndef I2C_TIMEOUT_MS
+#define I2C_TIMEOUT_MS 100
+#endif
 
 namespace gd32 {
 
@@ -17,12 +26,20 @@ struct I2cConfig {
     GpioConfig scl;
     GpioConfig sda;
     I2cSpeed speed;
+    const DmaConfig* rxDma;     // Optional DMA channel for reception
+    const DmaConfig* txDma;     // Optional DMA channel for transmission
 };
 
-/// @brief GD32 I2C bus peripheral driver
+/**
+ * @brief GD32 I2C bus peripheral driver. Transfer is driven by event and
+ *      error IRQs, payload of I2C_DMA_MIN bytes and more is moved by DMA if
+ *      channel is set. Blocking calls wait for completion without polling of
+ *      bus flags, with FreeRTOS the calling task is blocked on semaphore.
+ *      Asynchronous calls are completed from IRQ
+ */
 class I2c : public ::I2c {
 public:
-    I2c() = default;
+    I2c();
 
     bool setConfig(const void* drvConfig) override;
     bool open() override;
@@ -30,11 +47,61 @@ public:
 
     bool ioctl(uint32_t cmd, void* pValue) override;
 
+    static void evIrqHandler(I2c* i2c);
+    static void erIrqHandler(I2c* i2c);
+
 private:
     int32_t write_(const void* buf, uint32_t len) override;
     int32_t read_(void* buf, uint32_t len) override;
+    int32_t writev_(const WriteVec* vec, uint32_t count) override;
+    int32_t readv_(const ReadVec* vec, uint32_t count) override;
+    DrvResult writeAsync_(const void* buf, uint32_t len) override;
+    DrvResult readAsync_(void* buf, uint32_t len) override;
+
+    enum class State : uint8_t {
+        Idle,
+        Start,
+        Restart,
+        SendAddress,
+        TransmitData,
+        ReceiveData,
+    };
+
+    bool start(const WriteVec* txVec, const ReadVec* rxVec, uint32_t count, bool async);
+    int32_t wait();
+    void abort();
+    void finish(int32_t res);
+    void release();
+
+    void transmitEvent();
+    void receiveEvent();
+    void addressSent();
+    void receiveByte();
+
+    void rxDmaHandler(uint32_t events);
+    void txDmaHandler(uint32_t events);
 
     I2cConfig config_;
+    volatile State state_;
+    bool receiver_;
+    bool rx_;
+    bool dma_;
+    bool async_;
+    int32_t devAddr_;
+    int32_t devReg_;
+    const WriteVec* txVec_;
+    const ReadVec* rxVec_;
+    WriteVec txSingle_;
+    ReadVec rxSingle_;
+    uint32_t count_;
+    uint32_t seg_;
+    uint32_t pos_;
+    uint32_t len_;
+    uint32_t cnt_;
+    volatile int32_t result_;
+#if defined(FREERTOS_USED)
+    SemaphoreHandle_t done_;
+#endif
 };
 
 }; // namespace gd32
@@ -5,11 +5,21 @@
  ******************************************************************************/
 
 #include "gd32/spi.h"
+#include "timing.h"
 
 #include <cassert>
 
 namespace gd32 {
 
+/// @brief Maximum frames count of single DMA transfer
+static constexpr uint32_t kDmaChunkMax = 0xFFFF;
+
+/// @brief Frame sent when caller has no data to send
+static const uint16_t dmaTxDummy = 0xFFFF;
+
+/// @brief Frame storage when caller drops received data
+static uint16_t dmaRxDummy;
+
 static bool checkConfig(const gd32::SpiConfig* config)
 {
     assert(config != nullptr);
@@ -19,6 +29,9 @@ static bool checkConfig(const gd32::SpiConfig* config)
 P_Spi::P_Spi(ISpiQueue& rx)
     : rxQueue_(rx)
 {
+#if defined(FREERTOS_USED)
+    dmaDone_ = xSemaphoreCreateBinary();
+#endif
 }
 
 bool P_Spi::setConfig(const void* drvConfig)
@@ -101,6 +114,17 @@ bool P_Spi::open()
 
     spi_init(config_.spi, &spiParams);
     spi_enable(config_.spi);
+
+    // Transfers work without DMA if any channel is unavailable
+    if (config_.rxDma != nullptr && config_.txDma != nullptr
+        && initDmaPeriph(config_.rxDma, DmaDelegate::create<P_Spi, &P_Spi::rxDmaHandler>(*this))) {
+        if (!initDmaPeriph(config_.txDma, DmaDelegate::create<P_Spi, &P_Spi::txDmaHandler>(*this))) {
+            deinitDmaPeriph(config_.rxDma);
+            config_.rxDma = nullptr;
+        }
+    } else {
+        config_.rxDma = nullptr;
+    }
     setOpened(true);
     return true;
 }
@@ -108,6 +132,10 @@ bool P_Spi::open()
 void P_Spi::close()
 {
     if (isOpen()) {
+        if (isDma()) {
+            deinitDmaPeriph(config_.rxDma);
+            deinitDmaPeriph(config_.txDma);
+        }
         spi_disable(config_.spi);
         deinitGpioPeriph(&config_.clk);
         deinitGpioPeriph(&config_.mosi);
@@ -120,13 +148,17 @@ int32_t P_Spi::write_(const void* buf, uint32_t len)
 {
     assert(buf != nullptr);
 
+    const WriteVec vec = { buf, len };
+    return writev_(&vec, 1);
+}
+
+int32_t P_Spi::writev_(const WriteVec* vec, uint32_t count)
+{
     if (!isOpen())
         return -1;
 
-    const uint8_t* bytes = static_cast<const uint8_t*>(buf);
-    const uint16_t* halfwords = static_cast<const uint16_t*>(buf);
-    const uint32_t* words = static_cast<const uint32_t*>(buf);
     const int32_t reg = getReg();
+    uint32_t len = 0;
 
     // Set chip select
     if (cs_)
@@ -143,17 +175,25 @@ int32_t P_Spi::write_(const void* buf, uint32_t len)
         while (SET == spi_i2s_flag_get(config_.spi, SPI_FLAG_TRANS));
     }
 
-    // Send and receive data
-    for (uint32_t i = 0; i < len; ++i) {
-        if (config_.frame == SpiFrame::Frame32Bit) {
-            readWrite(words[i] >> 16);
-            readWrite(words[i]);
-        } else if (config_.frame == SpiFrame::Frame16Bit) {
-            readWrite(halfwords[i]);
-        } else {
-            readWrite(bytes[i]);
+    // Send and receive data of all segments under single chip select
+    for (uint32_t seg = 0; seg < count; ++seg) {
+        assert(vec[seg].buf != nullptr);
+        const uint8_t* bytes = static_cast<const uint8_t*>(vec[seg].buf);
+        const uint16_t* halfwords = static_cast<const uint16_t*>(vec[seg].buf);
+        const uint32_t* words = static_cast<const uint32_t*>(vec[seg].buf);
+
+        for (uint32_t i = 0; i < vec[seg].len; ++i) {
+            if (config_.frame == SpiFrame::Frame32Bit) {
+                readWrite(words[i] >> 16);
+                readWrite(words[i]);
+            } else if (config_.frame == SpiFrame::Frame16Bit) {
+                readWrite(halfwords[i]);
+            } else {
+                readWrite(bytes[i]);
+            }
+            while (SET == spi_i2s_flag_get(config_.spi, SPI_FLAG_TRANS));
         }
-        while (SET == spi_i2s_flag_get(config_.spi, SPI_FLAG_TRANS));
+        len += vec[seg].len;
     }
 
     // Reset chip select
@@ -195,6 +235,26 @@ int32_t P_Spi::read_(void* buf, uint32_t len)
     return size;
 }
 
+int32_t P_Spi::readv_(const ReadVec* vec, uint32_t count)
+{
+    if (!isOpen())
+        return -1;
+
+    // Received frames are taken from queue segment by segment
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (vec[i].len == 0)
+            continue;
+        const int32_t readed = read_(vec[i].buf, vec[i].len);
+        if (readed <= 0)
+            break;
+        size += readed;
+        if (static_cast<uint32_t>(readed) < vec[i].len)
+            break;
+    }
+    return size;
+}
+
 bool P_Spi::ioctl(uint32_t cmd, void* pValue)
 {
     if (!isOpen())
@@ -217,17 +277,214 @@ bool P_Spi::ioctl(uint32_t cmd, void* pValue)
     return false;
 }
 
+int32_t P_Spi::transfer_(const void* tx, void* rx, uint32_t len, uint32_t width, Gpio* cs)
+{
+    const uint32_t frameBytes = static_cast<uint32_t>(config_.frame) / 8;
+    if (!isOpen() || len == 0 || width != frameBytes)
+        return -1;
+
+    // Device chip select is set for this transfer only
+    Gpio* pin = cs != nullptr ? cs : cs_;
+    if (pin)
+        pin->reset();
+
+    // 32-bit frames are sent as two halfwords with high one first, DMA
+    // can't swap them, so they are always moved by CPU
+    int32_t res = len;
+    if (isDma() && len >= SPI_DMA_MIN && config_.frame != SpiFrame::Frame32Bit) {
+        res = transferDma(tx, rx, len);
+    } else {
+        transferPoll(tx, rx, len);
+    }
+
+    if (pin)
+        pin->set();
+
+    return res;
+}
+
 void P_Spi::readWrite(uint16_t data, bool save)
+{
+    const uint16_t word = exchange(data);
+    if (save && config_.miso.port != 0 && !rxQueue_.full()) {
+        rxQueue_.push(word);
+    }
+}
+
+/**
+ * @brief Sends one bus frame and waits for its completion
+ *
+ * @param data frame to send
+ * @return uint16_t received frame, zero without MISO line
+ */
+uint16_t P_Spi::exchange(uint16_t data)
 {
     spi_i2s_data_transmit(config_.spi, data);
     if (config_.miso.port != 0) {
         while (RESET == spi_i2s_flag_get(config_.spi, SPI_FLAG_RBNE));
-        const uint16_t word = spi_i2s_data_receive(config_.spi);
-        if (save && !rxQueue_.full()) {
-            rxQueue_.push(word);
+        return spi_i2s_data_receive(config_.spi);
+    }
+    while (RESET == spi_i2s_flag_get(config_.spi, SPI_FLAG_TBE));
+    return 0;
+}
+
+/**
+ * @brief Checks that DMA channels are available for transfers
+ *
+ * @return true if DMA used otherwise false
+ */
+bool P_Spi::isDma() const
+{
+    return config_.rxDma != nullptr && config_.txDma != nullptr;
+}
+
+/**
+ * @brief Moves frames between caller buffers and bus by CPU
+ *
+ * @param tx frames to send, nullptr for dummy frames
+ * @param rx buffer for received frames, nullptr to drop them
+ * @param len frames count
+ */
+void P_Spi::transferPoll(const void* tx, void* rx, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i) {
+        if (config_.frame == SpiFrame::Frame32Bit) {
+            const uint32_t word = tx ? static_cast<const uint32_t*>(tx)[i] : 0xFFFFFFFF;
+            const uint16_t high = exchange(word >> 16);
+            const uint16_t low = exchange(word);
+            if (rx)
+                static_cast<uint32_t*>(rx)[i] = (static_cast<uint32_t>(high) << 16) | low;
+        } else if (config_.frame == SpiFrame::Frame16Bit) {
+            const uint16_t word = exchange(tx ? static_cast<const uint16_t*>(tx)[i] : dmaTxDummy);
+            if (rx)
+                static_cast<uint16_t*>(rx)[i] = word;
+        } else {
+            const uint8_t byte = exchange(tx ? static_cast<const uint8_t*>(tx)[i] : dmaTxDummy);
+            if (rx)
+                static_cast<uint8_t*>(rx)[i] = byte;
+        }
+    }
+    while (SET == spi_i2s_flag_get(config_.spi, SPI_FLAG_TRANS));
+}
+
+/**
+ * @brief Moves frames between caller buffers and bus by DMA. Reception
+ *      channel always runs, so its completion means the end of transfer.
+ *      With FreeRTOS the calling task is blocked until completion
+ *
+ * @param tx frames to send, nullptr for dummy frames
+ * @param rx buffer for received frames, nullptr to drop them
+ * @param len frames count
+ * @return int32_t transferred frames count, -1 on error or timeout
+ */
+int32_t P_Spi::transferDma(const void* tx, void* rx, uint32_t len)
+{
+    // Drop stale frame before transfer
+    while (SET == spi_i2s_flag_get(config_.spi, SPI_FLAG_RBNE)) {
+        spi_i2s_data_receive(config_.spi);
+    }
+#if defined(FREERTOS_USED)
+    xSemaphoreTake(dmaDone_, 0);
+#endif
+
+    dmaTx_ = static_cast<const uint8_t*>(tx);
+    dmaRx_ = static_cast<uint8_t*>(rx);
+    dmaRest_ = len;
+    dmaResult_ = len;
+    dmaBusy_ = true;
+
+    spi_dma_enable(config_.spi, SPI_DMA_RECEIVE);
+    spi_dma_enable(config_.spi, SPI_DMA_TRANSMIT);
+    dmaNext();
+
+#if defined(FREERTOS_USED)
+    const bool done = xSemaphoreTake(dmaDone_, pdMS_TO_TICKS(SPI_TIMEOUT_MS)) == pdTRUE;
+#else
+    const Time startTime = Time::now();
+    bool done = true;
+    while (dmaBusy_) {
+        if ((Time::now() - startTime).toMsec() >= SPI_TIMEOUT_MS) {
+            done = false;
+            break;
+        }
+    }
+#endif
+    if (!done) {
+        stopDma(config_.rxDma);
+        stopDma(config_.txDma);
+        dmaBusy_ = false;
+        dmaResult_ = -1;
+    }
+
+    spi_dma_disable(config_.spi, SPI_DMA_TRANSMIT);
+    spi_dma_disable(config_.spi, SPI_DMA_RECEIVE);
+    while (SET == spi_i2s_flag_get(config_.spi, SPI_FLAG_TRANS));
+    return dmaResult_;
+}
+
+/**
+ * @brief Starts the next chunk of DMA transfer. Reception is started first,
+ *      so no received frame is lost
+ */
+void P_Spi::dmaNext()
+{
+    const DmaWidth width = config_.frame == SpiFrame::Frame16Bit
+        ? DmaWidth::Bits16 : DmaWidth::Bits8;
+    const uint32_t dataAddr = reinterpret_cast<uintptr_t>(&SPI_DATA(config_.spi));
+
+    dmaChunk_ = dmaRest_ < kDmaChunkMax ? dmaRest_ : kDmaChunkMax;
+    startDma(config_.rxDma, DmaDir::PeriphToMemory, dataAddr,
+        dmaRx_ ? static_cast<const void*>(dmaRx_) : &dmaRxDummy,
+        dmaChunk_, width, false, dmaRx_ != nullptr);
+    startDma(config_.txDma, DmaDir::MemoryToPeriph, dataAddr,
+        dmaTx_ ? static_cast<const void*>(dmaTx_) : &dmaTxDummy,
+        dmaChunk_, width, false, dmaTx_ != nullptr);
+}
+
+void P_Spi::rxDmaHandler(uint32_t events)
+{
+    if (!dmaBusy_)
+        return;
+
+    if (events & kDmaError) {
+        stopDma(config_.txDma);
+        dmaResult_ = -1;
+    } else if (events & kDmaFull) {
+        // Long transfer continues from the next chunk
+        const uint32_t frameBytes = static_cast<uint32_t>(config_.frame) / 8;
+        dmaRest_ -= dmaChunk_;
+        if (dmaTx_)
+            dmaTx_ += dmaChunk_ * frameBytes;
+        if (dmaRx_)
+            dmaRx_ += dmaChunk_ * frameBytes;
+        if (dmaRest_ != 0) {
+            dmaNext();
+            return;
         }
     } else {
-        while (RESET == spi_i2s_flag_get(config_.spi, SPI_FLAG_TBE));
+        return;
+    }
+
+    dmaBusy_ = false;
+#if defined(FREERTOS_USED)
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(dmaDone_, &woken);
+    portYIELD_FROM_ISR(woken);
+#endif
+}
+
+void P_Spi::txDmaHandler(uint32_t events)
+{
+    // Completion is handled by reception channel
+    if (dmaBusy_ && (events & kDmaError)) {
+        stopDma(config_.rxDma);
+        dmaResult_ = -1;
+        dmaBusy_ = false;
+#if defined(FREERTOS_USED)
+        BaseType_t woken = pdFALSE;
+        xSemaphoreGiveFromISR(dmaDone_, &woken);
+        portYIELD_FROM_ISR(woken);
+#endif
     }
 }
 
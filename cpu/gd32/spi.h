@@ -8,9 +8,18 @@
 
 #include "periph/spi.h"
 #include "gd32/gd32_types.h"
+#include "gd32/dma.h"
 #include "periph/gpio.h"
 #include "etl/queue.h"
 
+#ifndef SPI_DMA_MIN
+#define SPI_DMA_MIN 8
+#endif
+
+#ifndef SPI_TIMEOUT_MS
+#define SPI_TIMEOUT_MS 1000
+#endif
+
 namespace gd32 {
 
 enum class SpiPrescaler {
@@ -33,6 +42,8 @@ struct SpiConfig {
     GpioConfig clk;
     GpioConfig mosi;
     GpioConfig miso;
+    const DmaConfig* rxDma;     // Optional DMA channels for transfer(),
+    const DmaConfig* txDma;     // both must be set
 };
 
 /// @brief Private realization of GD32 SPI bus peripheral driver
@@ -51,12 +62,33 @@ public:
 private:
     int32_t write_(const void* buf, uint32_t len) override;
     int32_t read_(void* buf, uint32_t len) override;
+    int32_t writev_(const WriteVec* vec, uint32_t count) override;
+    int32_t readv_(const ReadVec* vec, uint32_t count) override;
+    int32_t transfer_(const void* tx, void* rx, uint32_t len, uint32_t width, Gpio* cs) override;
 
     void readWrite(uint16_t data, bool save = true);
+    uint16_t exchange(uint16_t data);
+
+    bool isDma() const;
+    int32_t transferDma(const void* tx, void* rx, uint32_t len);
+    void transferPoll(const void* tx, void* rx, uint32_t len);
+    void dmaNext();
+    void rxDmaHandler(uint32_t events);
+    void txDmaHandler(uint32_t events);
 
     SpiConfig config_;
     ISpiQueue& rxQueue_;
     Gpio *cs_ = nullptr;
+
+    const uint8_t* dmaTx_ = nullptr;
+    uint8_t* dmaRx_ = nullptr;
+    uint32_t dmaRest_ = 0;
+    uint32_t dmaChunk_ = 0;
+    volatile int32_t dmaResult_ = 0;
+    volatile bool dmaBusy_ = false;
+#if defined(FREERTOS_USED)
+    SemaphoreHandle_t dmaDone_;
+#endif
 };
 
 /// @brief GD32 SPI bus peripheral driver
@@ -13,7 +13,7 @@
 
 extern uint32_t SystemCoreClock;
 
-RETAIN_NOINIT_ATTR static uint32_t sysTime;
+RETAIN_NOINIT_ATTR static volatile uint32_t sysTime;
 
 /**
  * @brief Sets system frequency with chosen frequency in Hz and source
@@ -394,9 +394,26 @@ void System::goToSleep() const
  */
 extern "C" int _gettimeofday(struct timeval *tv, void *tzvp)
 {
-    const uint32_t t = sysTime;
+    // SysTick counts down inside the current millisecond. Read it between two
+    // time reads to be sure that millisecond wasn't changed meanwhile. With
+    // masked interrupts or from higher priority IRQ the counter can be
+    // reloaded while its IRQ is pending, then counter is read again after
+    // reload and pending millisecond is added
+    uint32_t t, ticks;
+    bool pending;
+    do {
+        t = sysTime;
+        ticks = SysTick->VAL;
+        pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+        if (pending)
+            ticks = SysTick->VAL;
+    } while (t != sysTime);
+    if (pending)
+        ++t;
+
+    const uint32_t load = SysTick->LOAD + 1;
     tv->tv_sec = t / 1000;
-    tv->tv_usec = ( t % 1000 ) * 1000;
+    tv->tv_usec = ( t % 1000 ) * 1000 + (load - 1 - ticks) * 1000 / load;
     return 0;
 }
 
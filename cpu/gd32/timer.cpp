@@ -113,7 +113,7 @@ static void setIrq(const gd32::TimerConfig& config, bool state)
     case TIMER0:
         if (config.mode == TimerMode::General) {
             irqType = TIMER0_UP_IRQn;
-        } else if (config.mode == TimerMode::Capture) {
+        } else if (config.mode == TimerMode::Capture || config.mode == TimerMode::Compare) {
             irqType = TIMER0_Channel_IRQn;
         } else if (config.mode == TimerMode::GeneralAndCapture) {
             irqType = TIMER0_UP_IRQn;
@@ -131,7 +131,7 @@ static void setIrq(const gd32::TimerConfig& config, bool state)
     case TIMER7:
         if (config.mode == TimerMode::General) {
             irqType = TIMER7_UP_IRQn;
-        } else if (config.mode == TimerMode::Capture) {
+        } else if (config.mode == TimerMode::Capture || config.mode == TimerMode::Compare) {
             irqType = TIMER7_Channel_IRQn;
         } else if (config.mode == TimerMode::GeneralAndCapture) {
             irqType = TIMER7_UP_IRQn;
@@ -163,6 +163,87 @@ static void setIrq(const gd32::TimerConfig& config, bool state)
     }
 }
 
+/**
+ * @brief Returns interrupt flag of timer channel
+ *
+ * @param channel timer channel
+ * @return uint32_t interrupt flag
+ */
+static uint32_t channelIrqFlag(uint16_t channel)
+{
+    switch (channel) {
+    default:
+    case TIMER_CH_0: return TIMER_INT_FLAG_CH0;
+    case TIMER_CH_1: return TIMER_INT_FLAG_CH1;
+    case TIMER_CH_2: return TIMER_INT_FLAG_CH2;
+    case TIMER_CH_3: return TIMER_INT_FLAG_CH3;
+    }
+}
+
+/**
+ * @brief Returns software event of timer channel
+ *
+ * @param channel timer channel
+ * @return uint16_t software event
+ */
+static uint16_t channelEvent(uint16_t channel)
+{
+    switch (channel) {
+    default:
+    case TIMER_CH_0: return TIMER_EVENT_SRC_CH0G;
+    case TIMER_CH_1: return TIMER_EVENT_SRC_CH1G;
+    case TIMER_CH_2: return TIMER_EVENT_SRC_CH2G;
+    case TIMER_CH_3: return TIMER_EVENT_SRC_CH3G;
+    }
+}
+
+/**
+ * @brief Returns DMA request of timer channel capture
+ *
+ * @param channel timer channel
+ * @return uint32_t DMA request
+ */
+static uint32_t captureDmaRequest(uint16_t channel)
+{
+    switch (channel) {
+    default:
+    case TIMER_CH_0: return TIMER_DMA_CH0D;
+    case TIMER_CH_1: return TIMER_DMA_CH1D;
+    case TIMER_CH_2: return TIMER_DMA_CH2D;
+    case TIMER_CH_3: return TIMER_DMA_CH3D;
+    }
+}
+
+/**
+ * @brief Returns address of timer channel capture or compare value register
+ *
+ * @param timer timer periph
+ * @param channel timer channel
+ * @return uint32_t register address
+ */
+static uint32_t channelRegister(uint32_t timer, uint16_t channel)
+{
+    switch (channel) {
+    default:
+    case TIMER_CH_0: return reinterpret_cast<uintptr_t>(&TIMER_CH0CV(timer));
+    case TIMER_CH_1: return reinterpret_cast<uintptr_t>(&TIMER_CH1CV(timer));
+    case TIMER_CH_2: return reinterpret_cast<uintptr_t>(&TIMER_CH2CV(timer));
+    case TIMER_CH_3: return reinterpret_cast<uintptr_t>(&TIMER_CH3CV(timer));
+    }
+}
+
+/**
+ * @brief Construct a new Timer object with ring of captured edges
+ *
+ * @param ring ring buffer
+ * @param ringSize edges count of ring, power of two
+ */
+Timer::Timer(uint32_t* ring, uint32_t ringSize)
+    : ring_(ring)
+    , ringSize_(ringSize)
+{
+}
+
 /**
  * @brief Set current driver configuration for further usage
  *
@@ -214,21 +295,27 @@ bool Timer::open()
     case TimerMode::Capture:
     case TimerMode::GeneralAndCapture:
         timer_ic_parameter_struct timer_icinitpara;
-        timer_icinitpara.icpolarity = TIMER_IC_POLARITY_RISING;
+        timer_icinitpara.icpolarity = config_.icPolarity;
         timer_icinitpara.icselection = TIMER_IC_SELECTION_DIRECTTI;
         timer_icinitpara.icprescaler = TIMER_IC_PSC_DIV1;
         timer_icinitpara.icfilter = 0;
         timer_input_capture_config(config_.timer, config_.channel, &timer_icinitpara);
+        irqFlag_ = channelIrqFlag(config_.channel);
 
-        switch (config_.channel) {
-        default:
-        case TIMER_CH_0: irqFlag_ = TIMER_INT_FLAG_CH0; break;
-        case TIMER_CH_1: irqFlag_ = TIMER_INT_FLAG_CH1; break;
-        case TIMER_CH_2: irqFlag_ = TIMER_INT_FLAG_CH2; break;
-        case TIMER_CH_3: irqFlag_ = TIMER_INT_FLAG_CH3; break;
+        // DMA helper works on GD32F4xx with DMA_USED only, otherwise
+        // initialization fails and ring is filled by capture IRQ
+        if (ring_ != nullptr && config_.dma != nullptr) {
+            dma_ = initDmaPeriph(config_.dma,
+                DmaDelegate::create<Timer, &Timer::captureDmaHandler>(*this));
         }
         break;
 
+    case TimerMode::Compare:
+        timer_channel_output_mode_config(config_.timer, config_.channel, TIMER_OC_MODE_TIMING);
+        timer_channel_output_shadow_config(config_.timer, config_.channel, TIMER_OC_SHADOW_DISABLE);
+        irqFlag_ = channelIrqFlag(config_.channel);
+        break;
+
     case TimerMode::Pwm:
         timer_oc_parameter_struct timer_ocintpara;
         timer_ocintpara.ocpolarity = TIMER_OC_POLARITY_HIGH;
@@ -257,6 +344,10 @@ void Timer::close()
 {
     if (isOpen()) {
         timer_disable(config_.timer);
+        if (dma_) {
+            deinitDmaPeriph(config_.dma);
+            dma_ = false;
+        }
         timer_deinit(config_.timer);
         deinitGpioPeriph(&config_.pin);
         setIrq(config_, false);
@@ -278,9 +369,17 @@ void Timer::start()
         || config_.mode == TimerMode::GeneralAndCapture) {
         timer_interrupt_enable(config_.timer, TIMER_INT_FLAG_UP);
     }
-    if (config_.mode == TimerMode::Capture
-        || config_.mode == TimerMode::GeneralAndCapture) {
-        timer_interrupt_enable(config_.timer, irqFlag_);
+    if (isCaptureMode()) {
+        // Ring starts empty, so DMA position matches ring indexes
+        head_ = 0;
+        tail_ = 0;
+        if (dma_) {
+            startDma(config_.dma, DmaDir::PeriphToMemory, channelRegister(config_.timer, config_.channel),
+                ring_, ringSize_, DmaWidth::Bits32, true);
+            timer_dma_enable(config_.timer, captureDmaRequest(config_.channel));
+        } else {
+            timer_interrupt_enable(config_.timer, irqFlag_);
+        }
     }
     timer_enable(config_.timer);
 }
@@ -297,10 +396,16 @@ void Timer::stop()
         || config_.mode == TimerMode::GeneralAndCapture) {
         timer_interrupt_disable(config_.timer, TIMER_INT_FLAG_UP);
     }
-    if (config_.mode == TimerMode::Capture
-        || config_.mode == TimerMode::GeneralAndCapture) {
-        timer_interrupt_disable(config_.timer, irqFlag_);
+    if (isCaptureMode()) {
+        if (dma_) {
+            timer_dma_disable(config_.timer, captureDmaRequest(config_.channel));
+            stopDma(config_.dma);
+        } else {
+            timer_interrupt_disable(config_.timer, irqFlag_);
+        }
     }
+    if (config_.mode == TimerMode::Compare)
+        timer_interrupt_disable(config_.timer, irqFlag_);
     timer_disable(config_.timer);
 }
 
@@ -334,6 +439,185 @@ uint32_t Timer::counter() const
     return timer_counter_read(config_.timer);
 }
 
+/**
+ * @brief Takes captured edges from ring in order of capture. Edges are
+ *      timer counter values, so interval between edges is their difference
+ *      modulo timer period. When ring is overrun, DMA overwrites the oldest
+ *      edges and IRQ drops the newest ones, lost edges are counted by
+ *      captureOverruns()
+ *
+ * @param edges buffer for edges
+ * @param max buffer size
+ * @return uint32_t edges count
+ */
+uint32_t Timer::readCaptures(uint32_t* edges, uint32_t max)
+{
+    if (ring_ == nullptr || edges == nullptr)
+        return 0;
+
+    const uint32_t head = captureHead();
+    uint32_t tail = tail_;
+    if (head - tail > ringSize_) {
+        overruns_ += head - tail - ringSize_;
+        tail = head - ringSize_;
+    }
+
+    uint32_t count = head - tail;
+    if (count > max)
+        count = max;
+    for (uint32_t i = 0; i < count; ++i) {
+        edges[i] = ring_[(tail + i) & (ringSize_ - 1)];
+    }
+    tail_ = tail + count;
+    return count;
+}
+
+/**
+ * @brief Returns count of captured edges ready for reading
+ *
+ * @return uint32_t edges count
+ */
+uint32_t Timer::capturesAvailable() const
+{
+    if (ring_ == nullptr)
+        return 0;
+
+    const uint32_t count = captureHead() - tail_;
+    return count > ringSize_ ? ringSize_ : count;
+}
+
+/**
+ * @brief Returns count of edges lost by ring overrun
+ *
+ * @return uint32_t edges count
+ */
+uint32_t Timer::captureOverruns() const
+{
+    return overruns_;
+}
+
+/**
+ * @brief Sets the callback for filled half of captures ring
+ *
+ * @param blockCb callback delegate
+ */
+void Timer::setCaptureBlockDelegate(const CaptureBlockDelegate& blockCb)
+{
+    blockCb_ = blockCb;
+}
+
+/**
+ * @brief Sets channel compare value and enables compare IRQ, which calls
+ *      compare delegate when counter reaches the value
+ *
+ * @param value compare value
+ */
+void Timer::setCompare(uint32_t value)
+{
+    if (config_.mode != TimerMode::Compare)
+        return;
+
+    timer_channel_output_pulse_value_config(config_.timer, config_.channel, value);
+    timer_interrupt_flag_clear(config_.timer, irqFlag_);
+    timer_interrupt_enable(config_.timer, irqFlag_);
+}
+
+/**
+ * @brief Raises compare IRQ at once, e.g. when compare value was set too
+ *      late and counter has passed it
+ */
+void Timer::triggerCompare()
+{
+    if (config_.mode != TimerMode::Compare)
+        return;
+
+    timer_interrupt_enable(config_.timer, irqFlag_);
+    timer_event_software_generate(config_.timer, channelEvent(config_.channel));
+}
+
+/**
+ * @brief Disables compare IRQ
+ */
+void Timer::disableCompare()
+{
+    if (config_.mode != TimerMode::Compare)
+        return;
+
+    timer_interrupt_disable(config_.timer, irqFlag_);
+    timer_interrupt_flag_clear(config_.timer, irqFlag_);
+}
+
+/**
+ * @brief Sets the callback for compare IRQ
+ *
+ * @param compareCb callback delegate
+ */
+void Timer::setCompareDelegate(const GeneralDelegate& compareCb)
+{
+    compareCb_ = compareCb;
+}
+
+/**
+ * @brief Checks that capture channel is used in current mode
+ *
+ * @return true if capture is used otherwise false
+ */
+bool Timer::isCaptureMode() const
+{
+    return config_.mode == TimerMode::Capture
+        || config_.mode == TimerMode::GeneralAndCapture;
+}
+
+/**
+ * @brief Returns count of written edges. With DMA it is advanced by half of
+ *      ring in DMA IRQ and position inside of current half is taken from DMA
+ *      counter
+ *
+ * @return uint32_t edges count
+ */
+uint32_t Timer::captureHead() const
+{
+    const uint32_t head = head_;
+    if (!dma_)
+        return head;
+    return DmaRing::written(head, dmaRemaining(config_.dma), ringSize_);
+}
+
+/**
+ * @brief Puts captured edge into ring from capture IRQ
+ *
+ * @param value captured counter value
+ */
+void Timer::pushCapture(uint32_t value)
+{
+    const uint32_t head = head_;
+    if (head - tail_ >= ringSize_) {
+        ++overruns_;
+        return;
+    }
+
+    ring_[head & (ringSize_ - 1)] = value;
+    head_ = head + 1;
+    if (head + 1 - tail_ == ringSize_ / 2)
+        blockCb_.call_if(ringSize_ / 2);
+}
+
+/**
+ * @brief Capture DMA IRQ handler, each of half and full events means half
+ *      of ring filled
+ *
+ * @param events DMA events
+ */
+void Timer::captureDmaHandler(uint32_t events)
+{
+    if (events & kDmaHalf)
+        head_ = head_ + ringSize_ / 2;
+    if (events & kDmaFull)
+        head_ = head_ + ringSize_ / 2;
+    if (events & (kDmaHalf | kDmaFull))
+        blockCb_.call_if(capturesAvailable());
+}
+
 /**
  * @brief Execute chosen command on driver
  *
@@ -391,11 +675,18 @@ void Timer::irqHandler(Timer* timer)
 
     if (timer_interrupt_flag_get(timer->config_.timer, timer->irqFlag_) == SET) {
         timer_interrupt_flag_clear(timer->config_.timer, timer->irqFlag_);
-        if (timer->config_.mode == TimerMode::Capture
-            || timer->config_.mode == TimerMode::GeneralAndCapture) {
-            timer->captured_ = timer_channel_capture_value_register_read(
-                timer->config_.timer, timer->config_.channel) + 1;
-            timer->captureCb().call_if(timer->captured_);
+        if (timer->isCaptureMode()) {
+            const uint32_t value = timer_channel_capture_value_register_read(
+                timer->config_.timer, timer->config_.channel);
+            timer->captured_ = value + 1;
+            if (timer->ring_ != nullptr) {
+                // Edge is recorded without callback, consumer takes batches
+                timer->pushCapture(value);
+            } else {
+                timer->captureCb().call_if(timer->captured_);
+            }
+        } else if (timer->config_.mode == TimerMode::Compare) {
+            timer->compareCb_.call_if();
         }
     }
 }
@@ -7,7 +7,9 @@
 #pragma once
 
 #include "periph/timer.h"
+#include "periph/dmaring.h"
 #include "gd32/gd32_types.h"
+#include "gd32/dma.h"
 
 namespace gd32 {
 
@@ -20,11 +22,19 @@ struct TimerConfig {
     uint32_t pwmValue;
     TimerMode mode;
     GpioConfig pin;
+    uint16_t icPolarity;        // Capture edge, rising by default
+    const DmaConfig* dma;       // Optional DMA channel for capture ring
 };
 
 /// @brief GD32 Timer peripheral driver
 class Timer : public ::Timer {
 public:
+    /**
+     * @brief Callback for captured edges in ring with count of edges ready
+     *      for reading. Called from IRQ when half of ring is filled
+     */
+    using CaptureBlockDelegate = etl::delegate<void(uint32_t)>;
+
     Timer() = default;
 
     bool setConfig(const void* drvConfig) override;
@@ -40,12 +50,62 @@ public:
     void setCounter(uint32_t counter) override;
     uint32_t counter() const override;
 
+    uint32_t readCaptures(uint32_t* edges, uint32_t max);
+    uint32_t capturesAvailable() const;
+    uint32_t captureOverruns() const;
+    void setCaptureBlockDelegate(const CaptureBlockDelegate& blockCb);
+
+    void setCompare(uint32_t value);
+    void triggerCompare();
+    void disableCompare();
+    void setCompareDelegate(const GeneralDelegate& compareCb);
+
     static void irqHandler(Timer* timer);
 
+protected:
+    Timer(uint32_t* ring, uint32_t ringSize);
+
 private:
+    bool isCaptureMode() const;
+    uint32_t captureHead() const;
+    void pushCapture(uint32_t value);
+    void captureDmaHandler(uint32_t events);
+
     TimerConfig config_;
     uint32_t irqFlag_ = 0;
     uint32_t captured_ = 0;
+
+    uint32_t* ring_ = nullptr;
+    uint32_t ringSize_ = 0;
+    volatile uint32_t head_ = 0;    // Count of written edges
+    volatile uint32_t tail_ = 0;    // Count of read edges
+    uint32_t overruns_ = 0;
+    bool dma_ = false;
+    CaptureBlockDelegate blockCb_;
+
+    GeneralDelegate compareCb_;
+};
+
+/**
+ * @brief GD32 timer with ring of captured edges. Edges are recorded by DMA
+ *      when configuration has DMA channel and DMA helper supports part
+ *      (GD32F4xx only), otherwise by capture IRQ without per edge callback. Consumer reads them in
+ *      batches by readCaptures(), e.g. after block delegate
+ *
+ * @tparam SIZE edges count of ring, power of two
+ */
+template <size_t SIZE>
+class CaptureTimer final : public Timer {
+public:
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "Ring size must be power of two");
+
+    CaptureTimer()
+        : Timer(ring_, SIZE)
+    {
+    }
+
+private:
+    uint32_t ring_[SIZE];
 };
 
 }; // namespace gd32
@@ -6,8 +6,10 @@
 
 #include "gd32/uart.h"
 #include "gd32/gd32_types.h"
+#include "timing.h"
 
 #include <cassert>
+#include <cstring>
 
 namespace gd32 {
 
@@ -99,9 +101,23 @@ static void setIrq(uint32_t port, bool enable)
     }
 }
 
-P_Uart::P_Uart(IUartQueue& tx, IUartQueue& rx)
-    : txQueue_(tx)
-    , rxQueue_(rx)
+P_Uart::P_Uart(IUartBuffer& tx, IUartBuffer& rx, uint8_t* dmaRx, uint32_t dmaRxSize)
+    : config_ {}
+    , txBuffer_(tx)
+    , rxBuffer_(rx)
+    , dmaRx_(dmaRx)
+    , dmaRxSize_(dmaRxSize)
+    , dmaRxRing_(dmaRxSize)
+    , rxOverruns_(0)
+    , rxAsyncBuf_(nullptr)
+    , rxAsyncLen_(0)
+    , txBusy_(false)
+    , txBlockRef_(false)
+    , txWritten_(0)
+    , txSent_(0)
+#if defined(RX_TIMESTAMP_USED)
+    , rxBurst_ {}
+#endif
 {
 }
 
@@ -136,8 +152,35 @@ bool P_Uart::open()
     usart_receive_config(config_.uart, USART_RECEIVE_ENABLE);
     usart_transmit_config(config_.uart, USART_TRANSMIT_ENABLE);
     usart_enable(config_.uart);
-    usart_interrupt_enable(config_.uart, USART_INT_RBNE);
     setHandler(config_.uart, this);
+
+    // With DMA reception only burst end is signaled by IDLE interrupt,
+    // otherwise each byte is received by own interrupt
+    if (isRxDma() && initDmaPeriph(config_.rxDma,
+            DmaDelegate::create<P_Uart, &P_Uart::rxDmaHandler>(*this))) {
+        dmaRxRing_.reset(dmaRxSize_);
+        startDma(config_.rxDma, DmaDir::PeriphToMemory,
+            reinterpret_cast<uintptr_t>(&USART_DATA(config_.uart)),
+            dmaRx_, dmaRxSize_, DmaWidth::Bits8, true);
+        usart_dma_receive_config(config_.uart, USART_DENR_ENABLE);
+        usart_interrupt_enable(config_.uart, USART_INT_IDLE);
+    } else {
+        config_.rxDma = nullptr;
+        usart_interrupt_enable(config_.uart, USART_INT_RBNE);
+#if defined(RX_TIMESTAMP_USED)
+        // Burst end for timestamps
+        usart_interrupt_enable(config_.uart, USART_INT_IDLE);
+#endif
+    }
+
+    // With DMA transmission TBE interrupt is not used at all
+    if (isTxDma() && initDmaPeriph(config_.txDma,
+            DmaDelegate::create<P_Uart, &P_Uart::txDmaHandler>(*this))) {
+        txBusy_.store(false);
+        usart_dma_transmit_config(config_.uart, USART_DENT_ENABLE);
+    } else {
+        config_.txDma = nullptr;
+    }
     setIrq(config_.uart, true);
     setOpened(true);
 
@@ -149,6 +192,14 @@ void P_Uart::close()
     if (isOpen()) {
         setIrq(config_.uart, false);
         setHandler(config_.uart, nullptr);
+        if (isRxDma()) {
+            usart_dma_receive_config(config_.uart, USART_DENR_DISABLE);
+            deinitDmaPeriph(config_.rxDma);
+        }
+        if (isTxDma()) {
+            usart_dma_transmit_config(config_.uart, USART_DENT_DISABLE);
+            deinitDmaPeriph(config_.txDma);
+        }
         usart_disable(config_.uart);
         usart_deinit(config_.uart);
         setOpened(false);
@@ -162,22 +213,35 @@ int32_t P_Uart::write_(const void* buf, uint32_t len)
     if (!isOpen() || len == 0)
         return -1;
 
-    // Fill transmit queue
-    __disable_irq();
-    const uint8_t *data = static_cast<const uint8_t*>(buf);
-    const uint32_t available = txQueue_.available();
-    const uint32_t size = available < len ? available : len;
-    for (uint32_t i = 0; i < size; ++i) {
-        txQueue_.push(data[i]);
+    const WriteVec vec = { buf, len };
+    return writev_(&vec, 1);
+}
+
+int32_t P_Uart::writev_(const WriteVec* vec, uint32_t count)
+{
+    if (!isOpen())
+        return -1;
+
+    // All segments are queued before single transmission start
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        assert(vec[i].buf != nullptr);
+        const uint32_t written = pushTx(static_cast<const uint8_t*>(vec[i].buf), vec[i].len);
+        size += written;
+        if (written < vec[i].len)
+            break;
     }
 
-    // Start transmission if it is idle
-    if (SET == usart_flag_get(config_.uart, USART_FLAG_TBE)) {
-        usart_data_transmit(config_.uart, txQueue_.front());
-        txQueue_.pop();
+    if (size == 0)
+        return size;
+
+    // Start transmission, TBE interrupt is raised at once if it is idle
+    if (isTxDma()) {
+        txWritten_ += size;
+        txDmaKick();
+    } else {
         usart_interrupt_enable(config_.uart, USART_INT_TBE);
     }
-    __enable_irq();
     return size;
 }
 
@@ -188,16 +252,66 @@ int32_t P_Uart::read_(void* buf, uint32_t len)
     if (!isOpen() || len == 0)
         return -1;
 
-    // Fill receive buffer from queue
-    __disable_irq();
-    uint8_t *data = static_cast<uint8_t*>(buf);
-    const uint32_t currSize = rxQueue_.size();
-    const uint32_t size = currSize < len ? currSize : len;
-    for (uint32_t i = 0; i < size; ++i) {
-        data[i] = rxQueue_.front();
-        rxQueue_.pop();
+    return popRx(static_cast<uint8_t*>(buf), len);
+}
+
+int32_t P_Uart::readv_(const ReadVec* vec, uint32_t count)
+{
+    if (!isOpen())
+        return -1;
+
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        assert(vec[i].buf != nullptr);
+        const uint32_t readed = popRx(static_cast<uint8_t*>(vec[i].buf), vec[i].len);
+        size += readed;
+        if (readed < vec[i].len)
+            break;
+    }
+    return size;
+}
+
+/**
+ * @brief Copies data into transmit buffer by contiguous blocks, it can be
+ *      wrapped once. Transmission isn't started
+ *
+ * @param data data buffer
+ * @param len data length
+ * @return uint32_t copied data length
+ */
+uint32_t P_Uart::pushTx(const uint8_t* data, uint32_t len)
+{
+    uint32_t size = 0;
+    while (size < len) {
+        etl::span<uint8_t> block = txBuffer_.write_reserve(len - size);
+        if (block.empty())
+            break;
+        memcpy(block.data(), &data[size], block.size());
+        txBuffer_.write_commit(block);
+        size += block.size();
+    }
+    return size;
+}
+
+/**
+ * @brief Copies data from receive buffer by contiguous blocks, it can be
+ *      wrapped once
+ *
+ * @param data data buffer
+ * @param len data buffer length
+ * @return uint32_t copied data length
+ */
+uint32_t P_Uart::popRx(uint8_t* data, uint32_t len)
+{
+    uint32_t size = 0;
+    while (size < len) {
+        etl::span<uint8_t> block = rxBuffer_.read_reserve(len - size);
+        if (block.empty())
+            break;
+        memcpy(&data[size], block.data(), block.size());
+        rxBuffer_.read_commit(block);
+        size += block.size();
     }
-    __enable_irq();
     return size;
 }
 
@@ -218,18 +332,30 @@ bool P_Uart::ioctl(uint32_t cmd, void* pValue)
         break;
 
     case kFlushInput:
-        rxQueue_.clear();
+        // Buffer is dropped from consumer side, reset is not safe for IRQ.
+        // Pending asynchronous receive is the consumer then
+        if (rxAsyncBuf_.load() != nullptr)
+            return false;
+        for (auto block = rxBuffer_.read_reserve(); !block.empty();
+             block = rxBuffer_.read_reserve()) {
+            rxBuffer_.read_commit(block);
+        }
+#if defined(RX_TIMESTAMP_USED)
+        while (rxStamps_.pop()) { }
+#endif
         return true;
 
-    case kFlushOutput: {
-        bool empty = false;
-        while (!empty) {
-            __disable_irq();
-            empty = txQueue_.empty();
-            __enable_irq();
-        }
+    case kFlushOutput:
+        while (!txBuffer_.empty() || !txRefs_.empty() || txBusy_.load()) { }
         return true;
-    }
+
+    case kGetOverruns:
+        if (pValue != nullptr) {
+            *static_cast<uint32_t*>(pValue) = rxOverruns_;
+            return true;
+        }
+        break;
+
     default:
         break;
     }
@@ -237,6 +363,120 @@ bool P_Uart::ioctl(uint32_t cmd, void* pValue)
     return false;
 }
 
+/**
+ * @brief Queues buffer for DMA transmission without copying. Order with data
+ *      written by write() is kept. Buffer must be valid until TX delegate is
+ *      called with it
+ *
+ * @param buf data buffer
+ * @param len data length
+ * @return true if buffer queued otherwise false: no DMA or queue is full
+ */
+bool P_Uart::writeRef(const void* buf, uint32_t len)
+{
+    if (!isOpen() || !isTxDma() || buf == nullptr || len == 0)
+        return false;
+
+    if (!txRefs_.push(TxRef { static_cast<const uint8_t*>(buf), len, txWritten_, false }))
+        return false;
+
+    txDmaKick();
+    return true;
+}
+
+/**
+ * @brief Starts asynchronous write. With DMA data is sent from caller buffer
+ *      without copying, otherwise it is copied to transmit buffer at once
+ *
+ * @param buf data buffer
+ * @param len data length
+ * @return DrvResult start result
+ */
+DrvResult P_Uart::writeAsync_(const void* buf, uint32_t len)
+{
+    if (!isTxDma())
+        return SerialDrv::writeAsync_(buf, len);
+
+    if (!isOpen() || buf == nullptr || len == 0)
+        return DrvResult::Error;
+
+    if (!txRefs_.push(TxRef { static_cast<const uint8_t*>(buf), len, txWritten_, true }))
+        return DrvResult::Error;
+
+    txDmaKick();
+    return DrvResult::InProgress;
+}
+
+/**
+ * @brief Starts asynchronous receive. Completes when requested length of data
+ *      is received
+ *
+ * @param buf data buffer
+ * @param len data length, must be less than receive buffer size, as wrapped
+ *      data stops one byte before unread one
+ * @return DrvResult start result, Finished if data was already received
+ */
+DrvResult P_Uart::readAsync_(void* buf, uint32_t len)
+{
+    if (!isOpen() || buf == nullptr || len == 0 || len >= rxBuffer_.capacity())
+        return DrvResult::Error;
+
+    rxAsyncLen_ = len;
+    rxAsyncBuf_.store(static_cast<uint8_t*>(buf));
+
+    // Data can be already received
+    return rxAsyncCheck(false) ? DrvResult::Finished : DrvResult::InProgress;
+}
+
+/**
+ * @brief Completes asynchronous receive when enough data received. Called
+ *      from task and IRQ, only the side which takes buffer completes it.
+ *      Receive direction is held meanwhile, so it is the only consumer
+ *
+ * @param fromIsr true if called from IRQ
+ * @return true if receive is completed by this call otherwise false
+ */
+bool P_Uart::rxAsyncCheck(bool fromIsr)
+{
+    if (rxAsyncBuf_.load() == nullptr || rxBuffer_.size() < rxAsyncLen_)
+        return false;
+
+    uint8_t* buf = rxAsyncBuf_.exchange(nullptr);
+    if (buf == nullptr)
+        return false;
+
+    const int32_t res = read_(buf, rxAsyncLen_);
+    if (fromIsr)
+        finishAsyncFromIsr(res, Direction::Rx);
+    else
+        finishAsync(res, Direction::Rx);
+    return true;
+}
+
+/**
+ * @brief Sets the callback for completed transmission of queued buffer
+ *
+ * @param txCb callback delegate
+ */
+void P_Uart::setTxDelegate(const TxDelegate& txCb)
+{
+    txCb_ = txCb;
+}
+
+#if defined(RX_TIMESTAMP_USED)
+/**
+ * @brief Reads metadata of the oldest completed burst. Bursts are ended by
+ *      line idle, UART_RX_STAMPS bursts can wait for reading
+ *
+ * @param stamp burst metadata
+ * @return true if metadata is read otherwise false
+ */
+bool P_Uart::readStamp(RxStamp& stamp)
+{
+    return rxStamps_.pop(stamp);
+}
+#endif
+
 void P_Uart::irqHandler(P_Uart* uart)
 {
     // Check instance pointer
@@ -246,22 +486,205 @@ void P_Uart::irqHandler(P_Uart* uart)
     // Receive data
     if (RESET != usart_interrupt_flag_get(uart->config_.uart, USART_INT_FLAG_RBNE)) {
         const uint8_t data = usart_data_receive(uart->config_.uart);
-        if (!uart->rxQueue_.full()) {
-            uart->rxQueue_.push(data);
-        }
+        uart->pushRx(&data, 1);
+        uart->rxAsyncCheck(true);
+        uart->rxCb().call_if();
+    }
+
+    // End of burst
+    if (RESET != usart_interrupt_flag_get(uart->config_.uart, USART_INT_FLAG_IDLE)) {
+        // Flag is cleared by status register read followed by data read
+        usart_data_receive(uart->config_.uart);
+        if (uart->isRxDma())
+            uart->rxDmaUpdate();
+        uart->rxBurstEnd();
     }
 
     // Transmit data
     if (RESET != usart_interrupt_flag_get(uart->config_.uart, USART_INT_FLAG_TBE)) {
-        if (uart->txQueue_.empty()) {
+        etl::span<uint8_t> block = uart->txBuffer_.read_reserve(1);
+        if (block.empty()) {
             usart_interrupt_disable(uart->config_.uart, USART_INT_TBE);
         } else {
-            usart_data_transmit(uart->config_.uart, uart->txQueue_.front());
-            uart->txQueue_.pop();
+            usart_data_transmit(uart->config_.uart, block[0]);
+            uart->txBuffer_.read_commit(block);
         }
     }
 }
 
+/**
+ * @brief Checks that reception by DMA is configured
+ *
+ * @return true if DMA is used otherwise false
+ */
+bool P_Uart::isRxDma() const
+{
+    return config_.rxDma != nullptr && dmaRx_ != nullptr && dmaRxSize_ != 0;
+}
+
+/**
+ * @brief DMA reception callback, half and full transfer events of circular
+ *      buffer are handled as well as burst end
+ *
+ * @param events DMA events
+ */
+void P_Uart::rxDmaHandler(uint32_t events)
+{
+    if (events & (kDmaHalf | kDmaFull))
+        rxDmaUpdate();
+}
+
+/**
+ * @brief Moves data received by DMA since previous update to receive buffer.
+ *      Called from IRQ only
+ */
+void P_Uart::rxDmaUpdate()
+{
+    // New data can be wrapped at the end of circular buffer
+    DmaRing::Block first, second;
+    if (dmaRxRing_.update(dmaRemaining(config_.rxDma), first, second) == 0)
+        return;
+
+    pushRx(&dmaRx_[first.offset], first.len);
+    if (second.len != 0)
+        pushRx(&dmaRx_[second.offset], second.len);
+    rxAsyncCheck(true);
+    rxCb().call_if();
+}
+
+/**
+ * @brief Checks that transmission by DMA is configured
+ *
+ * @return true if DMA is used otherwise false
+ */
+bool P_Uart::isTxDma() const
+{
+    return config_.txDma != nullptr;
+}
+
+/**
+ * @brief DMA transmission callback. Releases sent block and starts the next one
+ *
+ * @param events DMA events
+ */
+void P_Uart::txDmaHandler(uint32_t events)
+{
+    if (!(events & (kDmaFull | kDmaError)))
+        return;
+
+    if (txBlockRef_) {
+        const TxRef ref = txRefs_.front();
+        txRefs_.pop();
+        if (ref.async)
+            finishAsyncFromIsr(events & kDmaError ? -1 : static_cast<int32_t>(ref.len), Direction::Tx);
+        else
+            txCb_.call_if(ref.buf);
+    } else {
+        txBuffer_.read_commit(txBlock_);
+        txSent_ += txBlock_.size();
+    }
+
+    txBusy_.store(false);
+    txDmaKick();
+}
+
+/**
+ * @brief Starts DMA transmission if it is idle. Called from task and IRQ,
+ *      only the side which takes busy flag starts transfer. Other side can
+ *      add data between idle check and busy flag reset, so it is checked again
+ */
+void P_Uart::txDmaKick()
+{
+    while (!txBusy_.exchange(true)) {
+        if (txDmaNext())
+            return;
+
+        txBusy_.store(false);
+        if (txBuffer_.empty() && txRefs_.empty())
+            return;
+    }
+}
+
+/**
+ * @brief Starts DMA transfer of the next contiguous block. Queued buffer is
+ *      sent after all ring data written before it
+ *
+ * @return true if transfer started otherwise false
+ */
+bool P_Uart::txDmaNext()
+{
+    const uintptr_t periphAddr = reinterpret_cast<uintptr_t>(&USART_DATA(config_.uart));
+
+    if (!txRefs_.empty()) {
+        const TxRef& ref = txRefs_.front();
+        if (ref.mark == txSent_) {
+            txBlockRef_ = true;
+            startDma(config_.txDma, DmaDir::MemoryToPeriph, periphAddr,
+                ref.buf, ref.len, DmaWidth::Bits8, false);
+            return true;
+        }
+        txBlock_ = txBuffer_.read_reserve(ref.mark - txSent_);
+    } else {
+        txBlock_ = txBuffer_.read_reserve();
+    }
+
+    if (txBlock_.empty())
+        return false;
+
+    txBlockRef_ = false;
+    startDma(config_.txDma, DmaDir::MemoryToPeriph, periphAddr,
+        txBlock_.data(), txBlock_.size(), DmaWidth::Bits8, false);
+    return true;
+}
+
+/**
+ * @brief Puts received data to receive buffer by contiguous blocks. Space up
+ *      to the buffer end is filled before wrap, so no gap is left and buffer
+ *      holds its size less one byte. Data which doesn't fit is lost and
+ *      counted as overrun. Called from IRQ only
+ *
+ * @param data received data
+ * @param len data length
+ */
+void P_Uart::pushRx(const uint8_t* data, uint32_t len)
+{
+    uint32_t size = 0;
+    while (size < len) {
+        etl::span<uint8_t> block = rxBuffer_.write_reserve_optimal();
+        if (block.empty())
+            break;
+        if (block.size() > len - size)
+            block = block.first(len - size);
+        memcpy(block.data(), &data[size], block.size());
+        rxBuffer_.write_commit(block);
+        size += block.size();
+    }
+    rxOverruns_ += len - size;
+
+#if defined(RX_TIMESTAMP_USED)
+    // Burst starts with the first stored data. With DMA it is the first DMA
+    // or IDLE event of burst, so timestamp is later than the first byte
+    if (size != 0) {
+        if (rxBurst_.len == 0)
+            rxBurst_.timestamp = Time::nowUs();
+        rxBurst_.len += size;
+    }
+#endif
+}
+
+/**
+ * @brief Completes metadata of received burst on line idle. If metadata
+ *      queue is full burst continues, so bytes and metadata stay matched.
+ *      Called from IRQ only
+ */
+void P_Uart::rxBurstEnd()
+{
+#if defined(RX_TIMESTAMP_USED)
+    if (rxBurst_.len != 0 && rxStamps_.push(rxBurst_))
+        rxBurst_.len = 0;
+#endif
+}
+
 extern "C" void USART0_IRQHandler(void)
 {
     P_Uart::irqHandler(uartInstances[0]);
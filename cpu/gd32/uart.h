@@ -7,8 +7,21 @@
 #pragma once
 
 #include "periph/uart.h"
+#include "periph/dmaring.h"
 #include "gd32/gd32_types.h"
-#include "etl/queue.h"
+#include "gd32/dma.h"
+#include "etl/atomic.h"
+#include "etl/bip_buffer_spsc_atomic.h"
+#include "etl/delegate.h"
+#include "etl/queue_spsc_atomic.h"
+
+#ifndef UART_TX_REFS
+#define UART_TX_REFS 4
+#endif
+
+#ifndef UART_RX_STAMPS
+#define UART_RX_STAMPS 8
+#endif
 
 namespace gd32 {
 
@@ -18,14 +31,26 @@ struct UartConfig {
     uint32_t baudrate;
     GpioConfig tx;
     GpioConfig rx;
+    const DmaConfig* rxDma;     // Optional DMA channel for reception
+    const DmaConfig* txDma;     // Optional DMA channel for transmission
 };
 
-/// @brief Private realization of GD32 UART peripheral driver
+/**
+ * @brief Private realization of GD32 UART peripheral driver. Data buffers are
+ *      lock-free single producer single consumer rings, so IRQ and task sides
+ *      exchange data by contiguous blocks without interrupts masking
+ */
 class P_Uart : public ::Uart {
 public:
-    using IUartQueue = etl::iqueue<uint8_t, etl::memory_model::MEMORY_MODEL_MEDIUM>;
+    using IUartBuffer = etl::ibip_buffer_spsc_atomic<uint8_t, etl::memory_model::MEMORY_MODEL_MEDIUM>;
 
-    P_Uart(IUartQueue& tx, IUartQueue& rx);
+    /**
+     * @brief Callback for completed transmission of buffer queued by
+     *      writeRef(). Called from IRQ with the buffer pointer
+     */
+    using TxDelegate = etl::delegate<void(const void*)>;
+
+    P_Uart(IUartBuffer& tx, IUartBuffer& rx, uint8_t* dmaRx = nullptr, uint32_t dmaRxSize = 0);
 
     bool setConfig(const void* drvConfig) override;
     bool open() override;
@@ -33,30 +58,92 @@ public:
 
     bool ioctl(uint32_t cmd, void* pValue) override;
 
+    bool writeRef(const void* buf, uint32_t len);
+    void setTxDelegate(const TxDelegate& txCb);
+#if defined(RX_TIMESTAMP_USED)
+    bool readStamp(RxStamp& stamp) override;
+#endif
+
     static void irqHandler(P_Uart* uart);
 
 private:
     int32_t write_(const void* buf, uint32_t len) override;
     int32_t read_(void* buf, uint32_t len) override;
+    int32_t writev_(const WriteVec* vec, uint32_t count) override;
+    int32_t readv_(const ReadVec* vec, uint32_t count) override;
+    DrvResult writeAsync_(const void* buf, uint32_t len) override;
+    DrvResult readAsync_(void* buf, uint32_t len) override;
+
+    uint32_t pushTx(const uint8_t* data, uint32_t len);
+    uint32_t popRx(uint8_t* data, uint32_t len);
+
+    bool rxAsyncCheck(bool fromIsr);
+
+    bool isRxDma() const;
+    void rxDmaHandler(uint32_t events);
+    void rxDmaUpdate();
+    void pushRx(const uint8_t* data, uint32_t len);
+    void rxBurstEnd();
+
+    /// @brief Caller buffer queued for DMA transmission without copying
+    struct TxRef {
+        const uint8_t* buf;
+        uint32_t len;
+        uint32_t mark;  // Ring bytes count which must be sent before buffer
+        bool async;     // Completes asynchronous write instead of TX delegate
+    };
+
+    bool isTxDma() const;
+    void txDmaHandler(uint32_t events);
+    void txDmaKick();
+    bool txDmaNext();
 
     UartConfig config_;
-    IUartQueue& txQueue_;
-    IUartQueue& rxQueue_;
+    IUartBuffer& txBuffer_;
+    IUartBuffer& rxBuffer_;
+    uint8_t* dmaRx_;
+    uint32_t dmaRxSize_;
+    DmaRing dmaRxRing_;
+    uint32_t rxOverruns_;
+    etl::atomic<uint8_t*> rxAsyncBuf_;
+    uint32_t rxAsyncLen_;
+
+    etl::queue_spsc_atomic<TxRef, UART_TX_REFS, etl::memory_model::MEMORY_MODEL_SMALL> txRefs_;
+    etl::atomic<bool> txBusy_;
+    etl::span<uint8_t> txBlock_;
+    bool txBlockRef_;
+    uint32_t txWritten_;
+    uint32_t txSent_;
+    TxDelegate txCb_;
+
+#if defined(RX_TIMESTAMP_USED)
+    etl::queue_spsc_atomic<RxStamp, UART_RX_STAMPS, etl::memory_model::MEMORY_MODEL_SMALL> rxStamps_;
+    RxStamp rxBurst_;
+#endif
 };
 
-template <size_t SIZE>
+/**
+ * @brief GD32 UART driver with own buffers
+ *
+ * @tparam SIZE size of transmit and receive buffers
+ * @tparam DMA_SIZE size of circular DMA reception buffer, used only when
+ *      rxDma is set in configuration. Must hold data received during
+ *      half of its size plus IRQ latency
+ */
+template <size_t SIZE, size_t DMA_SIZE = 0>
 class Uart final : public P_Uart {
 public:
-    using UartQueue = etl::queue<uint8_t, SIZE, etl::memory_model::MEMORY_MODEL_MEDIUM>;
+    using UartBuffer = etl::bip_buffer_spsc_atomic<uint8_t, SIZE, etl::memory_model::MEMORY_MODEL_MEDIUM>;
 
     Uart()
-        : P_Uart(txQueue_, rxQueue_)
+        : P_Uart(txBuffer_, rxBuffer_, dmaRxBuffer_, DMA_SIZE)
     {
     }
 
 private:
-    UartQueue txQueue_;
-    UartQueue rxQueue_;
+    UartBuffer txBuffer_;
+    UartBuffer rxBuffer_;
+    uint8_t dmaRxBuffer_[DMA_SIZE > 0 ? DMA_SIZE : 1];
 };
 
 }; // namespace gd32
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * @file    vtimer.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   GD32 virtual timers service on timer channel compare.
+ ******************************************************************************/
+
+#include "gd32/vtimer.h"
+
+namespace gd32 {
+
+/**
+ * @brief Construct a new VTimerService object
+ *
+ * @param timer configured timer driver
+ */
+VTimerService::VTimerService(Timer& timer)
+    : timer_(timer)
+    , base_(0)
+    , last_(0)
+    , primask_(0)
+{
+}
+
+/**
+ * @brief Opens and starts timer driver
+ *
+ * @return true if success opened otherwise false
+ */
+bool VTimerService::open()
+{
+    if (!timer_.isOpen() && !timer_.open())
+        return false;
+
+    timer_.setCompareDelegate(Timer::GeneralDelegate::create<VTimerService, &VTimerService::compareHandler>(*this));
+    last_ = static_cast<uint16_t>(timer_.counter());
+    timer_.start();
+
+    // Immediate alarm sets compare for active timers or wraps tracking
+    setAlarm(0);
+    return true;
+}
+
+/**
+ * @brief Stops alarms and closes timer driver, active timers stay in list
+ *      and expire after the next open
+ */
+void VTimerService::close()
+{
+    timer_.disableCompare();
+    timer_.close();
+}
+
+/**
+ * @brief Returns current time of service extended from 16-bit counter
+ *
+ * @return uint32_t time in microseconds
+ */
+uint32_t VTimerService::now()
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint16_t counter = static_cast<uint16_t>(timer_.counter());
+    base_ += static_cast<uint16_t>(counter - last_);
+    last_ = counter;
+    __set_PRIMASK(primask);
+    return base_;
+}
+
+void VTimerService::setAlarm(uint32_t delayUs)
+{
+    if (delayUs > VTIMER_MAX_ALARM_US)
+        delayUs = VTIMER_MAX_ALARM_US;
+
+    const uint16_t start = static_cast<uint16_t>(timer_.counter());
+    timer_.setCompare(static_cast<uint16_t>(start + delayUs));
+
+    // Counter could pass compare value while it was set
+    if (static_cast<uint16_t>(timer_.counter() - start) >= delayUs)
+        timer_.triggerCompare();
+}
+
+/**
+ * @brief Leaves compare armed for the longest alarm without timers, so
+ *      extended time doesn't lose counter wraps
+ */
+void VTimerService::cancelAlarm()
+{
+    setAlarm(VTIMER_MAX_ALARM_US);
+}
+
+void VTimerService::lock()
+{
+    primask_ = __get_PRIMASK();
+    __disable_irq();
+}
+
+void VTimerService::unlock()
+{
+    __set_PRIMASK(primask_);
+}
+
+/**
+ * @brief Compare IRQ handler. Time is updated even without expired timers
+ */
+void VTimerService::compareHandler()
+{
+    now();
+    alarm();
+}
+
+}; // namespace gd32
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,54 @@
+/*******************************************************************************
+ * @file    vtimer.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of GD32 virtual timers service.
+ ******************************************************************************/
+
+#pragma once
+
+#include "sys/vtimer.h"
+#include "gd32/timer.h"
+
+#ifndef VTIMER_MAX_ALARM_US
+#define VTIMER_MAX_ALARM_US 0x8000
+#endif
+
+static_assert(VTIMER_MAX_ALARM_US < 0x10000, "Alarm must be shorter than counter range");
+
+namespace gd32 {
+
+/**
+ * @brief Virtual timers service on single GD32 timer channel. Timer must be
+ *      configured in TimerMode::Compare with 1 MHz counter clock and period
+ *      0xFFFF. Free running counter is extended to 32-bit microseconds time,
+ *      compare register is set to the nearest deadline. Alarms are limited by
+ *      VTIMER_MAX_ALARM_US and compare stays armed without active timers, so
+ *      time is updated at least once per counter wrap while service is open
+ */
+class VTimerService : public ::VTimerService {
+public:
+    explicit VTimerService(Timer& timer);
+
+    bool open();
+    void close();
+
+    uint32_t now() override;
+
+protected:
+    void setAlarm(uint32_t delayUs) override;
+    void cancelAlarm() override;
+    void lock() override;
+    void unlock() override;
+
+private:
+    void compareHandler();
+
+    Timer& timer_;
+    uint32_t base_;     // Extended counter
+    uint16_t last_;     // Counter at the last update of extended one
+    uint32_t primask_;
+};
+
+}; // namespace gd32
+
+/***************************** END OF FILE ************************************/
@@ -8,7 +8,7 @@
 
 #include <stdint.h>
 
-uint8_t crc8(const uint8_t *buf, uint32_t len);
+uint8_t crc8(const uint8_t *buf, uint32_t len, const uint8_t* crcIn = nullptr);
 uint16_t crc16(const uint8_t *buf, uint32_t len);
 uint32_t crc32(const uint8_t *buf, uint32_t len, const uint32_t* crcIn = nullptr);
 
@@ -55,6 +55,8 @@ private:
     static constexpr uint8_t kMsgFlag1 = 0x17;
     static constexpr uint8_t kMsgFlag2 = 0xAA;
 
+    static void outFrame(uint8_t cmd, const uint8_t* data, uint32_t len);
+
     static bool enabled_;
     static uint32_t bufPos_;
     static char buf_[kMsgSize];
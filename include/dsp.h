@@ -0,0 +1,247 @@
+/*******************************************************************************
+ * @file    dsp.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of streaming DSP stages for ADC samples.
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "etl/delegate.h"
+
+#ifndef DSP_PIPELINE_STAGES
+#define DSP_PIPELINE_STAGES 4
+#endif
+
+namespace dsp {
+
+/// @brief Statistics of pulse train over window of captured edges
+struct PulseStats {
+    uint32_t periods;       // Full periods count in window
+    uint32_t period;        // Mean period in timer ticks
+    uint32_t periodMin;
+    uint32_t periodMax;
+    uint32_t jitter;        // RMS deviation of period in timer ticks
+    uint32_t frequency;     // Mean frequency in mHz
+    uint32_t duty;          // High level share in permille, both edges only
+};
+
+uint32_t extract(const uint16_t* samples, uint32_t frames, uint32_t stride, uint32_t channel, int32_t* out);
+uint32_t isqrt(uint64_t value);
+bool pulseStats(const uint32_t* edges, uint32_t count, uint32_t timerPeriod, uint32_t tickHz,
+    bool bothEdges, PulseStats& stats);
+
+/**
+ * @brief Base of pipeline stage. Stage processes block of samples and keeps
+ *      own state between blocks, output can be written in place of input
+ */
+class Stage {
+public:
+    virtual ~Stage() = default;
+
+    /**
+     * @brief Processes block of samples
+     *
+     * @param in input samples
+     * @param len input samples count
+     * @param out output samples, can be the same as input
+     * @return uint32_t output samples count, at most input count
+     */
+    virtual uint32_t process(const int32_t* in, uint32_t len, int32_t* out) = 0;
+
+    /**
+     * @brief Drops stage state
+     */
+    virtual void reset() = 0;
+};
+
+/**
+ * @brief Chain of stages processing block in place, so no memory is
+ *      allocated. Stages are called once per block
+ */
+class Pipeline {
+public:
+    Pipeline();
+
+    bool add(Stage& stage);
+    uint32_t process(int32_t* buf, uint32_t len);
+    void reset();
+
+private:
+    Stage* stages_[DSP_PIPELINE_STAGES];
+    uint32_t count_;
+};
+
+/**
+ * @brief Oversampling with decimation. Sum of factor input samples shifted
+ *      right gives one output sample, e.g. factor 16 with shift 2 adds two
+ *      bits of resolution to white noise signal
+ */
+class Decimator final : public Stage {
+public:
+    Decimator(uint32_t factor, uint32_t shift);
+
+    uint32_t process(const int32_t* in, uint32_t len, int32_t* out) override;
+    void reset() override;
+
+private:
+    uint32_t factor_;
+    uint32_t shift_;
+    uint32_t count_;
+    int64_t acc_;
+};
+
+/**
+ * @brief Moving average over window of N samples with running sum, so cost
+ *      doesn't depend on window size
+ *
+ * @tparam N window size, power of two gives division by shift
+ */
+template <size_t N>
+class MovingAverage final : public Stage {
+public:
+    static_assert(N > 0, "Window must not be empty");
+
+    MovingAverage()
+    {
+        reset();
+    }
+
+    uint32_t process(const int32_t* in, uint32_t len, int32_t* out) override
+    {
+        for (uint32_t i = 0; i < len; ++i) {
+            const int32_t sample = in[i];
+            sum_ += sample - window_[pos_];
+            window_[pos_] = sample;
+            pos_ = pos_ + 1 < N ? pos_ + 1 : 0;
+            if (filled_ < N)
+                ++filled_;
+            out[i] = static_cast<int32_t>(sum_ / static_cast<int64_t>(filled_));
+        }
+        return len;
+    }
+
+    void reset() override
+    {
+        for (size_t i = 0; i < N; ++i) {
+            window_[i] = 0;
+        }
+        sum_ = 0;
+        pos_ = 0;
+        filled_ = 0;
+    }
+
+private:
+    int32_t window_[N];
+    int64_t sum_;
+    size_t pos_;
+    size_t filled_;
+};
+
+/**
+ * @brief Second order IIR section in direct form I with Q14 coefficients
+ *      and 64-bit accumulator
+ */
+class Biquad final : public Stage {
+public:
+    static constexpr int32_t kOne = 1 << 14;
+
+    /// @brief Coefficients in Q14 format, a0 is normalized to one
+    struct Coeffs {
+        int32_t b0;
+        int32_t b1;
+        int32_t b2;
+        int32_t a1;
+        int32_t a2;
+    };
+
+    static Coeffs fromFloat(float b0, float b1, float b2, float a1, float a2);
+
+    explicit Biquad(const Coeffs& coeffs);
+
+    uint32_t process(const int32_t* in, uint32_t len, int32_t* out) override;
+    void reset() override;
+
+private:
+    Coeffs coeffs_;
+    int32_t x1_;
+    int32_t x2_;
+    int32_t y1_;
+    int32_t y2_;
+};
+
+/// @brief Statistics of samples window
+struct WindowStats {
+    int32_t min;
+    int32_t max;
+    int32_t mean;
+    uint32_t rms;
+};
+
+/**
+ * @brief Statistics over consecutive windows of N samples. Samples pass
+ *      stage unchanged, statistics of each complete window is delivered by
+ *      delegate
+ *
+ * @tparam N window size
+ */
+template <size_t N>
+class Window final : public Stage {
+public:
+    static_assert(N > 0, "Window must not be empty");
+
+    using StatsDelegate = etl::delegate<void(const WindowStats&)>;
+
+    Window()
+    {
+        reset();
+    }
+
+    void setStatsDelegate(const StatsDelegate& statsCb)
+    {
+        statsCb_ = statsCb;
+    }
+
+    uint32_t process(const int32_t* in, uint32_t len, int32_t* out) override
+    {
+        for (uint32_t i = 0; i < len; ++i) {
+            const int32_t sample = in[i];
+            min_ = sample < min_ ? sample : min_;
+            max_ = sample > max_ ? sample : max_;
+            sum_ += sample;
+            sumSq_ += static_cast<uint64_t>(static_cast<int64_t>(sample) * sample);
+            out[i] = sample;
+
+            if (++count_ == N) {
+                const WindowStats stats = { min_, max_, static_cast<int32_t>(sum_ / static_cast<int64_t>(N)),
+                    isqrt(sumSq_ / N) };
+                reset();
+                statsCb_.call_if(stats);
+            }
+        }
+        return len;
+    }
+
+    void reset() override
+    {
+        min_ = INT32_MAX;
+        max_ = INT32_MIN;
+        sum_ = 0;
+        sumSq_ = 0;
+        count_ = 0;
+    }
+
+private:
+    int32_t min_;
+    int32_t max_;
+    int64_t sum_;
+    uint64_t sumSq_;
+    size_t count_;
+    StatsDelegate statsCb_;
+};
+
+}; // namespace dsp
+
+/***************************** END OF FILE ************************************/
@@ -8,6 +8,7 @@
 
 #include "timing.h"
 #include "crc.h"
+#include "periph/serialdrv.h"
 
 #include "etl/delegate.h"
 
@@ -46,12 +47,15 @@ public:
     using ParseDelegate = etl::delegate<void(const Msg&)>;
     using AckDelegate = etl::delegate<void(uint8_t)>;
     using WriteDelegate = etl::delegate<int32_t(const void*, uint32_t)>;
+    using WriteVecDelegate = etl::delegate<int32_t(const SerialDrv::WriteVec*, uint32_t)>;
 
-    /// @brief Delegates for process received messages and write output data
+    /// @brief Delegates for process received messages and write output data.
+    ///     Vectored write is used for messages when set, so data isn't copied
     struct Delegates {
         ParseDelegate parse;
         AckDelegate ack;
         WriteDelegate write;
+        WriteVecDelegate writev;
     };
 
     /**
@@ -82,8 +86,24 @@ public:
         const uint32_t msgLength = len + kServiceSize;
         const uint16_t crc = crc16(data, len);
 
+        // Send service data and user data as segments without copy
+        if (deleg_.writev.is_valid()) {
+            const uint8_t header[] = { kSof, cmd, static_cast<uint8_t>(len) };
+            const uint8_t tail[] = {
+                static_cast<uint8_t>(crc & 0xFF),
+                static_cast<uint8_t>((crc >> 8) & 0xFF),
+            };
+            const SerialDrv::WriteVec vec[] = {
+                { header, sizeof(header) },
+                { data, len },
+                { tail, sizeof(tail) },
+            };
+            deleg_.writev(vec, sizeof(vec) / sizeof(vec[0]));
+            return;
+        }
+
         // Fill msg buffer and send
-        uint8_t buf[msgLength];
+        uint8_t buf[kMsgMaxSize];
         buf[0] = kSof;
         buf[1] = cmd;
         buf[2] = len;
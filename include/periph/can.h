@@ -9,12 +9,16 @@
 #include "serialdrv.h"
 #include "can_types.h"
 
+#include "etl/span.h"
+
 /// @brief CAN bus peripheral driver
 class Can : public SerialDrv {
 public:
     enum IoctlCmd {
         kSetFilterId = SerialDrv::kCmdCount,
         kSetMaskId,
+        kGetOverruns,   // Gets count of lost received messages
+        kGetTxDepth,    // Gets count of messages waiting for transmission
     };
 
     /**
@@ -33,6 +37,40 @@ public:
      */
     virtual int32_t read(CanMsg& msg) = 0;
 
+    /**
+     * @brief Writes CAN data messages to driver until it has free space
+     *
+     * @param msgs CAN messages
+     * @return int32_t count of written messages, -1 on error
+     */
+    virtual int32_t write(etl::span<const CanMsg> msgs)
+    {
+        int32_t count = 0;
+        for (const CanMsg& msg : msgs) {
+            if (write(msg) <= 0)
+                break;
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Reads received CAN data messages from driver
+     *
+     * @param msgs buffer for CAN messages
+     * @return int32_t count of read messages, -1 on error
+     */
+    virtual int32_t read(etl::span<CanMsg> msgs)
+    {
+        int32_t count = 0;
+        for (CanMsg& msg : msgs) {
+            if (read(msg) <= 0)
+                break;
+            ++count;
+        }
+        return count;
+    }
+
 private:
     // Don't use original serialdrv methods
     int32_t write_(const void* buf, uint32_t len) override { return -1; }
@@ -22,6 +22,9 @@ struct CanMsg {
     uint32_t id;
     uint8_t data[CAN_DATA_MAX_SIZE];
     uint8_t size;
+#if defined(RX_TIMESTAMP_USED)
+    uint32_t timestamp;     // Reception time by Time::nowUs() taken in RX IRQ
+#endif
 };
 
 /***************************** END OF FILE ************************************/
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * @file    dmaring.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of circular DMA buffer positions and its host model.
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "etl/delegate.h"
+
+/**
+ * @brief Reader of circular DMA buffer. Data written by DMA is found by
+ *      remaining counter of channel, which is reloaded with buffer size after
+ *      each pass, so counter of buffer size and data wrapped over buffer end
+ *      are handled here. Doesn't depend on platform, so it is checked on host
+ *      with DmaSim
+ */
+class DmaRing {
+public:
+    /// @brief Part of buffer with new data
+    struct Block {
+        uint32_t offset;
+        uint32_t len;
+    };
+
+    explicit DmaRing(uint32_t size = 0);
+
+    void reset(uint32_t size);
+    uint32_t update(uint32_t remaining, Block& first, Block& second);
+    uint32_t pos() const;
+
+    static uint32_t written(uint32_t counted, uint32_t remaining, uint32_t size);
+
+private:
+    uint32_t size_;
+    uint32_t pos_;      // Offset of the first unread item
+};
+
+/**
+ * @brief Circular peripheral to memory DMA channel in simulated time for
+ *      host models. Items are written into buffer by receive(), remaining
+ *      counter and half and full transfer events follow hardware, event
+ *      delegate is called at once like DMA IRQ
+ */
+class DmaSim {
+public:
+    /// @brief Transfer events, the same values as of platform DMA helpers
+    enum Event : uint32_t {
+        kHalf = 0x1,
+        kFull = 0x2,
+    };
+
+    /// @brief Callback of DMA IRQ with Event flags
+    using Delegate = etl::delegate<void(uint32_t)>;
+
+    DmaSim(uint8_t* buf, uint32_t size);
+
+    void setDelegate(const Delegate& cb);
+    void receive(const uint8_t* data, uint32_t len);
+    uint32_t remaining() const;
+
+private:
+    uint8_t* buf_;
+    uint32_t size_;
+    uint32_t remaining_;
+    Delegate cb_;
+};
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * @file    loopbackcan.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of loopback CAN bus driver for host models.
+ ******************************************************************************/
+
+#pragma once
+
+#include "can.h"
+
+#ifndef CAN_LOOPBACK_SIZE
+#define CAN_LOOPBACK_SIZE 64
+#endif
+
+/**
+ * @brief CAN bus driver without hardware for host models. Pair of drivers
+ *      connected by connect() is a bus of two nodes, messages of one are
+ *      read by another, single driver reads own messages. Messages take bus
+ *      time of chosen baud rate without bit stuffing and become readable
+ *      after it, so throughput of protocols over CAN can be measured. RX
+ *      delegate is called by poll() from loop of model instead of IRQ.
+ *      Configuration is CanBaud value
+ */
+class LoopbackCan final : public Can {
+public:
+    LoopbackCan();
+
+    bool setConfig(const void* drvConfig) override;
+    bool open() override;
+    void close() override;
+    bool ioctl(uint32_t cmd, void* pValue) override;
+
+    void connect(LoopbackCan& peer);
+    void poll();
+
+    int32_t write(const CanMsg& msg) override;
+    int32_t read(CanMsg& msg) override;
+    using Can::read;
+    using Can::write;
+
+    uint32_t frames() const;
+
+private:
+    /// @brief Message on bus with time when it is received
+    struct Frame {
+        CanMsg msg;
+        uint32_t readyUs;
+    };
+
+    static uint32_t frameBits(const CanMsg& msg);
+
+    LoopbackCan* peer_;
+    CanBaud baud_;
+    uint32_t busFreeUs_;    // End of the last message on bus
+    uint32_t frames_;
+    uint32_t overruns_;
+
+    Frame ring_[CAN_LOOPBACK_SIZE];
+    uint32_t head_;
+    uint32_t count_;
+};
+
+/***************************** END OF FILE ************************************/
@@ -13,6 +13,16 @@
 
 #include "basedrv.h"
 
+#include "etl/delegate.h"
+
+#ifndef SERIALDRV_GATHER_SIZE
+#define SERIALDRV_GATHER_SIZE 64
+#endif
+
+#ifndef SERIALDRV_WRITEV_MAX
+#define SERIALDRV_WRITEV_MAX 8
+#endif
+
 /**
  * @brief Abstract peripheral driver
  */
@@ -90,7 +100,204 @@ public:
      */
     int32_t read(uint32_t addr, uint8_t reg, void* buf, uint32_t len);
 
+    /// @brief Data segment of vectored write, length is the same as for write
+    struct WriteVec {
+        const void* buf;
+        uint32_t len;
+    };
+
+    /// @brief Data segment of vectored read, length is the same as for read
+    struct ReadVec {
+        void* buf;
+        uint32_t len;
+    };
+
+    /**
+     * @brief Write data segments to driver as single transfer without
+     *      copying them into temporary buffer by caller
+     *
+     * @param vec data segments array
+     * @param count segments count
+     * @return int32_t actually written data length, -1 on error
+     */
+    int32_t writev(const WriteVec* vec, uint32_t count);
+
+    /**
+     * @brief Write data segments to driver with register access
+     *
+     * @param reg register to write data
+     * @param vec data segments array
+     * @param count segments count
+     * @return int32_t actually written data length, -1 on error
+     */
+    int32_t writev(uint8_t reg, const WriteVec* vec, uint32_t count);
+
+    /**
+     * @brief Write data segments to driver with register access and address
+     *
+     * @param addr address of device
+     * @param reg register to write data
+     * @param vec data segments array
+     * @param count segments count
+     * @return int32_t actually written data length, -1 on error
+     */
+    int32_t writev(uint32_t addr, uint8_t reg, const WriteVec* vec, uint32_t count);
+
+    /**
+     * @brief Receive data from driver into segments as single transfer
+     *
+     * @param vec data segments array
+     * @param count segments count
+     * @return int32_t actually readed data length, -1 on error
+     */
+    int32_t readv(const ReadVec* vec, uint32_t count);
+
+    /**
+     * @brief Receive data from driver into segments with register access
+     *
+     * @param reg register to read data
+     * @param vec data segments array
+     * @param count segments count
+     * @return int32_t actually readed data length, -1 on error
+     */
+    int32_t readv(uint8_t reg, const ReadVec* vec, uint32_t count);
+
+    /**
+     * @brief Receive data from driver into segments with register access
+     *      and address
+     *
+     * @param addr address of device
+     * @param reg register to read data
+     * @param vec data segments array
+     * @param count segments count
+     * @return int32_t actually readed data length, -1 on error
+     */
+    int32_t readv(uint32_t addr, uint8_t reg, const ReadVec* vec, uint32_t count);
+
+    /**
+     * @brief Callback function for asynchronous operation completion with
+     *      result and actually transferred data length. Can be called from IRQ
+     */
+    using DoneDelegate = etl::delegate<void(DrvResult, int32_t)>;
+
+    /**
+     * @brief Starts asynchronous write data to driver. Completion delegate is
+     *      called for accepted operation, possibly before return
+     *
+     * @param buf data buffer, must be valid until completion
+     * @param len length of data buffer
+     * @param doneCb completion callback
+     * @return DrvResult InProgress if transfer started, Finished if completed
+     *      at once, Error if rejected without delegate call
+     */
+    DrvResult writeAsync(const void* buf, uint32_t len, const DoneDelegate& doneCb);
+
+    /**
+     * @brief Starts asynchronous write data to driver with register access
+     *
+     * @param reg register to write data
+     * @param buf data buffer, must be valid until completion
+     * @param len length of data buffer
+     * @param doneCb completion callback
+     * @return DrvResult InProgress if transfer started, Finished if completed
+     *      at once, Error if rejected without delegate call
+     */
+    DrvResult writeAsync(uint8_t reg, const void* buf, uint32_t len, const DoneDelegate& doneCb);
+
+    /**
+     * @brief Starts asynchronous write data to driver with register access
+     *      and address
+     *
+     * @param addr address of device
+     * @param reg register to write data
+     * @param buf data buffer, must be valid until completion
+     * @param len length of data buffer
+     * @param doneCb completion callback
+     * @return DrvResult InProgress if transfer started, Finished if completed
+     *      at once, Error if rejected without delegate call
+     */
+    DrvResult writeAsync(uint32_t addr, uint8_t reg, const void* buf, uint32_t len,
+        const DoneDelegate& doneCb);
+
+    /**
+     * @brief Starts asynchronous receive data from driver. Completion delegate
+     *      is called for accepted operation, possibly before return
+     *
+     * @param buf data buffer, must be valid until completion
+     * @param len length of data to read
+     * @param doneCb completion callback
+     * @return DrvResult InProgress if transfer started, Finished if completed
+     *      at once, Error if rejected without delegate call
+     */
+    DrvResult readAsync(void* buf, uint32_t len, const DoneDelegate& doneCb);
+
+    /**
+     * @brief Starts asynchronous receive data from driver with register access
+     *
+     * @param reg register to read data
+     * @param buf data buffer, must be valid until completion
+     * @param len length of data to read
+     * @param doneCb completion callback
+     * @return DrvResult InProgress if transfer started, Finished if completed
+     *      at once, Error if rejected without delegate call
+     */
+    DrvResult readAsync(uint8_t reg, void* buf, uint32_t len, const DoneDelegate& doneCb);
+
+    /**
+     * @brief Starts asynchronous receive data from driver with register access
+     *      and address
+     *
+     * @param addr address of device
+     * @param reg register to read data
+     * @param buf data buffer, must be valid until completion
+     * @param len length of data to read
+     * @param doneCb completion callback
+     * @return DrvResult InProgress if transfer started, Finished if completed
+     *      at once, Error if rejected without delegate call
+     */
+    DrvResult readAsync(uint32_t addr, uint8_t reg, void* buf, uint32_t len,
+        const DoneDelegate& doneCb);
+
+    /**
+     * @brief Checks that asynchronous operation is in progress in any
+     *      direction
+     *
+     * @return true if busy otherwise false
+     */
+    bool isBusy() const;
+
+    /**
+     * @brief Callback function for data reception IRQ. Can be bound to
+     *      Module::wakeFromIsr for immediate processing of received data
+     */
+    using RxDelegate = etl::delegate<void(void)>;
+
+    /**
+     * @brief Sets the callback for data reception IRQ
+     *
+     * @param rxCb callback delegate
+     */
+    void setRxDelegate(const RxDelegate& rxCb)
+    {
+        rxCb_ = rxCb;
+    }
+
 protected:
+    /// @brief Direction of transfer, it is locked separately by full duplex driver
+    enum class Direction : uint8_t {
+        Tx,
+        Rx,
+    };
+
+    /**
+     * @brief Checks that receive and transmit are independent, so transfers
+     *      without register run in both directions at once. Default is half
+     *      duplex driver, its transfers take both directions
+     *
+     * @return true if full duplex otherwise false
+     */
+    virtual bool isDuplex() const { return false; }
+
     /**
      * @brief Abstract write data to driver
      *
@@ -109,6 +316,71 @@ protected:
      */
     virtual int32_t read_(void* buf, uint32_t len) = 0;
 
+    /**
+     * @brief Write data segments. Default realization gathers segments into
+     *      SERIALDRV_GATHER_SIZE bytes buffer for single write_ call, so
+     *      register access is kept in one transfer. Longer data without
+     *      register is written by one write_ call per segment
+     *
+     * @param vec data segments array
+     * @param count segments count
+     * @return int32_t actually written data length, -1 on error or too long
+     *      data with register
+     */
+    virtual int32_t writev_(const WriteVec* vec, uint32_t count);
+
+    /**
+     * @brief Receive data into segments. Default realization makes single
+     *      read_ call into SERIALDRV_GATHER_SIZE bytes buffer and scatters it.
+     *      Longer data without register is read by one read_ call per segment
+     *
+     * @param vec data segments array
+     * @param count segments count
+     * @return int32_t actually readed data length, -1 on error or too long
+     *      data with register
+     */
+    virtual int32_t readv_(const ReadVec* vec, uint32_t count);
+
+    /**
+     * @brief Starts asynchronous write. Default realization is synchronous
+     *      write_ call. Driver with asynchronous support returns InProgress
+     *      and calls finishAsync or finishAsyncFromIsr on completion
+     *
+     * @param buf data buffer
+     * @param len length of data buffer
+     * @return DrvResult Error if not started, delegate mustn't be called then
+     */
+    virtual DrvResult writeAsync_(const void* buf, uint32_t len);
+
+    /**
+     * @brief Starts asynchronous receive. Default realization is synchronous
+     *      read_ call. Driver with asynchronous support returns InProgress
+     *      and calls finishAsync or finishAsyncFromIsr on completion
+     *
+     * @param buf data buffer
+     * @param len length of data to read
+     * @return DrvResult Error if not started, delegate mustn't be called then
+     */
+    virtual DrvResult readAsync_(void* buf, uint32_t len);
+
+    /**
+     * @brief Completes asynchronous operation from task context. Releases
+     *      its direction and calls completion delegate
+     *
+     * @param len actually transferred data length, -1 on error
+     * @param dir direction of completed operation
+     */
+    void finishAsync(int32_t len, Direction dir);
+
+    /**
+     * @brief Completes asynchronous operation from IRQ. Releases its
+     *      direction and calls completion delegate
+     *
+     * @param len actually transferred data length, -1 on error
+     * @param dir direction of completed operation
+     */
+    void finishAsyncFromIsr(int32_t len, Direction dir);
+
     /**
      * @brief Get register value for current operation
      *
@@ -130,11 +402,47 @@ protected:
      */
     void setAddr(int32_t addr);
 
+    /**
+     * @brief Takes both directions of driver for operation of successor
+     *      class API. Blocks until other operation is finished with FreeRTOS
+     *
+     * @return true if taken, false if asynchronous operation holds driver
+     */
+    bool lock();
+
+    /**
+     * @brief Releases driver taken by lock()
+     */
+    void unlock();
+
+    /**
+     * @brief Returns reference on the callback for data reception IRQ
+     *
+     * @return RxDelegate& callback delegate
+     */
+    RxDelegate& rxCb()
+    {
+        return rxCb_;
+    }
+
 private:
+    bool take(Direction dir, bool bus);
+    void give(Direction dir, bool bus);
+    bool beginAsync(Direction dir, bool bus, const DoneDelegate& doneCb);
+    DrvResult startAsync(Direction dir, DrvResult result);
+    void releaseAsync(Direction dir);
+    int32_t writeEach(const WriteVec* vec, uint32_t count);
+    int32_t readEach(const ReadVec* vec, uint32_t count);
+
+    RxDelegate rxCb_;
+    DoneDelegate doneCb_[2];    // Per direction
+    volatile bool busy_[2];     // Direction held by asynchronous operation
+    bool asyncBus_[2];          // Asynchronous operation holds both directions
+    bool asyncAddr_;
     int32_t reg_;
     int32_t addr_;
 #if defined(FREERTOS_USED)
-    SemaphoreHandle_t mutex_;
+    SemaphoreHandle_t mutex_[2];
 #endif
 };
 
@@ -9,12 +9,55 @@
 #include "serialdrv.h"
 #include "spi_types.h"
 
+#include "etl/span.h"
+
+class Gpio;
+
 /// @brief SPI bus peripheral driver
 class Spi : public SerialDrv {
 public:
     enum IoctlCmd {
         kSetCs = SerialDrv::kCmdCount,
     };
+
+    /**
+     * @brief Full-duplex transfer between caller buffers. Received frames are
+     *      written directly into rx buffer instead of input queue. Chip select
+     *      is set for this transfer only
+     *
+     * @tparam T frame type: uint8_t, uint16_t or uint32_t according to bus frame
+     * @param tx frames to send, empty span sends dummy 0xFF.. frames
+     * @param rx buffer for received frames, empty span drops them
+     * @param cs chip select of device, nullptr to use the one set by kSetCs
+     * @return int32_t transferred frames count, -1 on error
+     */
+    template <typename T>
+    int32_t transfer(etl::span<const T> tx, etl::span<T> rx, Gpio* cs = nullptr)
+    {
+        if (!tx.empty() && !rx.empty() && tx.size() != rx.size())
+            return -1;
+
+        if (!lock())
+            return -1;
+        const int32_t res = transfer_(tx.empty() ? nullptr : tx.data(),
+            rx.empty() ? nullptr : rx.data(), tx.empty() ? rx.size() : tx.size(),
+            sizeof(T), cs);
+        unlock();
+        return res;
+    }
+
+protected:
+    /**
+     * @brief Abstract full-duplex transfer
+     *
+     * @param tx frames to send, nullptr for dummy frames
+     * @param rx buffer for received frames, nullptr to drop them
+     * @param len frames count
+     * @param width frame size in bytes
+     * @param cs chip select of device, nullptr to use default one
+     * @return int32_t transferred frames count, -1 on error
+     */
+    virtual int32_t transfer_(const void* tx, void* rx, uint32_t len, uint32_t width, Gpio* cs) = 0;
 };
 
 /***************************** END OF FILE ************************************/
@@ -16,6 +16,7 @@ enum class TimerMode {
     Capture,
     GeneralAndCapture,
     Pwm,
+    Compare,    // Channel compare IRQ without output, e.g. for alarms
 };
 
 /// @brief Timer peripheral driver
@@ -11,7 +11,29 @@
 /// @brief UART peripheral driver
 class Uart : public SerialDrv {
 public:
+    enum IoctlCmd {
+        kGetOverruns = SerialDrv::kCmdCount,    // Gets count of lost received bytes
+    };
 
+    /// @brief Metadata of received burst of bytes
+    struct RxStamp {
+        uint32_t timestamp;     // Burst start time by Time::nowUs() taken in RX IRQ
+        uint32_t len;           // Count of burst bytes in receive buffer
+    };
+
+    /**
+     * @brief Reads metadata of the oldest completed burst. Bursts follow in
+     *      receive buffer in the same order, so caller matches bytes by length
+     *
+     * @param stamp burst metadata
+     * @return true if metadata is read otherwise false, also when driver
+     *      doesn't support timestamps
+     */
+    virtual bool readStamp(RxStamp& stamp) { return false; }
+
+protected:
+    /// @brief Receive and transmit lines are independent
+    bool isDuplex() const override { return true; }
 };
 
 /***************************** END OF FILE ************************************/
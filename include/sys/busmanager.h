@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * @file    busmanager.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of shared bus transactions manager.
+ ******************************************************************************/
+
+#pragma once
+
+#include "drvmodule.h"
+#include "periph/serialdrv.h"
+#include "periph/gpio.h"
+
+#ifndef BUSMANAGER_BURST_MAX
+#define BUSMANAGER_BURST_MAX 8
+#endif
+
+#ifndef BUSMANAGER_IDLE_MS
+#define BUSMANAGER_IDLE_MS 1000
+#endif
+
+/**
+ * @brief Transaction for BusManager queue. Owned by requester, manager only
+ *      links it into own queue, so no memory is allocated. Transaction and
+ *      its data buffer must be valid until completion
+ */
+struct BusTransfer {
+    /// @brief Transaction direction
+    enum Dir : uint8_t {
+        kRead,
+        kWrite,
+    };
+
+    Dir dir = kRead;
+    bool burst = false;     // Device increments register, so merge is allowed
+    int32_t addr = -1;      // Device address, -1 for bus without addressing
+    int32_t reg = -1;       // Register, -1 without register access
+    Gpio* cs = nullptr;     // SPI chip select of device, nullptr if not used
+    void* buf = nullptr;
+    uint32_t len = 0;
+    SerialDrv::DoneDelegate done;
+
+    volatile bool pending = false;
+    BusTransfer* next = nullptr;
+};
+
+/**
+ * @brief Manager of shared I2C or SPI bus. Modules submit transactions
+ *      instead of direct driver calls, manager takes the whole queue at once
+ *      and runs it back-to-back in own dispatcher. Adjacent registers of the
+ *      same device with burst flag are merged into single vectored transfer
+ *      directly into requesters buffers. Order of transactions of one device
+ *      is kept. Completion delegates are called from manager context
+ */
+class BusManager : public DrvModule<SerialDrv> {
+public:
+    /// @brief Bus usage counters
+    struct Stats {
+        uint32_t transfers;     // Completed requester transactions
+        uint32_t transactions;  // Actual bus transfers after merge
+        uint32_t busyUs;        // Time spent in bus transfers
+    };
+
+    static constexpr uint32_t kEventQueued = 0x1;
+
+    BusManager();
+#if defined(FREERTOS_USED)
+    BusManager(const char* name, uint32_t stack, UBaseType_t prior);
+#endif
+
+    bool submit(BusTransfer& transfer);
+
+    Stats stats() const;
+    void resetStats();
+
+protected:
+    Time _dispatcher() override;
+
+private:
+    static bool isSameDevice(const BusTransfer& a, const BusTransfer& b);
+    static bool canMerge(const BusTransfer& prev, const BusTransfer& next);
+
+    void execute(BusTransfer* const* burst, uint32_t count);
+
+    BusTransfer* head_;
+    BusTransfer* tail_;
+    Stats stats_;
+#if defined(FREERTOS_USED) && defined(ESP_PLATFORM)
+    portMUX_TYPE lock_;
+#endif
+};
+
+/***************************** END OF FILE ************************************/
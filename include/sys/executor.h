@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * @file    executor.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of work-sharing modules executor.
+ ******************************************************************************/
+
+#pragma once
+
+#include "module.h"
+
+#if defined(FREERTOS_USED) || defined(POSIX_USED)
+
+#include "etl/atomic.h"
+#include "etl/deque.h"
+#include "etl/vector.h"
+
+#if defined(POSIX_USED)
+#include <pthread.h>
+#endif
+
+#ifndef EXECUTOR_QUEUE_SIZE
+#define EXECUTOR_QUEUE_SIZE 8
+#endif
+
+#ifndef EXECUTOR_MODULES_MAX
+#define EXECUTOR_MODULES_MAX 16
+#endif
+
+#ifndef EXECUTOR_WORKERS
+#define EXECUTOR_WORKERS 4
+#endif
+
+/**
+ * @brief FreeRTOS or POSIX ONLY. Work-sharing executor for short
+ *      run-to-completion module dispatchers. Holds one worker task per CPU
+ *      core, each with own jobs queue. Idle worker steals jobs from the
+ *      queues of other workers, so shared modules are dispatched on
+ *      whichever core is free. Modules opt in by Module::shareInit() instead
+ *      of Module::taskInit(). Host build with global define POSIX_USED runs
+ *      EXECUTOR_WORKERS threads of the same executor, e.g. for scaling and
+ *      fairness checks by executed() and stolen() counters
+ */
+class Executor {
+public:
+#if defined(POSIX_USED)
+    static constexpr uint32_t kWorkers = EXECUTOR_WORKERS;
+#elif defined(ESP_PLATFORM)
+    static constexpr uint32_t kWorkers = portNUM_PROCESSORS;
+#else
+    static constexpr uint32_t kWorkers = 1;
+#endif
+
+#if defined(POSIX_USED)
+    static void init();
+    static void deinit();
+#else
+    static void init(uint32_t stack, UBaseType_t prior = Module::kDefaultPrior);
+#endif
+
+    static bool add(Module* mod);
+    static bool remove(Module* mod);
+    static void wake();
+    static void wakeFromIsr();
+
+    static uint32_t executed(uint32_t worker);
+    static uint32_t stolen(uint32_t worker);
+
+private:
+    /// @brief Registered shared module
+    struct Entry {
+        Module* mod;
+        bool queued;
+    };
+
+    /// @brief Worker task with own jobs queue
+    struct Worker {
+#if defined(POSIX_USED)
+        pthread_t thread;
+        pthread_cond_t cond;
+        bool notified;
+        bool started;
+#else
+        TaskHandle_t handle;
+#endif
+        etl::deque<Entry*, EXECUTOR_QUEUE_SIZE> queue;
+        etl::atomic<uint32_t> executed;     // Read by other threads without lock
+        etl::atomic<uint32_t> stolen;
+    };
+
+#if defined(POSIX_USED)
+    static void* task(void* arg);
+#else
+    static void task(void* arg);
+#endif
+    static Entry* take(uint32_t id);
+    static int32_t schedule(uint32_t id);
+    static void notify(uint32_t id);
+    static void wait(uint32_t id, int32_t delayMs);
+
+    static Worker workers_[kWorkers];
+    static etl::vector<Entry, EXECUTOR_MODULES_MAX> entries_;
+    static etl::atomic<bool> stop_;
+    static uint32_t next_;  // Entry to start the next schedule scan from
+
+    Executor() = delete;
+};
+
+#endif
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * @file    isotp.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of ISO-TP (ISO 15765-2) transport over CAN bus.
+ ******************************************************************************/
+
+#pragma once
+
+#include "drvmodule.h"
+#include "periph/can.h"
+
+#include "etl/delegate.h"
+
+#ifndef ISOTP_SESSIONS
+#define ISOTP_SESSIONS 4
+#endif
+
+#ifndef ISOTP_BUF_SIZE
+#define ISOTP_BUF_SIZE 256
+#endif
+
+#ifndef ISOTP_TIMEOUT_MS
+#define ISOTP_TIMEOUT_MS 1000
+#endif
+
+#ifndef ISOTP_IDLE_MS
+#define ISOTP_IDLE_MS 100
+#endif
+
+/**
+ * @brief ISO-TP transport with normal addressing over classic CAN frames.
+ *      Payloads up to ISOTP_BUF_SIZE bytes (at most 4095) are segmented into
+ *      first and consecutive frames and reassembled back with flow control,
+ *      block size and STmin. Each of ISOTP_SESSIONS sessions is a pair of
+ *      transmit and receive identifiers with own static buffers, so several
+ *      transfers run concurrently. Module is the only reader of CAN driver,
+ *      frames of other identifiers are passed to frame delegate. Driver RX
+ *      delegate can wake module by kEventRx
+ */
+class IsoTp : public DrvModule<Can> {
+public:
+    /// @brief Callback for received payload with session index
+    using RxDelegate = etl::delegate<void(uint32_t, const uint8_t*, uint32_t)>;
+
+    /// @brief Callback for finished transmission with session index
+    using TxDelegate = etl::delegate<void(uint32_t, DrvResult)>;
+
+    /// @brief Callback for CAN frames not owned by sessions
+    using FrameDelegate = etl::delegate<void(const CanMsg&)>;
+
+    static constexpr uint32_t kEventRx = 0x1;
+    static constexpr uint32_t kEventTx = 0x2;
+
+    IsoTp();
+#if defined(FREERTOS_USED)
+    IsoTp(const char* name, uint32_t stack, UBaseType_t prior);
+#endif
+
+    int32_t openSession(uint32_t txId, uint32_t rxId, uint8_t blockSize = 0, uint8_t stMin = 0);
+    void closeSession(uint32_t session);
+
+    bool send(uint32_t session, const void* data, uint32_t len);
+    bool isBusy(uint32_t session) const;
+
+    void setRxDelegate(const RxDelegate& rxCb);
+    void setTxDelegate(const TxDelegate& txCb);
+    void setFrameDelegate(const FrameDelegate& frameCb);
+
+protected:
+    Time _dispatcher() override;
+
+private:
+    enum class TxState : uint8_t {
+        Idle,
+        Start,          // Single or first frame is waiting for free TX ring
+        WaitFlow,       // Flow control is waiting after first frame or block
+        Consecutive,    // Consecutive frames are sent with STmin gaps
+    };
+
+    struct Session {
+        bool used;
+        uint32_t txId;
+        uint32_t rxId;
+        uint8_t blockSize;      // Block size in own flow control
+        uint8_t stMin;          // STmin in own flow control
+
+        TxState txState;
+        uint8_t txSn;
+        uint8_t txBlock;        // Block size of receiver, zero for no limit
+        uint8_t txBlockLeft;
+        uint32_t txGapUs;       // STmin of receiver
+        uint32_t txNextUs;
+        Time txDeadline;
+        uint16_t txLen;
+        uint16_t txPos;
+        uint8_t txBuf[ISOTP_BUF_SIZE];
+
+        bool rxActive;
+        uint8_t rxSn;
+        uint8_t rxBlockLeft;
+        Time rxDeadline;
+        uint16_t rxLen;
+        uint16_t rxPos;
+        uint8_t rxBuf[ISOTP_BUF_SIZE];
+    };
+
+    void receive(uint32_t index, const CanMsg& msg);
+    void receiveFlow(uint32_t index, const CanMsg& msg);
+    bool sendFlow(const Session& session, uint8_t status);
+    void transmit(uint32_t index);
+    void finishTx(uint32_t index, DrvResult result);
+    bool writeFrame(uint32_t id, const uint8_t* data, uint8_t size);
+
+    static uint32_t stMinToUs(uint8_t stMin);
+
+    Session sessions_[ISOTP_SESSIONS];
+    RxDelegate rxCb_;
+    TxDelegate txCb_;
+    FrameDelegate frameCb_;
+};
+
+/***************************** END OF FILE ************************************/
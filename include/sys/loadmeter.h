@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * @file    loadmeter.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of CPU load meter.
+ ******************************************************************************/
+
+#pragma once
+
+#include "module.h"
+
+#include "etl/vector.h"
+
+#ifndef LOADMETER_MODULES_MAX
+#define LOADMETER_MODULES_MAX 16
+#endif
+
+/**
+ * @brief CPU load meter. Enabled by global define LOADMETER_USED. In super
+ *      loop each dispatcher call is measured by microsecond clock and time
+ *      not spent in dispatchers is idle. With FreeRTOS wall time of
+ *      dispatchers includes waits and preemption, so load is taken from run
+ *      time counters of idle tasks and share from run time counters of module
+ *      tasks, it needs configGENERATE_RUN_TIME_STATS and
+ *      configUSE_TRACE_FACILITY. Load is calculated in permille over 1 s,
+ *      10 s and 60 s windows, also per module share of CPU for the last second
+ */
+class LoadMeter {
+public:
+    /// @brief Load averaging windows
+    enum Window {
+        kWindow1s,
+        kWindow10s,
+        kWindow60s,
+    };
+
+    static constexpr uint32_t kPermille = 1000;
+#if defined(FREERTOS_USED) && defined(ESP_PLATFORM)
+    static constexpr uint32_t kCores = portNUM_PROCESSORS;
+#else
+    static constexpr uint32_t kCores = 1;
+#endif
+
+#if defined(FREERTOS_USED)
+    static void add(const Module* mod);
+#else
+    static void busy(const Module* mod, uint32_t us);
+#endif
+    static bool remove(const Module* mod);
+    static void update();
+
+    static uint32_t load(Window window);
+    static uint32_t share(const Module* mod);
+
+    static void out(uint8_t cmd);
+
+private:
+    static constexpr uint32_t kWindowUs = 1000000;
+    static constexpr uint32_t kSamples = 60;
+
+    /// @brief Measured module with its busy time
+    struct Entry {
+        const Module* mod;
+        uint32_t busyUs;
+        uint32_t share;
+#if defined(FREERTOS_USED)
+        uint32_t runTime;   // Run time counter of module task
+#endif
+    };
+
+    static void push(uint32_t load);
+#if defined(FREERTOS_USED)
+    static void sample(uint32_t now);
+    static uint32_t idleRunTime();
+    static uint32_t taskRunTime(TaskHandle_t handle);
+#endif
+
+    static etl::vector<Entry, LOADMETER_MODULES_MAX> entries_;
+    static uint16_t samples_[kSamples];
+    static uint32_t index_;
+    static uint32_t count_;
+    static uint32_t startUs_;
+    static uint32_t busyUs_;
+    static bool started_;
+#if defined(FREERTOS_USED)
+    static uint32_t totalRunTime_;
+    static uint32_t idleRunTime_;
+#endif
+
+    LoadMeter() = delete;
+};
+
+/***************************** END OF FILE ************************************/
@@ -8,6 +8,8 @@
 
 #include "timing.h"
 
+#include "etl/atomic.h"
+
 #if defined(FREERTOS_USED)
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -30,6 +32,9 @@ public:
 #endif
 
     static const UBaseType_t kDefaultPrior;
+#endif
+#if defined(FREERTOS_USED) || defined(POSIX_USED)
+    bool shareInit();
 #endif
     virtual ~Module() = default;
     virtual void reset();
@@ -44,8 +49,16 @@ public:
     bool isSuspended() const;
     void resume();
 
+    static constexpr uint32_t kEventWake = 0x80000000;
+
+    void signal(uint32_t events);
+    void signalFromIsr(uint32_t events);
+    void wakeFromIsr();
+    bool isSignaled() const;
+
 protected:
     void setAvailability(bool value);
+    uint32_t events() const;
 
     /**
      * @brief Virtual dispatcher for overriding in successor classes. Returns
@@ -63,6 +76,12 @@ private:
 
     uint32_t flags_;
     Time nextCallTime_;
+    etl::atomic<uint32_t> pending_;
+    uint32_t events_;
+    uint32_t readyBit_;
+
+    friend class Scheduler;
+    friend class LoadMeter;
 
 #if defined(FREERTOS_USED)
     TaskHandle_t xHandle_;
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * @file    scheduler.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of modules priority scheduler.
+ ******************************************************************************/
+
+#pragma once
+
+#include "module.h"
+
+#include "etl/atomic.h"
+#include "etl/delegate.h"
+#include "etl/vector.h"
+
+#ifndef SCHEDULER_MODULES_MAX
+#define SCHEDULER_MODULES_MAX 16
+#endif
+
+static_assert(SCHEDULER_MODULES_MAX <= 32, "Ready bitmap holds up to 32 modules");
+
+/**
+ * @brief Priority scheduler of module dispatchers for super loop work without
+ *      RTOS. Each call runs single due module with the highest priority, and
+ *      modules with equal priority are served in round-robin order. Optional
+ *      execution budget per dispatch is checked after each call. Modules
+ *      signaled from ISR are marked in lock-free ready bitmap and are due
+ *      immediately
+ */
+class Scheduler {
+public:
+    /**
+     * @brief Dispatch statistics of the module. Execution time is measured
+     *      around dispatcher call, response time from the moment module became
+     *      due (its call time, or the first dispatch pass that saw it signaled)
+     *      to the end of its dispatcher call
+     */
+    struct Stats {
+        uint32_t calls;
+        uint32_t overruns;
+        uint32_t lastUs;
+        uint32_t worstUs;
+        uint32_t lastResponseUs;
+        uint32_t worstResponseUs;
+    };
+
+    /**
+     * @brief Callback for dispatch budget overrun with module and its
+     *      execution time in microseconds
+     */
+    using OverrunDelegate = etl::delegate<void(Module*, uint32_t)>;
+
+    static bool add(Module* mod, uint8_t prior, uint32_t budgetUs = 0);
+    static bool remove(Module* mod);
+    static void setOverrunDelegate(const OverrunDelegate& overrunCb);
+
+    static bool dispatcher();
+    static void run();
+    static void runFor(uint32_t ms);
+    static Time delayTime();
+
+    static bool stats(const Module* mod, Stats& stats);
+
+    static void setReady(uint32_t bits);
+
+private:
+    /// @brief Registered module with scheduling parameters
+    struct Entry {
+        Module* mod;
+        uint8_t prior;
+        uint32_t budgetUs;
+        uint32_t order;
+        uint32_t releaseUs;     // Time when module became due
+        bool released;
+        Stats stats;
+    };
+
+    static bool isDue(const Entry& entry, const Time& now, uint32_t ready);
+    static void updateReadyBits();
+
+    static etl::vector<Entry, SCHEDULER_MODULES_MAX> entries_;
+    static etl::atomic<uint32_t> ready_;
+    static uint32_t order_;
+    static OverrunDelegate overrunCb_;
+
+    Scheduler() = delete;
+};
+
+/**
+ * @brief Module replaying timing profile, e.g. measured on target. Each call
+ *      busy waits for the next execution time of profile in cycle and asks
+ *      for the next call after period. Set of such modules under Scheduler
+ *      reproduces load of real modules, so worst response times of chosen
+ *      priorities and budgets are seen in Scheduler::stats() on host or target
+ */
+class ProfileModule : public Module {
+public:
+    ProfileModule(const uint32_t* execUs, uint32_t count, uint32_t periodMs);
+
+protected:
+    Time _dispatcher() override;
+
+private:
+    const uint32_t* execUs_;
+    uint32_t count_;
+    uint32_t index_;
+    uint32_t periodMs_;
+};
+
+/***************************** END OF FILE ************************************/
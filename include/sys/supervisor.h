@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * @file    supervisor.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of modules liveness supervisor.
+ ******************************************************************************/
+
+#pragma once
+
+#include "module.h"
+
+#include "etl/atomic.h"
+#include "etl/delegate.h"
+#include "etl/vector.h"
+
+#ifndef SUPERVISOR_MODULES_MAX
+#define SUPERVISOR_MODULES_MAX 16
+#endif
+
+/**
+ * @brief Software watchdog of modules liveness. Module is considered hung when
+ *      it didn't complete its dispatcher during timeout after the time it
+ *      became due. On hang the module name is saved in retain memory and CPU
+ *      restarts, so after restart System::resetReason() returns
+ *      kResetSupervisor and System::failedModule() returns the module name.
+ *      Check must be called from independent context: with FreeRTOS from
+ *      high priority task, because module state is taken from task state,
+ *      without RTOS from timer IRQ. Check skips pass that interrupts add()
+ *      or remove()
+ */
+class Supervisor {
+public:
+    /**
+     * @brief Callback for feeding of hardware watchdog. Called on every
+     *      check when all supervised modules are alive
+     */
+    using FeedDelegate = etl::delegate<void(void)>;
+
+    static bool add(Module* mod, const char* name, const Time& timeout);
+    static bool remove(Module* mod);
+    static void setFeedDelegate(const FeedDelegate& feedCb);
+
+    static bool check();
+
+private:
+    /// @brief Supervised module with its heartbeat state
+    struct Entry {
+        Module* mod;
+        const char* name;
+        Time timeout;
+        Time lastCall;
+        Time dueSince;
+    };
+
+    static etl::vector<Entry, SUPERVISOR_MODULES_MAX> entries_;
+    static etl::atomic<bool> updating_;
+    static FeedDelegate feedCb_;
+
+    Supervisor() = delete;
+};
+
+/***************************** END OF FILE ************************************/
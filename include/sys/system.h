@@ -37,8 +37,11 @@ public:
         kResetWatchdog,
         kResetSleep,
         kResetBrownout,
+        kResetSupervisor,
     };
 
+    static const int kFailedNameSize = 16;
+
     enum WakeupReason {
         kWakeupUnknown,
         kWakeupPin,
@@ -49,11 +52,13 @@ public:
     uint32_t frequency() const;
 
     void restart();
+    void restartByFailure(const char* name);
     void goToSleep() const;
 
     bool isFirstStart() const;
     uint16_t resetCounter() const;
     ResetReason resetReason() const;
+    const char* failedModule() const;
     WakeupReason wakeupReason() const;
 
     void setWakeupTime(uint32_t timeMs);
@@ -74,6 +79,9 @@ protected:
         uint16_t resetCounter;
         Version::Hardware hardware;
         Version::Firmware firmware;
+        uint16_t failedInit; // Need to be 0x55AA, fields below are initialized
+        uint16_t failedMark; // Need to be 0x55AA if failure recorded
+        char failedName[kFailedNameSize];
     };
 
     static SystemData systemData;
@@ -83,6 +91,7 @@ private:
 
     Version* version;
     char versionStr[Version::FW_SIZE];
+    char failedModule_[kFailedNameSize];
 
     ResetReason resetReason_;
     WakeupReason wakeupReason_;
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * @file    timerwheel.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of software timers wheel.
+ ******************************************************************************/
+
+#pragma once
+
+#include "timing.h"
+
+#include "etl/delegate.h"
+
+#ifndef TIMERWHEEL_SLOTS
+#define TIMERWHEEL_SLOTS 256
+#endif
+
+static_assert((TIMERWHEEL_SLOTS & (TIMERWHEEL_SLOTS - 1)) == 0,
+    "Timer wheel slots count must be power of two");
+
+class TimerWheel;
+
+/**
+ * @brief Software timer for TimerWheel. Owned by user, wheel only links it
+ *      into own slots, so no memory is allocated
+ */
+class SoftTimer {
+public:
+    /// @brief Callback for timer expiration
+    using Delegate = etl::delegate<void(void)>;
+
+    SoftTimer();
+    explicit SoftTimer(const Delegate& cb);
+    ~SoftTimer();
+
+    SoftTimer(const SoftTimer&) = delete;
+    SoftTimer& operator=(const SoftTimer&) = delete;
+
+    void setDelegate(const Delegate& cb);
+    bool isActive() const;
+
+private:
+    void unlink();
+
+    SoftTimer* prev_;
+    SoftTimer* next_;
+    SoftTimer** head_;
+    uint32_t expiry_;
+    uint32_t period_;
+    Delegate cb_;
+
+    friend class TimerWheel;
+};
+
+/**
+ * @brief Hashed timer wheel with one millisecond tick. Timers are linked into
+ *      slot by expiration tick, so start and stop are O(1) and each tick
+ *      checks only timers of single slot. Wheel is advanced by elapsed time
+ *      in dispatcher() from module loop, or by advance() from SysTick IRQ.
+ *      All calls for one wheel must be done from the same context, callbacks
+ *      are called in this context too and can restart or stop any timer
+ */
+class TimerWheel {
+public:
+    static constexpr uint32_t kSlots = TIMERWHEEL_SLOTS;
+
+    TimerWheel();
+
+    void start(SoftTimer& timer, const Time& delay, const Time& period = 0);
+    void stop(SoftTimer& timer);
+
+    void advance(uint32_t ms);
+    void dispatcher();
+
+    uint32_t tick() const;
+
+private:
+    void link(SoftTimer** head, SoftTimer& timer);
+    void expire();
+
+    SoftTimer* slots_[kSlots];
+    SoftTimer* expired_;
+    uint32_t tick_;
+    Time last_;
+};
+
+/***************************** END OF FILE ************************************/
@@ -14,6 +14,7 @@
 class Time {
 public:
     static Time now();
+    static uint32_t nowUs();
     static bool isPast(const Time& start, const Time& delay);
     static bool isPast(const Time& end);
     static uint32_t getSystemTime();
@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * @file    vtimer.h
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Header file of virtual timers multiplexed on single hardware timer.
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "etl/delegate.h"
+
+#ifndef VTIMER_MISSES_MAX
+#define VTIMER_MISSES_MAX 4
+#endif
+
+class VTimerService;
+
+/**
+ * @brief Virtual timer with microsecond deadline. Owned by user, service
+ *      only links it into own deadline list, so no memory is allocated
+ */
+class VTimer {
+public:
+    /// @brief Callback for timer expiration, called from alarm IRQ
+    using Delegate = etl::delegate<void(void)>;
+
+    VTimer();
+    explicit VTimer(const Delegate& cb);
+    ~VTimer();
+
+    VTimer(const VTimer&) = delete;
+    VTimer& operator=(const VTimer&) = delete;
+
+    void setDelegate(const Delegate& cb);
+    bool isActive() const;
+
+private:
+    VTimer* next_;
+    VTimerService* service_;
+    uint32_t deadline_;
+    uint32_t period_;
+    uint32_t misses_;   // Consecutive periods expired before callback
+    Delegate cb_;
+
+    friend class VTimerService;
+};
+
+/**
+ * @brief Service of virtual timers on single hardware alarm. Timers are kept
+ *      in list sorted by deadline and alarm is always set to the nearest one,
+ *      so hardware interrupt happens only when some timer expires. Deadlines
+ *      are 32-bit microseconds, so delays and periods must be shorter than
+ *      2^31 us. Timers can be started and stopped from any context including
+ *      callbacks. Realization provides microsecond time, alarm and lock, and
+ *      calls alarm() from its IRQ
+ */
+class VTimerService {
+public:
+    VTimerService();
+    virtual ~VTimerService() = default;
+
+    void start(VTimer& timer, uint32_t delayUs, uint32_t periodUs = 0);
+    void stop(VTimer& timer);
+
+    void alarm();
+
+    /**
+     * @brief Returns current time of service
+     *
+     * @return uint32_t time in microseconds
+     */
+    virtual uint32_t now() = 0;
+
+protected:
+    /**
+     * @brief Sets alarm after chosen delay, zero delay means as soon as
+     *      possible. Alarm may happen earlier when delay exceeds hardware
+     *      range, service sets it again then
+     *
+     * @param delayUs delay in microseconds
+     */
+    virtual void setAlarm(uint32_t delayUs) = 0;
+
+    /**
+     * @brief Cancels alarm
+     */
+    virtual void cancelAlarm() = 0;
+
+    /**
+     * @brief Locks deadline list from concurrent access of alarm IRQ and
+     *      other contexts. Never nested
+     */
+    virtual void lock() = 0;
+
+    /**
+     * @brief Unlocks deadline list
+     */
+    virtual void unlock() = 0;
+
+private:
+    void insert(VTimer& timer);
+    void unlink(VTimer& timer);
+    void rearm();
+
+    VTimer* head_;
+    bool inAlarm_;
+};
+
+/**
+ * @brief Virtual timers service in simulated time for host models. Time is
+ *      moved by advance() and alarms happen exactly at their time, alarm
+ *      range can be limited like of hardware counter
+ */
+class VTimerSim : public VTimerService {
+public:
+    explicit VTimerSim(uint32_t maxAlarmUs = UINT32_MAX);
+
+    uint32_t now() override;
+    void advance(uint32_t us);
+    uint32_t alarms() const;
+
+protected:
+    void setAlarm(uint32_t delayUs) override;
+    void cancelAlarm() override;
+    void lock() override;
+    void unlock() override;
+
+private:
+    uint32_t maxAlarmUs_;
+    uint32_t now_;
+    uint32_t alarmAt_;
+    bool armed_;
+    uint32_t alarms_;
+};
+
+/***************************** END OF FILE ************************************/
@@ -156,11 +156,12 @@ static const uint32_t CRC32_TABLE[CRC32_TABLE_SIZE] = {
  *      MaxLen: 15 bytes (127 bits)
  * @param  buf data array
  * @param  len of data
+ * @param  crcIn input previous 8-bit checksum (nullptr if not used)
  * @retval CRC-8 checksum byte
  */
-uint8_t crc8(const uint8_t *buf, uint32_t len)
+uint8_t crc8(const uint8_t *buf, uint32_t len, const uint8_t* crcIn)
 {
-    uint8_t crc = 0xFF;
+    uint8_t crc = crcIn == nullptr ? 0xFF : *crcIn;
 
     while (len--)
         crc = CRC8_TABLE[crc ^ *buf++];
@@ -252,16 +252,7 @@ void Debug::out(uint8_t cmd, const char* str)
     while (str[len] != 0)
         ++len;
 
-    uint8_t buf[5 + len];
-    buf[0] = kMsgFlag1;
-    buf[1] = kMsgFlag2;
-    buf[2] = len + sizeof(cmd);
-    buf[3] = cmd;
-    for (uint32_t i = 0; i < len; ++i) {
-        buf[4 + i] = str[i];
-    }
-    buf[sizeof(buf) - 1] = crc8(&buf[3], len + sizeof(cmd));
-    drv_->write(buf, sizeof(buf));
+    outFrame(cmd, reinterpret_cast<const uint8_t*>(str), len);
 }
 
 /**
@@ -277,17 +268,7 @@ void Debug::out(uint8_t cmd, const uint8_t* value, uint32_t len)
         return;
 
     assert(drv_ != nullptr);
-
-    uint8_t buf[5 + len];
-    buf[0] = kMsgFlag1;
-    buf[1] = kMsgFlag2;
-    buf[2] = len + sizeof(cmd);
-    buf[3] = cmd;
-    for (uint32_t i = 0; i < len; ++i) {
-        buf[4 + i] = value[i];
-    }
-    buf[sizeof(buf) - 1] = crc8(&buf[3], len + sizeof(cmd));
-    drv_->write(buf, sizeof(buf));
+    outFrame(cmd, value, len);
 }
 
 /**
@@ -326,6 +307,33 @@ void Debug::offTestPin()
     testPin_->reset();
 }
 
+/**
+ * @brief Sends message with header, data and CRC by single vectored write,
+ *      so data isn't copied into temporary frame buffer
+ *
+ * @param cmd command
+ * @param data data buffer
+ * @param len data length
+ */
+void Debug::outFrame(uint8_t cmd, const uint8_t* data, uint32_t len)
+{
+    const uint8_t header[] = {
+        kMsgFlag1,
+        kMsgFlag2,
+        static_cast<uint8_t>(len + sizeof(cmd)),
+        cmd,
+    };
+    const uint8_t crcCmd = crc8(&header[3], sizeof(cmd));
+    const uint8_t crc = crc8(data, len, &crcCmd);
+
+    const SerialDrv::WriteVec vec[] = {
+        { header, sizeof(header) },
+        { data, len },
+        { &crc, sizeof(crc) },
+    };
+    drv_->writev(vec, sizeof(vec) / sizeof(vec[0]));
+}
+
 /**
  * @brief Dispatcher for processing received debug data
  */
@@ -0,0 +1,298 @@
+/*******************************************************************************
+ * @file    dsp.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Streaming DSP stages for ADC samples.
+ ******************************************************************************/
+
+#include "dsp.h"
+
+namespace dsp {
+
+/**
+ * @brief Takes samples of single channel from interleaved block of frames,
+ *      e.g. from ADC scan group
+ *
+ * @param samples interleaved samples
+ * @param frames frames count
+ * @param stride samples count of frame
+ * @param channel channel index in frame
+ * @param out buffer for frames count of samples
+ * @return uint32_t samples count
+ */
+uint32_t extract(const uint16_t* samples, uint32_t frames, uint32_t stride, uint32_t channel, int32_t* out)
+{
+    if (channel >= stride)
+        return 0;
+
+    const uint16_t* in = &samples[channel];
+    for (uint32_t i = 0; i < frames; ++i) {
+        out[i] = in[i * stride];
+    }
+    return frames;
+}
+
+/**
+ * @brief Integer square root rounded down
+ *
+ * @param value argument
+ * @return uint32_t square root
+ */
+uint32_t isqrt(uint64_t value)
+{
+    uint64_t res = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= res + bit) {
+            value -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return static_cast<uint32_t>(res);
+}
+
+/**
+ * @brief Returns interval between edges captured by timer counter, which
+ *      is wrapped at timer period
+ *
+ * @param from earlier edge
+ * @param to later edge
+ * @param timerPeriod timer period, the last counter value
+ * @return uint32_t interval in timer ticks
+ */
+static uint32_t edgeInterval(uint32_t from, uint32_t to, uint32_t timerPeriod)
+{
+    return to >= from ? to - from : to + (timerPeriod - from) + 1;
+}
+
+/**
+ * @brief Computes frequency, duty cycle and jitter of pulse train over window
+ *      of consecutive edges, e.g. from timer captures ring. Intervals must be
+ *      shorter than timer period
+ *
+ * @param edges captured counter values
+ * @param count edges count
+ * @param timerPeriod timer period, the last counter value
+ * @param tickHz timer counter frequency
+ * @param bothEdges true when edges of both polarities are captured, the
+ *      first one is rising, otherwise edges of one polarity
+ * @param stats result statistics
+ * @return true if window holds at least one full period otherwise false
+ */
+bool pulseStats(const uint32_t* edges, uint32_t count, uint32_t timerPeriod, uint32_t tickHz,
+    bool bothEdges, PulseStats& stats)
+{
+    const uint32_t step = bothEdges ? 2 : 1;
+    if (edges == nullptr || count <= step)
+        return false;
+
+    const uint32_t periods = (count - 1) / step;
+    uint64_t total = 0;
+    uint64_t high = 0;
+    uint32_t periodMin = UINT32_MAX;
+    uint32_t periodMax = 0;
+    for (uint32_t i = 0; i < periods; ++i) {
+        const uint32_t* edge = &edges[i * step];
+        uint32_t period = edgeInterval(edge[0], edge[1], timerPeriod);
+        if (bothEdges) {
+            high += period;
+            period += edgeInterval(edge[1], edge[2], timerPeriod);
+        }
+        total += period;
+        periodMin = period < periodMin ? period : periodMin;
+        periodMax = period > periodMax ? period : periodMax;
+    }
+    if (total == 0)
+        return false;
+
+    // Deviation is summed in the second pass around known mean, so squares
+    // don't overflow for long windows
+    const uint32_t mean = static_cast<uint32_t>(total / periods);
+    uint64_t deviation = 0;
+    for (uint32_t i = 0; i < periods; ++i) {
+        const uint32_t* edge = &edges[i * step];
+        uint32_t period = edgeInterval(edge[0], edge[1], timerPeriod);
+        if (bothEdges)
+            period += edgeInterval(edge[1], edge[2], timerPeriod);
+        const uint64_t diff = period > mean ? period - mean : mean - period;
+        deviation += diff * diff;
+    }
+
+    stats.periods = periods;
+    stats.period = mean;
+    stats.periodMin = periodMin;
+    stats.periodMax = periodMax;
+    stats.jitter = isqrt(deviation / periods);
+    stats.frequency = static_cast<uint32_t>(static_cast<uint64_t>(tickHz) * 1000U * periods / total);
+    stats.duty = bothEdges ? static_cast<uint32_t>(high * 1000U / total) : 0;
+    return true;
+}
+
+/**
+ * @brief Construct a new empty Pipeline object
+ */
+Pipeline::Pipeline()
+    : stages_ {}
+    , count_(0)
+{
+}
+
+/**
+ * @brief Appends stage to the end of chain
+ *
+ * @param stage stage instance
+ * @return true if added otherwise false when DSP_PIPELINE_STAGES exceeded
+ */
+bool Pipeline::add(Stage& stage)
+{
+    if (count_ >= DSP_PIPELINE_STAGES)
+        return false;
+
+    stages_[count_++] = &stage;
+    return true;
+}
+
+/**
+ * @brief Processes block by all stages in place
+ *
+ * @param buf samples, result is written from the beginning
+ * @param len samples count
+ * @return uint32_t result samples count
+ */
+uint32_t Pipeline::process(int32_t* buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < count_ && len != 0; ++i) {
+        len = stages_[i]->process(buf, len, buf);
+    }
+    return len;
+}
+
+/**
+ * @brief Drops state of all stages
+ */
+void Pipeline::reset()
+{
+    for (uint32_t i = 0; i < count_; ++i) {
+        stages_[i]->reset();
+    }
+}
+
+/**
+ * @brief Construct a new Decimator object
+ *
+ * @param factor input samples count for one output sample
+ * @param shift right shift of samples sum
+ */
+Decimator::Decimator(uint32_t factor, uint32_t shift)
+    : factor_(factor != 0 ? factor : 1)
+    , shift_(shift)
+    , count_(0)
+    , acc_(0)
+{
+}
+
+uint32_t Decimator::process(const int32_t* in, uint32_t len, int32_t* out)
+{
+    uint32_t outLen = 0;
+    uint32_t i = 0;
+    while (i < len) {
+        // Sum of contiguous part is a plain loop, so compiler can vectorize it
+        uint32_t chunk = factor_ - count_;
+        if (chunk > len - i)
+            chunk = len - i;
+        int64_t acc = 0;
+        for (uint32_t j = 0; j < chunk; ++j) {
+            acc += in[i + j];
+        }
+        acc_ += acc;
+        count_ += chunk;
+        i += chunk;
+
+        if (count_ == factor_) {
+            out[outLen++] = static_cast<int32_t>(acc_ >> shift_);
+            acc_ = 0;
+            count_ = 0;
+        }
+    }
+    return outLen;
+}
+
+void Decimator::reset()
+{
+    count_ = 0;
+    acc_ = 0;
+}
+
+/**
+ * @brief Converts floating point coefficients to Q14 format. Intended for
+ *      initialization only
+ *
+ * @param b0 feedforward coefficient
+ * @param b1 feedforward coefficient
+ * @param b2 feedforward coefficient
+ * @param a1 feedback coefficient
+ * @param a2 feedback coefficient
+ * @return Coeffs coefficients in Q14 format
+ */
+Biquad::Coeffs Biquad::fromFloat(float b0, float b1, float b2, float a1, float a2)
+{
+    auto toQ14 = [](float value) {
+        const float scaled = value * kOne;
+        return static_cast<int32_t>(scaled >= 0 ? scaled + 0.5f : scaled - 0.5f);
+    };
+    return { toQ14(b0), toQ14(b1), toQ14(b2), toQ14(a1), toQ14(a2) };
+}
+
+/**
+ * @brief Construct a new Biquad object
+ *
+ * @param coeffs coefficients in Q14 format
+ */
+Biquad::Biquad(const Coeffs& coeffs)
+    : coeffs_(coeffs)
+    , x1_(0)
+    , x2_(0)
+    , y1_(0)
+    , y2_(0)
+{
+}
+
+uint32_t Biquad::process(const int32_t* in, uint32_t len, int32_t* out)
+{
+    // State is kept in locals, so loop works in registers
+    int32_t x1 = x1_, x2 = x2_, y1 = y1_, y2 = y2_;
+    for (uint32_t i = 0; i < len; ++i) {
+        const int32_t x = in[i];
+        const int64_t acc = static_cast<int64_t>(coeffs_.b0) * x + static_cast<int64_t>(coeffs_.b1) * x1
+            + static_cast<int64_t>(coeffs_.b2) * x2 - static_cast<int64_t>(coeffs_.a1) * y1
+            - static_cast<int64_t>(coeffs_.a2) * y2;
+        const int32_t y = static_cast<int32_t>((acc + (kOne >> 1)) >> 14);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        out[i] = y;
+    }
+    x1_ = x1;
+    x2_ = x2;
+    y1_ = y1;
+    y2_ = y2;
+    return len;
+}
+
+void Biquad::reset()
+{
+    x1_ = 0;
+    x2_ = 0;
+    y1_ = 0;
+    y2_ = 0;
+}
+
+}; // namespace dsp
+
+/***************************** END OF FILE ************************************/
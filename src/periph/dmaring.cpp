@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * @file    dmaring.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Circular DMA buffer positions and its host model.
+ ******************************************************************************/
+
+#include "periph/dmaring.h"
+
+/**
+ * @brief Construct a new DmaRing object
+ *
+ * @param size buffer size in items
+ */
+DmaRing::DmaRing(uint32_t size)
+    : size_(size)
+    , pos_(0)
+{
+}
+
+/**
+ * @brief Sets buffer size and starts reading from its beginning, must be
+ *      called on each DMA start
+ *
+ * @param size buffer size in items
+ */
+void DmaRing::reset(uint32_t size)
+{
+    size_ = size;
+    pos_ = 0;
+}
+
+/**
+ * @brief Finds data written since previous update, it is split into two
+ *      blocks when wrapped over buffer end. Data of the whole pass without
+ *      update is not detected, so update must happen at least on half and
+ *      full transfer events
+ *
+ * @param remaining remaining counter of DMA channel
+ * @param first block from the last read position, empty if no data
+ * @param second block from buffer beginning, empty if data isn't wrapped
+ * @return uint32_t new data length
+ */
+uint32_t DmaRing::update(uint32_t remaining, Block& first, Block& second)
+{
+    first = { pos_, 0 };
+    second = { 0, 0 };
+
+    // Position is zero after each circular reload
+    uint32_t pos = size_ - remaining;
+    if (remaining > size_ || pos >= size_)
+        pos = 0;
+
+    if (pos == pos_)
+        return 0;
+
+    if (pos < pos_) {
+        first.len = size_ - pos_;
+        second.len = pos;
+    } else {
+        first.len = pos - pos_;
+    }
+    pos_ = pos;
+    return first.len + second.len;
+}
+
+/**
+ * @brief Returns offset of the first unread item
+ *
+ * @return uint32_t offset in items
+ */
+uint32_t DmaRing::pos() const
+{
+    return pos_;
+}
+
+/**
+ * @brief Returns count of items written into buffer since DMA start. Count
+ *      is kept by half and full transfer events, items written after the
+ *      last event are taken from remaining counter, also when event is still
+ *      pending
+ *
+ * @param counted count of items at the last half or full transfer event
+ * @param remaining remaining counter of DMA channel
+ * @param size buffer size in items, power of two
+ * @return uint32_t written items count
+ */
+uint32_t DmaRing::written(uint32_t counted, uint32_t remaining, uint32_t size)
+{
+    const uint32_t pos = size - remaining;
+    return counted + ((pos - counted) & (size - 1));
+}
+
+/**
+ * @brief Construct a new DmaSim object started on the buffer
+ *
+ * @param buf destination buffer
+ * @param size buffer size
+ */
+DmaSim::DmaSim(uint8_t* buf, uint32_t size)
+    : buf_(buf)
+    , size_(size)
+    , remaining_(size)
+{
+}
+
+/**
+ * @brief Sets the callback of transfer events
+ *
+ * @param cb callback delegate
+ */
+void DmaSim::setDelegate(const Delegate& cb)
+{
+    cb_ = cb;
+}
+
+/**
+ * @brief Writes items like peripheral requests. Half event happens when
+ *      counter passes half of buffer, full event when it is reloaded
+ *
+ * @param data received items
+ * @param len items count
+ */
+void DmaSim::receive(const uint8_t* data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i) {
+        buf_[size_ - remaining_] = data[i];
+        --remaining_;
+        if (remaining_ == size_ / 2) {
+            cb_.call_if(kHalf);
+        } else if (remaining_ == 0) {
+            remaining_ = size_;
+            cb_.call_if(kFull);
+        }
+    }
+}
+
+/**
+ * @brief Returns remaining counter of channel
+ *
+ * @return uint32_t items count to the end of buffer
+ */
+uint32_t DmaSim::remaining() const
+{
+    return remaining_;
+}
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,196 @@
+/*******************************************************************************
+ * @file    loopbackcan.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Loopback CAN bus driver for host models.
+ ******************************************************************************/
+
+#include "periph/loopbackcan.h"
+#include "timing.h"
+
+/**
+ * @brief Construct a new LoopbackCan object reading own messages at 500 kbit/s
+ */
+LoopbackCan::LoopbackCan()
+    : peer_(this)
+    , baud_(CanBaud::Baud500k)
+    , busFreeUs_(0)
+    , frames_(0)
+    , overruns_(0)
+    , ring_ {}
+    , head_(0)
+    , count_(0)
+{
+}
+
+/**
+ * @brief Set current driver configuration for further usage
+ *
+ * @param drvConfig CanBaud value
+ * @return true if configuration accepted otherwise false
+ */
+bool LoopbackCan::setConfig(const void* drvConfig)
+{
+    if (isOpen() || drvConfig == nullptr)
+        return false;
+
+    baud_ = *static_cast<const CanBaud*>(drvConfig);
+    return true;
+}
+
+/**
+ * @brief Open driver with empty receive ring
+ *
+ * @return true if success opened otherwise false
+ */
+bool LoopbackCan::open()
+{
+    head_ = 0;
+    count_ = 0;
+    busFreeUs_ = Time::nowUs();
+    setOpened(true);
+    return true;
+}
+
+/**
+ * @brief Close driver
+ */
+void LoopbackCan::close()
+{
+    setOpened(false);
+}
+
+/**
+ * @brief Execute chosen command on driver
+ *
+ * @param cmd command to execute
+ * @param pValue pointer for command data
+ * @return true if command executed successfully otherwise false
+ */
+bool LoopbackCan::ioctl(uint32_t cmd, void* pValue)
+{
+    if (pValue == nullptr)
+        return false;
+
+    switch (cmd) {
+    case kGetOverruns:
+        *static_cast<uint32_t*>(pValue) = overruns_;
+        return true;
+
+    case kGetTxDepth: {
+        // Messages of peer ring are on bus until their receive time
+        const uint32_t now = Time::nowUs();
+        uint32_t depth = 0;
+        for (uint32_t i = 0; i < peer_->count_; ++i) {
+            const Frame& frame = peer_->ring_[(peer_->head_ + i) % CAN_LOOPBACK_SIZE];
+            if (static_cast<int32_t>(frame.readyUs - now) > 0)
+                ++depth;
+        }
+        *static_cast<uint32_t*>(pValue) = depth;
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Connects pair of drivers into bus of two nodes
+ *
+ * @param peer another driver
+ */
+void LoopbackCan::connect(LoopbackCan& peer)
+{
+    peer_ = &peer;
+    peer.peer_ = this;
+}
+
+/**
+ * @brief Calls RX delegate when some message passed the bus. Called from
+ *      loop of host model like reception IRQ
+ */
+void LoopbackCan::poll()
+{
+    if (isOpen() && count_ != 0 && static_cast<int32_t>(Time::nowUs() - ring_[head_].readyUs) >= 0)
+        rxCb().call_if();
+}
+
+/**
+ * @brief Puts message on bus after messages of both nodes
+ *
+ * @param msg CAN message structure
+ * @return int32_t 1 if success, 0 if receive ring of peer is full, -1 on error
+ */
+int32_t LoopbackCan::write(const CanMsg& msg)
+{
+    if (!isOpen() || msg.size > CAN_DATA_MAX_SIZE)
+        return -1;
+    if (peer_->count_ >= CAN_LOOPBACK_SIZE) {
+        ++peer_->overruns_;
+        return 0;
+    }
+
+    static const uint32_t kBauds[] = { 50000, 125000, 250000, 500000, 1000000 };
+    const uint32_t baud = kBauds[static_cast<uint32_t>(baud_)];
+
+    // Both nodes share bus, so message waits for the end of previous ones
+    const uint32_t now = Time::nowUs();
+    uint32_t start = static_cast<int32_t>(busFreeUs_ - now) > 0 ? busFreeUs_ : now;
+    if (static_cast<int32_t>(peer_->busFreeUs_ - start) > 0)
+        start = peer_->busFreeUs_;
+    busFreeUs_ = start + (frameBits(msg) * 1000000U + baud - 1) / baud;
+    peer_->busFreeUs_ = busFreeUs_;
+
+    Frame& frame = peer_->ring_[(peer_->head_ + peer_->count_) % CAN_LOOPBACK_SIZE];
+    frame.msg = msg;
+    frame.readyUs = busFreeUs_;
+    ++peer_->count_;
+    ++frames_;
+    return 1;
+}
+
+/**
+ * @brief Reads message which passed the bus
+ *
+ * @param msg CAN message structure
+ * @return int32_t 1 if success, 0 if no messages, -1 on error
+ */
+int32_t LoopbackCan::read(CanMsg& msg)
+{
+    if (!isOpen())
+        return -1;
+    if (count_ == 0 || static_cast<int32_t>(Time::nowUs() - ring_[head_].readyUs) < 0)
+        return 0;
+
+    msg = ring_[head_].msg;
+#if defined(RX_TIMESTAMP_USED)
+    msg.timestamp = ring_[head_].readyUs;
+#endif
+    head_ = (head_ + 1) % CAN_LOOPBACK_SIZE;
+    --count_;
+    return 1;
+}
+
+/**
+ * @brief Returns count of messages put on bus by this node
+ *
+ * @return uint32_t messages count
+ */
+uint32_t LoopbackCan::frames() const
+{
+    return frames_;
+}
+
+/**
+ * @brief Returns bits count of data frame without bit stuffing: standard
+ *      identifiers up to 0x7FF, extended above
+ *
+ * @param msg CAN message structure
+ * @return uint32_t bits count including interframe space
+ */
+uint32_t LoopbackCan::frameBits(const CanMsg& msg)
+{
+    return (msg.id > 0x7FF ? 67U : 47U) + msg.size * 8U;
+}
+
+/***************************** END OF FILE ************************************/
@@ -6,98 +6,454 @@
 
 #include "periph/serialdrv.h"
 
+#include <cstring>
+
 SerialDrv::SerialDrv()
-    : reg_(-1)
+    : busy_ { false, false }
+    , asyncBus_ { false, false }
+    , asyncAddr_(false)
+    , reg_(-1)
     , addr_(-1)
 {
 #if defined(FREERTOS_USED)
-    mutex_ = xSemaphoreCreateBinary();
-    xSemaphoreGive(mutex_);
+    for (auto& mutex : mutex_) {
+        mutex = xSemaphoreCreateBinary();
+        xSemaphoreGive(mutex);
+    }
 #endif
 }
 
 int32_t SerialDrv::write(const void* buf, uint32_t len)
 {
-#if defined(FREERTOS_USED)
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-#endif
+    if (!take(Direction::Tx, false))
+        return -1;
     int32_t res = write_(buf, len);
-#if defined(FREERTOS_USED)
-    xSemaphoreGive(mutex_);
-#endif
+    give(Direction::Tx, false);
     return res;
 }
 
 int32_t SerialDrv::write(uint8_t reg, const void* buf, uint32_t len)
 {
-#if defined(FREERTOS_USED)
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-#endif
+    if (!take(Direction::Tx, true))
+        return -1;
     reg_ = reg;
     int32_t res = write_(buf, len);
     reg_ = -1; // Mark that no actual register value after writing
-#if defined(FREERTOS_USED)
-    xSemaphoreGive(mutex_);
-#endif
+    give(Direction::Tx, true);
     return res;
 }
 
 int32_t SerialDrv::write(uint32_t addr, uint8_t reg, const void* buf, uint32_t len)
 {
-#if defined(FREERTOS_USED)
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-#endif
+    if (!take(Direction::Tx, true))
+        return -1;
     addr_ = addr;
     reg_ = reg;
     int32_t res = write_(buf, len);
     addr_ = -1;
     reg_ = -1; // Mark that no actual register value after writing
-#if defined(FREERTOS_USED)
-    xSemaphoreGive(mutex_);
-#endif
+    give(Direction::Tx, true);
     return res;
 }
 
 int32_t SerialDrv::read(void* buf, uint32_t len)
 {
-    #if defined(FREERTOS_USED)
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-#endif
+    if (!take(Direction::Rx, false))
+        return -1;
     int32_t res = read_(buf, len);
-#if defined(FREERTOS_USED)
-    xSemaphoreGive(mutex_);
-#endif
+    give(Direction::Rx, false);
     return res;
 }
 
 int32_t SerialDrv::read(uint8_t reg, void* buf, uint32_t len)
 {
-#if defined(FREERTOS_USED)
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-#endif
+    if (!take(Direction::Rx, true))
+        return -1;
     reg_ = reg;
     int32_t res = read_(buf, len);
     reg_ = -1; // Mark that no actual register value after writing
-#if defined(FREERTOS_USED)
-    xSemaphoreGive(mutex_);
-#endif
+    give(Direction::Rx, true);
     return res;
 }
 
 int32_t SerialDrv::read(uint32_t addr, uint8_t reg, void* buf, uint32_t len)
 {
-#if defined(FREERTOS_USED)
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-#endif
+    if (!take(Direction::Rx, true))
+        return -1;
     addr_ = addr;
     reg_ = reg;
     int32_t res = read_(buf, len);
     addr_ = -1;
     reg_ = -1; // Mark that no actual register value after writing
+    give(Direction::Rx, true);
+    return res;
+}
+
+int32_t SerialDrv::writev(const WriteVec* vec, uint32_t count)
+{
+    if (!take(Direction::Tx, false))
+        return -1;
+    int32_t res = writev_(vec, count);
+    give(Direction::Tx, false);
+    return res;
+}
+
+int32_t SerialDrv::writev(uint8_t reg, const WriteVec* vec, uint32_t count)
+{
+    if (!take(Direction::Tx, true))
+        return -1;
+    reg_ = reg;
+    int32_t res = writev_(vec, count);
+    reg_ = -1; // Mark that no actual register value after writing
+    give(Direction::Tx, true);
+    return res;
+}
+
+int32_t SerialDrv::writev(uint32_t addr, uint8_t reg, const WriteVec* vec, uint32_t count)
+{
+    if (!take(Direction::Tx, true))
+        return -1;
+    addr_ = addr;
+    reg_ = reg;
+    int32_t res = writev_(vec, count);
+    addr_ = -1;
+    reg_ = -1; // Mark that no actual register value after writing
+    give(Direction::Tx, true);
+    return res;
+}
+
+int32_t SerialDrv::readv(const ReadVec* vec, uint32_t count)
+{
+    if (!take(Direction::Rx, false))
+        return -1;
+    int32_t res = readv_(vec, count);
+    give(Direction::Rx, false);
+    return res;
+}
+
+int32_t SerialDrv::readv(uint8_t reg, const ReadVec* vec, uint32_t count)
+{
+    if (!take(Direction::Rx, true))
+        return -1;
+    reg_ = reg;
+    int32_t res = readv_(vec, count);
+    reg_ = -1; // Mark that no actual register value after reading
+    give(Direction::Rx, true);
+    return res;
+}
+
+int32_t SerialDrv::readv(uint32_t addr, uint8_t reg, const ReadVec* vec, uint32_t count)
+{
+    if (!take(Direction::Rx, true))
+        return -1;
+    addr_ = addr;
+    reg_ = reg;
+    int32_t res = readv_(vec, count);
+    addr_ = -1;
+    reg_ = -1; // Mark that no actual register value after reading
+    give(Direction::Rx, true);
+    return res;
+}
+
+DrvResult SerialDrv::writeAsync(const void* buf, uint32_t len, const DoneDelegate& doneCb)
+{
+    if (!beginAsync(Direction::Tx, false, doneCb))
+        return DrvResult::Error;
+    return startAsync(Direction::Tx, writeAsync_(buf, len));
+}
+
+DrvResult SerialDrv::writeAsync(uint8_t reg, const void* buf, uint32_t len, const DoneDelegate& doneCb)
+{
+    if (!beginAsync(Direction::Tx, true, doneCb))
+        return DrvResult::Error;
+    reg_ = reg;
+    return startAsync(Direction::Tx, writeAsync_(buf, len));
+}
+
+DrvResult SerialDrv::writeAsync(uint32_t addr, uint8_t reg, const void* buf, uint32_t len,
+    const DoneDelegate& doneCb)
+{
+    if (!beginAsync(Direction::Tx, true, doneCb))
+        return DrvResult::Error;
+    asyncAddr_ = true;
+    addr_ = addr;
+    reg_ = reg;
+    return startAsync(Direction::Tx, writeAsync_(buf, len));
+}
+
+DrvResult SerialDrv::readAsync(void* buf, uint32_t len, const DoneDelegate& doneCb)
+{
+    if (!beginAsync(Direction::Rx, false, doneCb))
+        return DrvResult::Error;
+    return startAsync(Direction::Rx, readAsync_(buf, len));
+}
+
+DrvResult SerialDrv::readAsync(uint8_t reg, void* buf, uint32_t len, const DoneDelegate& doneCb)
+{
+    if (!beginAsync(Direction::Rx, true, doneCb))
+        return DrvResult::Error;
+    reg_ = reg;
+    return startAsync(Direction::Rx, readAsync_(buf, len));
+}
+
+DrvResult SerialDrv::readAsync(uint32_t addr, uint8_t reg, void* buf, uint32_t len,
+    const DoneDelegate& doneCb)
+{
+    if (!beginAsync(Direction::Rx, true, doneCb))
+        return DrvResult::Error;
+    asyncAddr_ = true;
+    addr_ = addr;
+    reg_ = reg;
+    return startAsync(Direction::Rx, readAsync_(buf, len));
+}
+
+bool SerialDrv::isBusy() const
+{
+    return busy_[0] || busy_[1];
+}
+
+int32_t SerialDrv::writev_(const WriteVec* vec, uint32_t count)
+{
+    uint8_t buf[SERIALDRV_GATHER_SIZE];
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (vec[i].len > sizeof(buf) - len)
+            return writeEach(vec, count);
+        memcpy(&buf[len], vec[i].buf, vec[i].len);
+        len += vec[i].len;
+    }
+    return write_(buf, len);
+}
+
+int32_t SerialDrv::readv_(const ReadVec* vec, uint32_t count)
+{
+    uint8_t buf[SERIALDRV_GATHER_SIZE];
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (vec[i].len > sizeof(buf) - len)
+            return readEach(vec, count);
+        len += vec[i].len;
+    }
+
+    const int32_t res = read_(buf, len);
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count && res > 0 && pos < static_cast<uint32_t>(res); ++i) {
+        const uint32_t rest = res - pos;
+        const uint32_t size = vec[i].len < rest ? vec[i].len : rest;
+        memcpy(vec[i].buf, &buf[pos], size);
+        pos += size;
+    }
+    return res;
+}
+
+/**
+ * @brief Writes segments by single write_ call per segment, used when they
+ *      don't fit gather buffer. Only for transfers without register
+ *
+ * @param vec data segments array
+ * @param count segments count
+ * @return int32_t actually written data length, -1 on error
+ */
+int32_t SerialDrv::writeEach(const WriteVec* vec, uint32_t count)
+{
+    // Register prefix would be repeated before each segment
+    if (reg_ >= 0)
+        return -1;
+
+    int32_t total = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (vec[i].len == 0)
+            continue;
+        const int32_t res = write_(vec[i].buf, vec[i].len);
+        if (res < 0)
+            return total > 0 ? total : res;
+        total += res;
+        if (static_cast<uint32_t>(res) < vec[i].len)
+            break;
+    }
+    return total;
+}
+
+/**
+ * @brief Reads segments by single read_ call per segment, used when they
+ *      don't fit gather buffer. Only for transfers without register
+ *
+ * @param vec data segments array
+ * @param count segments count
+ * @return int32_t actually readed data length, -1 on error
+ */
+int32_t SerialDrv::readEach(const ReadVec* vec, uint32_t count)
+{
+    // Register prefix would be repeated before each segment
+    if (reg_ >= 0)
+        return -1;
+
+    int32_t total = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (vec[i].len == 0)
+            continue;
+        const int32_t res = read_(vec[i].buf, vec[i].len);
+        if (res < 0)
+            return total > 0 ? total : res;
+        total += res;
+        if (static_cast<uint32_t>(res) < vec[i].len)
+            break;
+    }
+    return total;
+}
+
+DrvResult SerialDrv::writeAsync_(const void* buf, uint32_t len)
+{
+    const int32_t res = write_(buf, len);
+    if (res < 0)
+        return DrvResult::Error;
+    finishAsync(res, Direction::Tx);
+    return DrvResult::Finished;
+}
+
+DrvResult SerialDrv::readAsync_(void* buf, uint32_t len)
+{
+    const int32_t res = read_(buf, len);
+    if (res < 0)
+        return DrvResult::Error;
+    finishAsync(res, Direction::Rx);
+    return DrvResult::Finished;
+}
+
+void SerialDrv::finishAsync(int32_t len, Direction dir)
+{
+    const uint8_t side = static_cast<uint8_t>(dir);
+    const DoneDelegate doneCb = doneCb_[side];
+    const bool bus = asyncBus_[side];
+    releaseAsync(dir);
+    give(dir, bus);
+    doneCb.call_if(len < 0 ? DrvResult::Error : DrvResult::Finished, len);
+}
+
+void SerialDrv::finishAsyncFromIsr(int32_t len, Direction dir)
+{
+    const uint8_t side = static_cast<uint8_t>(dir);
+    const DoneDelegate doneCb = doneCb_[side];
+    const bool bus = asyncBus_[side];
+    releaseAsync(dir);
 #if defined(FREERTOS_USED)
-    xSemaphoreGive(mutex_);
+    BaseType_t woken = pdFALSE;
+    if (bus || !isDuplex() || dir == Direction::Tx)
+        xSemaphoreGiveFromISR(mutex_[static_cast<uint8_t>(Direction::Tx)], &woken);
+    if (bus || !isDuplex() || dir == Direction::Rx)
+        xSemaphoreGiveFromISR(mutex_[static_cast<uint8_t>(Direction::Rx)], &woken);
+    portYIELD_FROM_ISR(woken);
+#else
+    (void)bus;
 #endif
-    return res;
+    doneCb.call_if(len < 0 ? DrvResult::Error : DrvResult::Finished, len);
+}
+
+/**
+ * @brief Takes directions used by transfer. Transfers with register and all
+ *      transfers of half duplex driver take both directions, transmit one
+ *      first. With FreeRTOS waits for other transfers including asynchronous
+ *      ones, without RTOS fails if asynchronous transfer holds direction, so
+ *      receive buffer has single consumer
+ *
+ * @param dir transfer direction
+ * @param bus true if transfer takes whole bus, e.g. with register
+ * @return true if directions taken otherwise false
+ */
+bool SerialDrv::take(Direction dir, bool bus)
+{
+    bus = bus || !isDuplex();
+#if defined(FREERTOS_USED)
+    if (bus || dir == Direction::Tx)
+        xSemaphoreTake(mutex_[static_cast<uint8_t>(Direction::Tx)], portMAX_DELAY);
+    if (bus || dir == Direction::Rx)
+        xSemaphoreTake(mutex_[static_cast<uint8_t>(Direction::Rx)], portMAX_DELAY);
+    return true;
+#else
+    if (bus)
+        return !busy_[0] && !busy_[1];
+    return !busy_[static_cast<uint8_t>(dir)];
+#endif
+}
+
+/**
+ * @brief Gives directions taken by take() with the same arguments
+ *
+ * @param dir transfer direction
+ * @param bus true if transfer takes whole bus, e.g. with register
+ */
+void SerialDrv::give(Direction dir, bool bus)
+{
+#if defined(FREERTOS_USED)
+    bus = bus || !isDuplex();
+    if (bus || dir == Direction::Rx)
+        xSemaphoreGive(mutex_[static_cast<uint8_t>(Direction::Rx)]);
+    if (bus || dir == Direction::Tx)
+        xSemaphoreGive(mutex_[static_cast<uint8_t>(Direction::Tx)]);
+#else
+    (void)dir;
+    (void)bus;
+#endif
+}
+
+/**
+ * @brief Takes direction for asynchronous operation, it is held until
+ *      completion
+ *
+ * @param dir transfer direction
+ * @param bus true if transfer takes whole bus, e.g. with register
+ * @param doneCb completion callback
+ * @return true if driver taken otherwise false
+ */
+bool SerialDrv::beginAsync(Direction dir, bool bus, const DoneDelegate& doneCb)
+{
+    if (!take(dir, bus))
+        return false;
+
+    const uint8_t side = static_cast<uint8_t>(dir);
+    asyncBus_[side] = bus || !isDuplex();
+    if (asyncBus_[side])
+        busy_[side ^ 1] = true;
+    busy_[side] = true;
+    doneCb_[side] = doneCb;
+    return true;
+}
+
+/**
+ * @brief Releases direction if asynchronous operation was not started
+ *
+ * @param dir transfer direction
+ * @param result start result
+ * @return DrvResult start result
+ */
+DrvResult SerialDrv::startAsync(Direction dir, DrvResult result)
+{
+    if (result == DrvResult::Error) {
+        const bool bus = asyncBus_[static_cast<uint8_t>(dir)];
+        releaseAsync(dir);
+        give(dir, bus);
+    }
+    return result;
+}
+
+/**
+ * @brief Resets operation parameters and busy state of direction
+ *
+ * @param dir transfer direction
+ */
+void SerialDrv::releaseAsync(Direction dir)
+{
+    const uint8_t side = static_cast<uint8_t>(dir);
+    if (asyncBus_[side]) {
+        if (asyncAddr_) {
+            asyncAddr_ = false;
+            addr_ = -1;
+        }
+        reg_ = -1;
+        asyncBus_[side] = false;
+        busy_[side ^ 1] = false;
+    }
+    busy_[side] = false;
 }
 
 int32_t SerialDrv::getReg() const
@@ -115,4 +471,14 @@ void SerialDrv::setAddr(int32_t addr)
     addr_ = addr;
 }
 
+bool SerialDrv::lock()
+{
+    return take(Direction::Tx, true);
+}
+
+void SerialDrv::unlock()
+{
+    give(Direction::Tx, true);
+}
+
 /***************************** END OF FILE ************************************/
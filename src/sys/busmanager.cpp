@@ -0,0 +1,237 @@
+/*******************************************************************************
+ * @file    busmanager.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Shared bus transactions manager.
+ ******************************************************************************/
+
+#include "busmanager.h"
+#include "periph/i2c.h"
+#include "periph/spi.h"
+
+#if defined(FREERTOS_USED) && defined(ESP_PLATFORM)
+#define BUSMANAGER_ENTER_CRITICAL() taskENTER_CRITICAL(&lock_)
+#define BUSMANAGER_EXIT_CRITICAL() taskEXIT_CRITICAL(&lock_)
+#elif defined(FREERTOS_USED)
+#define BUSMANAGER_ENTER_CRITICAL() taskENTER_CRITICAL()
+#define BUSMANAGER_EXIT_CRITICAL() taskEXIT_CRITICAL()
+#else
+#define BUSMANAGER_ENTER_CRITICAL()
+#define BUSMANAGER_EXIT_CRITICAL()
+#endif
+
+/**
+ * @brief Construct a new BusManager object without driver
+ */
+BusManager::BusManager()
+    : head_(nullptr)
+    , tail_(nullptr)
+    , stats_ {}
+#if defined(FREERTOS_USED) && defined(ESP_PLATFORM)
+    , lock_(portMUX_INITIALIZER_UNLOCKED)
+#endif
+{
+}
+
+#if defined(FREERTOS_USED)
+/**
+ * @brief FreeRTOS ONLY. Construct a new BusManager object with internal task
+ *
+ * @param name human readable task name
+ * @param stack task stack size
+ * @param prior task priority
+ */
+BusManager::BusManager(const char* name, uint32_t stack, UBaseType_t prior)
+    : DrvModule(name, stack, prior)
+    , head_(nullptr)
+    , tail_(nullptr)
+    , stats_ {}
+#if defined(ESP_PLATFORM)
+    , lock_(portMUX_INITIALIZER_UNLOCKED)
+#endif
+{
+}
+#endif
+
+/**
+ * @brief Queues transaction and wakes manager. Can be called from any task,
+ *      but not from IRQ
+ *
+ * @param transfer transaction, must be valid until completion
+ * @return true if queued otherwise false
+ */
+bool BusManager::submit(BusTransfer& transfer)
+{
+    if (transfer.pending || transfer.buf == nullptr || transfer.len == 0)
+        return false;
+
+    transfer.pending = true;
+    transfer.next = nullptr;
+
+    BUSMANAGER_ENTER_CRITICAL();
+    if (tail_ != nullptr)
+        tail_->next = &transfer;
+    else
+        head_ = &transfer;
+    tail_ = &transfer;
+    BUSMANAGER_EXIT_CRITICAL();
+
+    signal(kEventQueued);
+    return true;
+}
+
+/**
+ * @brief Returns bus usage counters. Ratio of transfers and transactions
+ *      shows merge efficiency, busy time over period shows bus utilization
+ *
+ * @return Stats counters copy
+ */
+BusManager::Stats BusManager::stats() const
+{
+    return stats_;
+}
+
+/**
+ * @brief Resets bus usage counters
+ */
+void BusManager::resetStats()
+{
+    stats_ = {};
+}
+
+/**
+ * @brief Runs all queued transactions. New transactions queued during run
+ *      are processed on the next call without delay
+ *
+ * @return Time next call delay
+ */
+Time BusManager::_dispatcher()
+{
+    BUSMANAGER_ENTER_CRITICAL();
+    BusTransfer* list = head_;
+    head_ = nullptr;
+    tail_ = nullptr;
+    BUSMANAGER_EXIT_CRITICAL();
+
+    while (list != nullptr) {
+        BusTransfer* burst[BUSMANAGER_BURST_MAX];
+        uint32_t count = 0;
+        burst[count++] = list;
+        list = list->next;
+
+        // Transactions of other devices are skipped, the first not mergeable
+        // transaction of the same device stops search to keep its order
+        BusTransfer* prev = nullptr;
+        BusTransfer* it = list;
+        while (it != nullptr && count < BUSMANAGER_BURST_MAX) {
+            if (!isSameDevice(*burst[0], *it)) {
+                prev = it;
+                it = it->next;
+                continue;
+            }
+            if (!canMerge(*burst[count - 1], *it))
+                break;
+
+            BusTransfer* next = it->next;
+            if (prev != nullptr)
+                prev->next = next;
+            else
+                list = next;
+            burst[count++] = it;
+            it = next;
+        }
+        execute(burst, count);
+    }
+
+    return head_ != nullptr ? Time(0) : Time(BUSMANAGER_IDLE_MS);
+}
+
+/**
+ * @brief Checks that transactions are addressed to the same device
+ *
+ * @param a first transaction
+ * @param b second transaction
+ * @return true if the same device otherwise false
+ */
+bool BusManager::isSameDevice(const BusTransfer& a, const BusTransfer& b)
+{
+    return a.addr == b.addr && a.cs == b.cs;
+}
+
+/**
+ * @brief Checks that the next transaction continues previous one from the
+ *      next register. Registers are counted by bytes
+ *
+ * @param prev previous transaction
+ * @param next next transaction
+ * @return true if transactions can be merged otherwise false
+ */
+bool BusManager::canMerge(const BusTransfer& prev, const BusTransfer& next)
+{
+    return prev.burst && next.burst && prev.dir == next.dir && prev.reg >= 0
+        && next.reg == prev.reg + static_cast<int32_t>(prev.len);
+}
+
+/**
+ * @brief Runs merged transactions by single vectored transfer and completes
+ *      them. Transferred length is shared between requesters in order
+ *
+ * @param burst transactions of single transfer
+ * @param count transactions count
+ */
+void BusManager::execute(BusTransfer* const* burst, uint32_t count)
+{
+    SerialDrv* bus = drv();
+    const BusTransfer& first = *burst[0];
+    const uint32_t startUs = Time::nowUs();
+
+    if (first.cs != nullptr)
+        bus->ioctl(Spi::kSetCs, first.cs);
+    if (first.addr >= 0 && first.reg < 0) {
+        int32_t addr = first.addr;
+        bus->ioctl(I2c::kSetAddress, &addr);
+    }
+
+    int32_t res;
+    if (first.dir == BusTransfer::kRead) {
+        SerialDrv::ReadVec vec[BUSMANAGER_BURST_MAX];
+        for (uint32_t i = 0; i < count; ++i) {
+            vec[i] = { burst[i]->buf, burst[i]->len };
+        }
+        if (first.reg < 0)
+            res = bus->readv(vec, count);
+        else if (first.addr < 0)
+            res = bus->readv(static_cast<uint8_t>(first.reg), vec, count);
+        else
+            res = bus->readv(static_cast<uint32_t>(first.addr), static_cast<uint8_t>(first.reg), vec, count);
+    } else {
+        SerialDrv::WriteVec vec[BUSMANAGER_BURST_MAX];
+        for (uint32_t i = 0; i < count; ++i) {
+            vec[i] = { burst[i]->buf, burst[i]->len };
+        }
+        if (first.reg < 0)
+            res = bus->writev(vec, count);
+        else if (first.addr < 0)
+            res = bus->writev(static_cast<uint8_t>(first.reg), vec, count);
+        else
+            res = bus->writev(static_cast<uint32_t>(first.addr), static_cast<uint8_t>(first.reg), vec, count);
+    }
+
+    stats_.busyUs += Time::nowUs() - startUs;
+    stats_.transfers += count;
+    ++stats_.transactions;
+
+    uint32_t rest = res > 0 ? res : 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        BusTransfer& transfer = *burst[i];
+        const uint32_t len = transfer.len < rest ? transfer.len : rest;
+        rest -= len;
+        transfer.next = nullptr;
+        transfer.pending = false;
+        if (res < 0)
+            transfer.done.call_if(DrvResult::Error, -1);
+        else
+            transfer.done.call_if(DrvResult::Finished, static_cast<int32_t>(len));
+    }
+}
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,384 @@
+/*******************************************************************************
+ * @file    executor.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Work-sharing executor of module dispatchers between CPU cores.
+ ******************************************************************************/
+
+#include "executor.h"
+
+#if defined(FREERTOS_USED) || defined(POSIX_USED)
+
+#if defined(POSIX_USED)
+#include <ctime>
+
+/// Mutex for queues access and workers notification from different threads
+static pthread_mutex_t executorLock = PTHREAD_MUTEX_INITIALIZER;
+#define EXECUTOR_ENTER_CRITICAL() pthread_mutex_lock(&executorLock)
+#define EXECUTOR_EXIT_CRITICAL() pthread_mutex_unlock(&executorLock)
+#elif defined(ESP_PLATFORM)
+/// Spinlock for queues access from different cores
+static portMUX_TYPE executorLock = portMUX_INITIALIZER_UNLOCKED;
+#define EXECUTOR_ENTER_CRITICAL() taskENTER_CRITICAL(&executorLock)
+#define EXECUTOR_EXIT_CRITICAL() taskEXIT_CRITICAL(&executorLock)
+#else
+#define EXECUTOR_ENTER_CRITICAL() taskENTER_CRITICAL()
+#define EXECUTOR_EXIT_CRITICAL() taskEXIT_CRITICAL()
+#endif
+
+Executor::Worker Executor::workers_[kWorkers] = {};
+etl::vector<Executor::Entry, EXECUTOR_MODULES_MAX> Executor::entries_;
+etl::atomic<bool> Executor::stop_(false);
+uint32_t Executor::next_ = 0;
+
+#if defined(POSIX_USED)
+/**
+ * @brief POSIX ONLY. Creates worker threads
+ */
+void Executor::init()
+{
+    stop_.store(false);
+    for (uint32_t i = 0; i < kWorkers; ++i) {
+        Worker& worker = workers_[i];
+        if (worker.started)
+            continue;
+
+        worker.executed = 0;
+        worker.stolen = 0;
+        worker.notified = false;
+        pthread_cond_init(&worker.cond, nullptr);
+        worker.started = pthread_create(&worker.thread, nullptr, task,
+                             reinterpret_cast<void*>(static_cast<uintptr_t>(i)))
+            == 0;
+    }
+}
+
+/**
+ * @brief POSIX ONLY. Stops worker threads after their current jobs and waits
+ *      for them. Queued jobs are dropped, registered modules stay
+ */
+void Executor::deinit()
+{
+    stop_.store(true);
+    wake();
+    for (uint32_t i = 0; i < kWorkers; ++i) {
+        Worker& worker = workers_[i];
+        if (!worker.started)
+            continue;
+
+        pthread_join(worker.thread, nullptr);
+        pthread_cond_destroy(&worker.cond);
+        worker.started = false;
+        while (!worker.queue.empty()) {
+            worker.queue.front()->queued = false;
+            worker.queue.pop_front();
+        }
+    }
+}
+#else
+/**
+ * @brief Creates worker tasks. On ESP32 each worker is pinned to own core
+ *
+ * @param stack worker task stack size. Must fit the largest shared dispatcher
+ * @param prior worker tasks priority
+ */
+void Executor::init(uint32_t stack, UBaseType_t prior)
+{
+    for (uint32_t i = 0; i < kWorkers; ++i) {
+        Worker& worker = workers_[i];
+        if (worker.handle != NULL)
+            continue;
+
+        worker.executed = 0;
+        worker.stolen = 0;
+#if defined(ESP_PLATFORM)
+        xTaskCreatePinnedToCore(task, "executor", stack,
+            reinterpret_cast<void*>(static_cast<uintptr_t>(i)), prior, &worker.handle, i);
+#else
+        xTaskCreate(task, "executor", stack,
+            reinterpret_cast<void*>(static_cast<uintptr_t>(i)), prior, &worker.handle);
+#endif
+    }
+}
+#endif
+
+/**
+ * @brief Registers module for dispatching by executor workers
+ *
+ * @param mod module instance
+ * @return true if module added otherwise false
+ */
+bool Executor::add(Module* mod)
+{
+    if (mod == nullptr)
+        return false;
+
+    bool res = false;
+    EXECUTOR_ENTER_CRITICAL();
+    // Reuse free slot first, because queued jobs hold pointers to entries
+    for (Entry& entry : entries_) {
+        if (entry.mod == mod) {
+            res = true;
+            break;
+        } else if (entry.mod == nullptr) {
+            entry.mod = mod;
+            entry.queued = false;
+            res = true;
+            break;
+        }
+    }
+    if (!res && !entries_.full()) {
+        entries_.push_back(Entry { mod, false });
+        res = true;
+    }
+    EXECUTOR_EXIT_CRITICAL();
+
+    wake();
+    return res;
+}
+
+/**
+ * @brief Unregisters module from executor. Module can't be removed while
+ *      its job is queued or running
+ *
+ * @param mod module instance
+ * @return true if module removed otherwise false
+ */
+bool Executor::remove(Module* mod)
+{
+    bool res = false;
+    EXECUTOR_ENTER_CRITICAL();
+    for (Entry& entry : entries_) {
+        if (entry.mod == mod && !entry.queued) {
+            entry.mod = nullptr;
+            res = true;
+            break;
+        }
+    }
+    EXECUTOR_EXIT_CRITICAL();
+    return res;
+}
+
+/**
+ * @brief Wakes all waiting workers for rescheduling of registered modules.
+ *      Called when some shared module was resumed
+ */
+void Executor::wake()
+{
+    for (uint32_t i = 0; i < kWorkers; ++i) {
+        notify(i);
+    }
+}
+
+/**
+ * @brief Wakes all waiting workers from ISR. Called when some shared module
+ *      was signaled. With POSIX it is the same as wake() from signal handler
+ *      free context
+ */
+void Executor::wakeFromIsr()
+{
+#if defined(POSIX_USED)
+    wake();
+#else
+    BaseType_t woken = pdFALSE;
+    for (uint32_t i = 0; i < kWorkers; ++i) {
+        if (workers_[i].handle != NULL)
+            vTaskNotifyGiveFromISR(workers_[i].handle, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+#endif
+}
+
+/**
+ * @brief Returns count of dispatcher calls executed by chosen worker
+ *
+ * @param worker worker index
+ * @return uint32_t executed jobs count
+ */
+uint32_t Executor::executed(uint32_t worker)
+{
+    return worker < kWorkers ? workers_[worker].executed.load() : 0;
+}
+
+/**
+ * @brief Returns count of jobs stolen by chosen worker from other workers
+ *
+ * @param worker worker index
+ * @return uint32_t stolen jobs count
+ */
+uint32_t Executor::stolen(uint32_t worker)
+{
+    return worker < kWorkers ? workers_[worker].stolen.load() : 0;
+}
+
+/**
+ * @brief Takes next job for worker. Own queue is taken from the front,
+ *      other queues are stolen from the back to reduce contention
+ *
+ * @param id worker index
+ * @return Entry* module entry or nullptr if no jobs
+ */
+Executor::Entry* Executor::take(uint32_t id)
+{
+    Entry* entry = nullptr;
+    EXECUTOR_ENTER_CRITICAL();
+    if (!workers_[id].queue.empty()) {
+        entry = workers_[id].queue.front();
+        workers_[id].queue.pop_front();
+    } else {
+        for (uint32_t i = 1; i < kWorkers; ++i) {
+            Worker& victim = workers_[(id + i) % kWorkers];
+            if (!victim.queue.empty()) {
+                entry = victim.queue.back();
+                victim.queue.pop_back();
+                workers_[id].stolen++;
+                break;
+            }
+        }
+    }
+    EXECUTOR_EXIT_CRITICAL();
+    return entry;
+}
+
+/**
+ * @brief Puts all due modules into the worker queue. Scan starts after the
+ *      last queued module, so with full queue the rest of modules are not
+ *      starved by modules registered earlier
+ *
+ * @param id worker index
+ * @return int32_t delay in ms until nearest module call, 0 if jobs were
+ *      queued or -1 if nothing to wait for
+ */
+int32_t Executor::schedule(uint32_t id)
+{
+    int32_t minDelay = -1;
+    bool queued = false;
+
+    // Time is taken before the lock, delays are counted from absolute call time
+    const Time now = Time::now();
+    EXECUTOR_ENTER_CRITICAL();
+    const uint32_t count = entries_.size();
+    const uint32_t start = next_ < count ? next_ : 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t index = (start + i) % count;
+        Entry& entry = entries_[index];
+        if (entry.mod == nullptr || entry.queued || entry.mod->isSuspended())
+            continue;
+
+        const Time& next = entry.mod->nextCallTime();
+        const int32_t delayMs = entry.mod->isSignaled() || next.isZero() || next <= now
+            ? 0 : (next - now).toMsec();
+        if (delayMs == 0) {
+            if (workers_[id].queue.full())
+                break;
+            entry.queued = true;
+            workers_[id].queue.push_back(&entry);
+            next_ = index + 1;
+            queued = true;
+        } else if (minDelay < 0 || delayMs < minDelay) {
+            minDelay = delayMs;
+        }
+    }
+    EXECUTOR_EXIT_CRITICAL();
+
+    // Let other idle workers steal from the filled queue
+    if (queued) {
+        for (uint32_t i = 0; i < kWorkers; ++i) {
+            if (i != id)
+                notify(i);
+        }
+        return 0;
+    }
+    return minDelay;
+}
+
+/**
+ * @brief Notifies worker to break its waiting
+ *
+ * @param id worker index
+ */
+void Executor::notify(uint32_t id)
+{
+#if defined(POSIX_USED)
+    Worker& worker = workers_[id];
+    EXECUTOR_ENTER_CRITICAL();
+    if (worker.started) {
+        worker.notified = true;
+        pthread_cond_signal(&worker.cond);
+    }
+    EXECUTOR_EXIT_CRITICAL();
+#else
+    if (workers_[id].handle != NULL)
+        xTaskNotifyGive(workers_[id].handle);
+#endif
+}
+
+/**
+ * @brief Waits for worker notification or timeout
+ *
+ * @param id worker index
+ * @param delayMs timeout in ms, negative value waits without timeout
+ */
+void Executor::wait(uint32_t id, int32_t delayMs)
+{
+#if defined(POSIX_USED)
+    Worker& worker = workers_[id];
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += delayMs / 1000;
+    deadline.tv_nsec += (delayMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_nsec -= 1000000000L;
+        ++deadline.tv_sec;
+    }
+
+    EXECUTOR_ENTER_CRITICAL();
+    int res = 0;
+    while (!worker.notified && res == 0) {
+        res = delayMs < 0 ? pthread_cond_wait(&worker.cond, &executorLock)
+                          : pthread_cond_timedwait(&worker.cond, &executorLock, &deadline);
+    }
+    worker.notified = false;
+    EXECUTOR_EXIT_CRITICAL();
+#else
+    (void)id;
+    ulTaskNotifyTake(pdTRUE, delayMs < 0 ? portMAX_DELAY : pdMS_TO_TICKS(delayMs));
+#endif
+}
+
+/**
+ * @brief Worker task function. Executes own or stolen jobs and schedules
+ *      due modules when nothing to do
+ */
+#if defined(POSIX_USED)
+void* Executor::task(void* arg)
+#else
+void Executor::task(void* arg)
+#endif
+{
+    const uint32_t id = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg));
+
+    while (!stop_.load()) {
+        Entry* entry = take(id);
+        if (entry) {
+            entry->mod->dispatcher();
+            workers_[id].executed++;
+
+            EXECUTOR_ENTER_CRITICAL();
+            entry->queued = false;
+            EXECUTOR_EXIT_CRITICAL();
+            continue;
+        }
+
+        // Wait for nearest module call or break waiting on notification
+        const int32_t delayMs = schedule(id);
+        if (delayMs != 0)
+            wait(id, delayMs);
+    }
+#if defined(POSIX_USED)
+    return nullptr;
+#endif
+}
+
+#endif
+
+/***************************** END OF FILE ************************************/
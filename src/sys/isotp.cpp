@@ -0,0 +1,466 @@
+/*******************************************************************************
+ * @file    isotp.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   ISO-TP (ISO 15765-2) transport over CAN bus.
+ ******************************************************************************/
+
+#include "isotp.h"
+
+#include <cstring>
+
+// Protocol control information of frames
+#define ISOTP_PCI_SINGLE 0x00
+#define ISOTP_PCI_FIRST 0x10
+#define ISOTP_PCI_CONSECUTIVE 0x20
+#define ISOTP_PCI_FLOW 0x30
+
+// Flow status of flow control frame
+#define ISOTP_FLOW_CTS 0x0
+#define ISOTP_FLOW_WAIT 0x1
+#define ISOTP_FLOW_OVERFLOW 0x2
+
+#define ISOTP_LEN_MAX 4095U
+#define ISOTP_RX_BATCH 8
+#define ISOTP_PADDING 0xCC
+
+/**
+ * @brief Construct a new IsoTp object without driver
+ */
+IsoTp::IsoTp()
+    : sessions_ {}
+{
+}
+
+#if defined(FREERTOS_USED)
+/**
+ * @brief FreeRTOS ONLY. Construct a new IsoTp object with internal task
+ *
+ * @param name human readable task name
+ * @param stack task stack size
+ * @param prior task priority
+ */
+IsoTp::IsoTp(const char* name, uint32_t stack, UBaseType_t prior)
+    : DrvModule(name, stack, prior)
+    , sessions_ {}
+{
+}
+#endif
+
+/**
+ * @brief Opens session for pair of CAN identifiers
+ *
+ * @param txId identifier of own frames
+ * @param rxId identifier of remote side frames
+ * @param blockSize count of consecutive frames between own flow controls,
+ *      zero to receive the whole payload without flow controls
+ * @param stMin minimal gap between consecutive frames requested from remote
+ *      side in ISO 15765-2 STmin format
+ * @return int32_t session index or -1 if no free session or rxId is used
+ */
+int32_t IsoTp::openSession(uint32_t txId, uint32_t rxId, uint8_t blockSize, uint8_t stMin)
+{
+    int32_t index = -1;
+    for (uint32_t i = 0; i < ISOTP_SESSIONS; ++i) {
+        if (sessions_[i].used && sessions_[i].rxId == rxId)
+            return -1;
+        if (!sessions_[i].used && index < 0)
+            index = i;
+    }
+    if (index < 0)
+        return -1;
+
+    Session& session = sessions_[index];
+    session.txId = txId;
+    session.rxId = rxId;
+    session.blockSize = blockSize;
+    session.stMin = stMin;
+    session.txState = TxState::Idle;
+    session.rxActive = false;
+    session.used = true;
+    return index;
+}
+
+/**
+ * @brief Closes session, current transfers are dropped without callbacks
+ *
+ * @param session session index
+ */
+void IsoTp::closeSession(uint32_t session)
+{
+    if (session < ISOTP_SESSIONS)
+        sessions_[session].used = false;
+}
+
+/**
+ * @brief Starts payload transmission. Payload is copied into session
+ *      buffer, so caller buffer can be reused at once. Result is delivered
+ *      by TX delegate
+ *
+ * @param session session index
+ * @param data payload
+ * @param len payload length, at most ISOTP_BUF_SIZE
+ * @return true if transmission started otherwise false
+ */
+bool IsoTp::send(uint32_t session, const void* data, uint32_t len)
+{
+    if (session >= ISOTP_SESSIONS || data == nullptr || len == 0 || len > ISOTP_BUF_SIZE
+        || len > ISOTP_LEN_MAX)
+        return false;
+
+    Session& item = sessions_[session];
+    if (!item.used || item.txState != TxState::Idle)
+        return false;
+
+    memcpy(item.txBuf, data, len);
+    item.txLen = len;
+    item.txPos = 0;
+    item.txState = TxState::Start;
+    signal(kEventTx);
+    return true;
+}
+
+/**
+ * @brief Checks that session transmits payload
+ *
+ * @param session session index
+ * @return true if transmission is in progress otherwise false
+ */
+bool IsoTp::isBusy(uint32_t session) const
+{
+    return session < ISOTP_SESSIONS && sessions_[session].txState != TxState::Idle;
+}
+
+/**
+ * @brief Sets the callback for received payload. Payload pointer is valid
+ *      only during callback
+ *
+ * @param rxCb callback delegate
+ */
+void IsoTp::setRxDelegate(const RxDelegate& rxCb)
+{
+    rxCb_ = rxCb;
+}
+
+/**
+ * @brief Sets the callback for finished transmission
+ *
+ * @param txCb callback delegate
+ */
+void IsoTp::setTxDelegate(const TxDelegate& txCb)
+{
+    txCb_ = txCb;
+}
+
+/**
+ * @brief Sets the callback for CAN frames of identifiers without sessions
+ *
+ * @param frameCb callback delegate
+ */
+void IsoTp::setFrameDelegate(const FrameDelegate& frameCb)
+{
+    frameCb_ = frameCb;
+}
+
+/**
+ * @brief Routes received frames to sessions, sends consecutive frames when
+ *      STmin passes and checks flow timeouts
+ *
+ * @return Time next call delay
+ */
+Time IsoTp::_dispatcher()
+{
+    Can* can = drv();
+
+    CanMsg msgs[ISOTP_RX_BATCH];
+    int32_t count;
+    do {
+        count = can->read(etl::span<CanMsg>(msgs));
+        for (int32_t i = 0; i < count; ++i) {
+            uint32_t index = 0;
+            while (index < ISOTP_SESSIONS && !(sessions_[index].used && sessions_[index].rxId == msgs[i].id)) {
+                ++index;
+            }
+            if (index < ISOTP_SESSIONS)
+                receive(index, msgs[i]);
+            else
+                frameCb_.call_if(msgs[i]);
+        }
+    } while (count == ISOTP_RX_BATCH);
+
+    int32_t delayMs = ISOTP_IDLE_MS;
+    for (uint32_t i = 0; i < ISOTP_SESSIONS; ++i) {
+        Session& session = sessions_[i];
+        if (!session.used)
+            continue;
+
+        transmit(i);
+
+        // Frames are late, so remote side has failed
+        if (session.rxActive && session.rxDeadline.isPast())
+            session.rxActive = false;
+
+        // Sleep until the nearest consecutive frame or timeout
+        int32_t waitMs = ISOTP_IDLE_MS;
+        if (session.txState == TxState::Start) {
+            waitMs = 1;
+        } else if (session.txState == TxState::Consecutive) {
+            // Gap is rounded up, so sub-millisecond STmin yields at least
+            // one tick instead of busy loop of module task
+            const int32_t waitUs = static_cast<int32_t>(session.txNextUs - Time::nowUs());
+            waitMs = waitUs > 0 ? (waitUs + 999) / 1000 : 1;
+        } else if (session.txState == TxState::WaitFlow) {
+            waitMs = (session.txDeadline - Time::now()).toMsec();
+        }
+        if (session.rxActive) {
+            const int32_t rxWaitMs = (session.rxDeadline - Time::now()).toMsec();
+            waitMs = rxWaitMs < waitMs ? rxWaitMs : waitMs;
+        }
+        delayMs = waitMs < delayMs ? waitMs : delayMs;
+    }
+
+    return Time(delayMs > 0 ? delayMs : 0);
+}
+
+/**
+ * @brief Handles received frame of session
+ *
+ * @param index session index
+ * @param msg received frame
+ */
+void IsoTp::receive(uint32_t index, const CanMsg& msg)
+{
+    Session& session = sessions_[index];
+    if (msg.size == 0)
+        return;
+
+    const uint8_t pci = msg.data[0] & 0xF0;
+    switch (pci) {
+    case ISOTP_PCI_SINGLE: {
+        // Single frame also terminates current reception
+        const uint8_t len = msg.data[0] & 0x0F;
+        if (len == 0 || len >= msg.size)
+            return;
+        session.rxActive = false;
+        rxCb_.call_if(index, &msg.data[1], len);
+        break;
+    }
+
+    case ISOTP_PCI_FIRST: {
+        if (msg.size < CAN_DATA_MAX_SIZE)
+            return;
+        const uint16_t len = (msg.data[0] & 0x0F) << 8 | msg.data[1];
+        if (len < CAN_DATA_MAX_SIZE)
+            return;
+        if (len > ISOTP_BUF_SIZE) {
+            session.rxActive = false;
+            sendFlow(session, ISOTP_FLOW_OVERFLOW);
+            return;
+        }
+
+        memcpy(session.rxBuf, &msg.data[2], CAN_DATA_MAX_SIZE - 2);
+        session.rxLen = len;
+        session.rxPos = CAN_DATA_MAX_SIZE - 2;
+        session.rxSn = 1;
+        session.rxBlockLeft = session.blockSize;
+        session.rxDeadline = Time::now() + ISOTP_TIMEOUT_MS;
+        session.rxActive = true;
+        sendFlow(session, ISOTP_FLOW_CTS);
+        break;
+    }
+
+    case ISOTP_PCI_CONSECUTIVE: {
+        if (!session.rxActive)
+            return;
+
+        // Lost frame breaks the whole payload
+        if ((msg.data[0] & 0x0F) != session.rxSn) {
+            session.rxActive = false;
+            return;
+        }
+
+        uint32_t chunk = session.rxLen - session.rxPos;
+        if (chunk > static_cast<uint32_t>(msg.size - 1))
+            chunk = msg.size - 1;
+        memcpy(&session.rxBuf[session.rxPos], &msg.data[1], chunk);
+        session.rxPos += chunk;
+        session.rxSn = (session.rxSn + 1) & 0x0F;
+        session.rxDeadline = Time::now() + ISOTP_TIMEOUT_MS;
+
+        if (session.rxPos >= session.rxLen) {
+            session.rxActive = false;
+            rxCb_.call_if(index, session.rxBuf, session.rxLen);
+        } else if (session.blockSize != 0 && --session.rxBlockLeft == 0) {
+            session.rxBlockLeft = session.blockSize;
+            sendFlow(session, ISOTP_FLOW_CTS);
+        }
+        break;
+    }
+
+    case ISOTP_PCI_FLOW:
+        receiveFlow(index, msg);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Applies flow control of remote side to transmission
+ *
+ * @param index session index
+ * @param msg flow control frame
+ */
+void IsoTp::receiveFlow(uint32_t index, const CanMsg& msg)
+{
+    Session& session = sessions_[index];
+    if (session.txState != TxState::WaitFlow || msg.size < 3)
+        return;
+
+    switch (msg.data[0] & 0x0F) {
+    case ISOTP_FLOW_CTS:
+        session.txBlock = msg.data[1];
+        session.txBlockLeft = session.txBlock;
+        session.txGapUs = stMinToUs(msg.data[2]);
+        session.txNextUs = Time::nowUs();
+        session.txState = TxState::Consecutive;
+        transmit(index);
+        break;
+
+    case ISOTP_FLOW_WAIT:
+        session.txDeadline = Time::now() + ISOTP_TIMEOUT_MS;
+        break;
+
+    default:
+        finishTx(index, DrvResult::Error);
+        break;
+    }
+}
+
+/**
+ * @brief Sends own flow control frame
+ *
+ * @param session session
+ * @param status flow status
+ * @return true if frame is queued otherwise false
+ */
+bool IsoTp::sendFlow(const Session& session, uint8_t status)
+{
+    const uint8_t data[3] = { static_cast<uint8_t>(ISOTP_PCI_FLOW | status), session.blockSize, session.stMin };
+    return writeFrame(session.txId, data, sizeof(data));
+}
+
+/**
+ * @brief Sends frames of session allowed by its transmission state. Frames
+ *      which don't fit into driver are sent on the next call
+ *
+ * @param index session index
+ */
+void IsoTp::transmit(uint32_t index)
+{
+    Session& session = sessions_[index];
+    switch (session.txState) {
+    case TxState::Start:
+        if (session.txLen < CAN_DATA_MAX_SIZE) {
+            uint8_t data[CAN_DATA_MAX_SIZE];
+            data[0] = ISOTP_PCI_SINGLE | session.txLen;
+            memcpy(&data[1], session.txBuf, session.txLen);
+            if (writeFrame(session.txId, data, session.txLen + 1))
+                finishTx(index, DrvResult::Finished);
+        } else {
+            uint8_t data[CAN_DATA_MAX_SIZE];
+            data[0] = ISOTP_PCI_FIRST | session.txLen >> 8;
+            data[1] = session.txLen & 0xFF;
+            memcpy(&data[2], session.txBuf, CAN_DATA_MAX_SIZE - 2);
+            if (writeFrame(session.txId, data, CAN_DATA_MAX_SIZE)) {
+                session.txPos = CAN_DATA_MAX_SIZE - 2;
+                session.txSn = 1;
+                session.txDeadline = Time::now() + ISOTP_TIMEOUT_MS;
+                session.txState = TxState::WaitFlow;
+            }
+        }
+        break;
+
+    case TxState::WaitFlow:
+        if (session.txDeadline.isPast())
+            finishTx(index, DrvResult::Error);
+        break;
+
+    case TxState::Consecutive:
+        while (static_cast<int32_t>(Time::nowUs() - session.txNextUs) >= 0) {
+            uint8_t data[CAN_DATA_MAX_SIZE];
+            uint32_t chunk = session.txLen - session.txPos;
+            if (chunk > CAN_DATA_MAX_SIZE - 1)
+                chunk = CAN_DATA_MAX_SIZE - 1;
+            data[0] = ISOTP_PCI_CONSECUTIVE | session.txSn;
+            memcpy(&data[1], &session.txBuf[session.txPos], chunk);
+            if (!writeFrame(session.txId, data, chunk + 1))
+                break;
+
+            session.txPos += chunk;
+            session.txSn = (session.txSn + 1) & 0x0F;
+            session.txNextUs = Time::nowUs() + session.txGapUs;
+            if (session.txPos >= session.txLen) {
+                finishTx(index, DrvResult::Finished);
+                break;
+            }
+            if (session.txBlock != 0 && --session.txBlockLeft == 0) {
+                session.txDeadline = Time::now() + ISOTP_TIMEOUT_MS;
+                session.txState = TxState::WaitFlow;
+                break;
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Finishes transmission and calls TX delegate
+ *
+ * @param index session index
+ * @param result transmission result
+ */
+void IsoTp::finishTx(uint32_t index, DrvResult result)
+{
+    sessions_[index].txState = TxState::Idle;
+    txCb_.call_if(index, result);
+}
+
+/**
+ * @brief Writes frame padded to full CAN frame
+ *
+ * @param id CAN identifier
+ * @param data frame data
+ * @param size frame data size
+ * @return true if frame is queued otherwise false
+ */
+bool IsoTp::writeFrame(uint32_t id, const uint8_t* data, uint8_t size)
+{
+    CanMsg msg;
+    msg.id = id;
+    msg.size = CAN_DATA_MAX_SIZE;
+    memcpy(msg.data, data, size);
+    memset(&msg.data[size], ISOTP_PADDING, CAN_DATA_MAX_SIZE - size);
+    return drv()->write(msg) > 0;
+}
+
+/**
+ * @brief Converts STmin of ISO 15765-2 format to microseconds. Reserved
+ *      values are treated as the maximal gap
+ *
+ * @param stMin STmin value
+ * @return uint32_t gap in microseconds
+ */
+uint32_t IsoTp::stMinToUs(uint8_t stMin)
+{
+    if (stMin <= 0x7F)
+        return stMin * 1000U;
+    if (stMin >= 0xF1 && stMin <= 0xF9)
+        return (stMin - 0xF0) * 100U;
+    return 0x7F * 1000U;
+}
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,375 @@
+/*******************************************************************************
+ * @file    loadmeter.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   CPU load meter by busy time of module dispatchers or run time
+ *          counters of FreeRTOS tasks.
+ ******************************************************************************/
+
+#include "loadmeter.h"
+#include "debug.h"
+
+#if defined(FREERTOS_USED) && defined(ESP_PLATFORM)
+/// Spinlock for counters access from different cores
+static portMUX_TYPE loadMeterLock = portMUX_INITIALIZER_UNLOCKED;
+#define LOADMETER_ENTER_CRITICAL() taskENTER_CRITICAL(&loadMeterLock)
+#define LOADMETER_EXIT_CRITICAL() taskEXIT_CRITICAL(&loadMeterLock)
+#elif defined(FREERTOS_USED)
+#define LOADMETER_ENTER_CRITICAL() taskENTER_CRITICAL()
+#define LOADMETER_EXIT_CRITICAL() taskEXIT_CRITICAL()
+#else
+#define LOADMETER_ENTER_CRITICAL()
+#define LOADMETER_EXIT_CRITICAL()
+#endif
+
+#if defined(FREERTOS_USED) && defined(LOADMETER_USED) \
+    && (configGENERATE_RUN_TIME_STATS != 1 || configUSE_TRACE_FACILITY != 1)
+#error "LoadMeter needs configGENERATE_RUN_TIME_STATS and configUSE_TRACE_FACILITY"
+#endif
+
+etl::vector<LoadMeter::Entry, LOADMETER_MODULES_MAX> LoadMeter::entries_;
+uint16_t LoadMeter::samples_[kSamples] = {};
+uint32_t LoadMeter::index_ = 0;
+uint32_t LoadMeter::count_ = 0;
+uint32_t LoadMeter::startUs_ = 0;
+uint32_t LoadMeter::busyUs_ = 0;
+bool LoadMeter::started_ = false;
+#if defined(FREERTOS_USED)
+uint32_t LoadMeter::totalRunTime_ = 0;
+uint32_t LoadMeter::idleRunTime_ = 0;
+#endif
+
+#if defined(FREERTOS_USED)
+/**
+ * @brief FreeRTOS ONLY. Registers module with own task, its share is taken
+ *      from run time counter of the task. Called from module task on start
+ *
+ * @param mod module instance
+ */
+void LoadMeter::add(const Module* mod)
+{
+    if (mod->xHandle_ == NULL)
+        return;
+
+    // Task API is not allowed in critical section
+    const uint32_t runTime = taskRunTime(mod->xHandle_);
+
+    LOADMETER_ENTER_CRITICAL();
+    bool found = false;
+    for (const Entry& entry : entries_) {
+        found = found || entry.mod == mod;
+    }
+    if (!found && !entries_.full())
+        entries_.push_back(Entry { mod, 0, 0, runTime });
+    LOADMETER_EXIT_CRITICAL();
+}
+#else
+
+/**
+ * @brief Accounts busy time of module dispatcher. Module is registered on the
+ *      first call, when registry is full only total load is accounted
+ *
+ * @param mod module instance
+ * @param us dispatcher execution time in microseconds
+ */
+void LoadMeter::busy(const Module* mod, uint32_t us)
+{
+    update();
+
+    LOADMETER_ENTER_CRITICAL();
+    busyUs_ += us;
+
+    Entry* found = nullptr;
+    for (Entry& entry : entries_) {
+        if (entry.mod == mod) {
+            found = &entry;
+            break;
+        }
+    }
+    if (found == nullptr && !entries_.full()) {
+        entries_.push_back(Entry { mod, 0, 0 });
+        found = &entries_.back();
+    }
+    if (found != nullptr)
+        found->busyUs += us;
+    LOADMETER_EXIT_CRITICAL();
+}
+#endif
+
+/**
+ * @brief Removes module from load meter. Must be called before deletion of
+ *      measured module
+ *
+ * @param mod module instance
+ * @return true if module removed otherwise false
+ */
+bool LoadMeter::remove(const Module* mod)
+{
+    bool result = false;
+    LOADMETER_ENTER_CRITICAL();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->mod == mod) {
+            entries_.erase(it);
+            result = true;
+            break;
+        }
+    }
+    LOADMETER_EXIT_CRITICAL();
+    return result;
+}
+
+/**
+ * @brief Closes elapsed one second windows. Called on each busy time account
+ *      and each load request, so idle periods without dispatcher calls are
+ *      closed with zero load lazily
+ */
+void LoadMeter::update()
+{
+    const uint32_t now = Time::nowUs();
+
+#if defined(FREERTOS_USED)
+    LOADMETER_ENTER_CRITICAL();
+    const bool elapsed = !started_ || now - startUs_ >= kWindowUs;
+    LOADMETER_EXIT_CRITICAL();
+    if (elapsed)
+        sample(now);
+#else
+    LOADMETER_ENTER_CRITICAL();
+    // First window starts on the first measurement
+    if (!started_) {
+        startUs_ = now;
+        started_ = true;
+    }
+
+    uint32_t elapsed = now - startUs_;
+    if (elapsed >= kWindowUs) {
+        // Busy time is normalized by cores count, so full load of all cores
+        // is kPermille
+        const uint32_t capacity = kCores * kWindowUs / kPermille;
+        push(busyUs_ / capacity);
+        for (Entry& entry : entries_) {
+            entry.share = entry.busyUs / capacity;
+            entry.busyUs = 0;
+        }
+        busyUs_ = 0;
+        startUs_ += kWindowUs;
+        elapsed -= kWindowUs;
+
+        // Windows without any dispatcher calls are idle
+        if (elapsed >= kWindowUs) {
+            for (Entry& entry : entries_) {
+                entry.share = 0;
+            }
+        }
+        for (uint32_t i = 0; elapsed >= kWindowUs && i < kSamples; ++i) {
+            push(0);
+            startUs_ += kWindowUs;
+            elapsed -= kWindowUs;
+        }
+
+        // Long idle period fills all samples, next window starts from now
+        if (elapsed >= kWindowUs)
+            startUs_ = now;
+    }
+    LOADMETER_EXIT_CRITICAL();
+#endif
+}
+
+/**
+ * @brief Returns CPU load over chosen window. Only closed one second windows
+ *      are averaged, so the current second is not included
+ *
+ * @param window averaging window
+ * @return uint32_t load in permille
+ */
+uint32_t LoadMeter::load(Window window)
+{
+    update();
+
+    uint32_t size = 1;
+    if (window == kWindow10s)
+        size = 10;
+    else if (window == kWindow60s)
+        size = kSamples;
+
+    LOADMETER_ENTER_CRITICAL();
+    if (size > count_)
+        size = count_;
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        sum += samples_[(index_ + kSamples - 1 - i) % kSamples];
+    }
+    LOADMETER_EXIT_CRITICAL();
+    return size != 0 ? sum / size : 0;
+}
+
+/**
+ * @brief Returns module share of CPU over the last closed second
+ *
+ * @param mod module instance
+ * @return uint32_t share in permille
+ */
+uint32_t LoadMeter::share(const Module* mod)
+{
+    update();
+
+    uint32_t result = 0;
+    LOADMETER_ENTER_CRITICAL();
+    for (const Entry& entry : entries_) {
+        if (entry.mod == mod) {
+            result = entry.share;
+            break;
+        }
+    }
+    LOADMETER_EXIT_CRITICAL();
+    return result;
+}
+
+/**
+ * @brief Sends load over 1 s, 10 s and 60 s windows and shares of modules
+ *      in order of registration through debug channel. Each value is
+ *      permille in big-endian short
+ *
+ * @param cmd debug command
+ */
+void LoadMeter::out(uint8_t cmd)
+{
+    uint32_t values[3 + LOADMETER_MODULES_MAX] = {
+        load(kWindow1s),
+        load(kWindow10s),
+        load(kWindow60s),
+    };
+
+    uint32_t count = 3;
+    LOADMETER_ENTER_CRITICAL();
+    for (const Entry& entry : entries_) {
+        values[count++] = entry.share;
+    }
+    LOADMETER_EXIT_CRITICAL();
+
+    uint8_t buf[sizeof(values) / sizeof(values[0]) * sizeof(uint16_t)];
+    for (uint32_t i = 0; i < count; ++i) {
+        buf[i * 2] = (values[i] >> 8) & 0xFF;
+        buf[i * 2 + 1] = values[i] & 0xFF;
+    }
+    Debug::out(cmd, buf, count * sizeof(uint16_t));
+}
+
+/**
+ * @brief Stores load of closed one second window
+ *
+ * @param load load in permille
+ */
+void LoadMeter::push(uint32_t load)
+{
+    samples_[index_] = load > kPermille ? kPermille : load;
+    index_ = (index_ + 1) % kSamples;
+    if (count_ < kSamples)
+        ++count_;
+}
+
+#if defined(FREERTOS_USED)
+/**
+ * @brief FreeRTOS ONLY. Closes elapsed one second windows by run time
+ *      counters. Load is the part of time not spent by idle tasks, share is
+ *      the part of time spent by module task. Windows elapsed without
+ *      requests get average of the whole period, so load must be requested
+ *      at least once per run time counter overflow
+ *
+ * @param now current time in microseconds
+ */
+void LoadMeter::sample(uint32_t now)
+{
+    // Counters are read out of critical section, task API is not allowed
+    // inside, so entries are copied first
+    TaskHandle_t handles[LOADMETER_MODULES_MAX];
+    const Module* mods[LOADMETER_MODULES_MAX];
+    uint32_t runTimes[LOADMETER_MODULES_MAX];
+    uint32_t count = 0;
+    LOADMETER_ENTER_CRITICAL();
+    for (const Entry& entry : entries_) {
+        mods[count] = entry.mod;
+        handles[count++] = entry.mod->xHandle_;
+    }
+    LOADMETER_EXIT_CRITICAL();
+
+    const uint32_t total = portGET_RUN_TIME_COUNTER_VALUE();
+    const uint32_t idle = idleRunTime();
+    for (uint32_t i = 0; i < count; ++i) {
+        runTimes[i] = taskRunTime(handles[i]);
+    }
+
+    LOADMETER_ENTER_CRITICAL();
+    if (!started_) {
+        startUs_ = now;
+        started_ = true;
+    } else if (now - startUs_ >= kWindowUs) {
+        // Counters of all cores run in time of total counter
+        const uint32_t windows = (now - startUs_) / kWindowUs;
+        const uint64_t capacity = static_cast<uint64_t>(total - totalRunTime_) * kCores;
+        uint64_t idleTime = idle - idleRunTime_;
+        if (idleTime > capacity)
+            idleTime = capacity;
+        const uint32_t busy = capacity != 0 ? kPermille - idleTime * kPermille / capacity : 0;
+        for (uint32_t i = 0; i < windows && i < kSamples; ++i) {
+            push(busy);
+        }
+        startUs_ += windows * kWindowUs;
+
+        for (Entry& entry : entries_) {
+            for (uint32_t i = 0; i < count; ++i) {
+                if (mods[i] == entry.mod) {
+                    const uint64_t busyTime = runTimes[i] - entry.runTime;
+                    entry.share = capacity != 0 ? busyTime * kPermille / capacity : 0;
+                    entry.runTime = runTimes[i];
+                    break;
+                }
+            }
+        }
+    }
+    totalRunTime_ = total;
+    idleRunTime_ = idle;
+    LOADMETER_EXIT_CRITICAL();
+}
+
+/**
+ * @brief FreeRTOS ONLY. Returns run time counter of idle tasks of all cores,
+ *      needs INCLUDE_xTaskGetIdleTaskHandle on single core FreeRTOS
+ *
+ * @return uint32_t run time counter, zero without LOADMETER_USED
+ */
+uint32_t LoadMeter::idleRunTime()
+{
+#if defined(LOADMETER_USED) && defined(ESP_PLATFORM)
+    uint32_t result = 0;
+    for (uint32_t core = 0; core < kCores; ++core) {
+        result += taskRunTime(xTaskGetIdleTaskHandleForCPU(core));
+    }
+    return result;
+#elif defined(LOADMETER_USED)
+    return taskRunTime(xTaskGetIdleTaskHandle());
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief FreeRTOS ONLY. Returns run time counter of task
+ *
+ * @param handle task handle
+ * @return uint32_t run time counter, zero without LOADMETER_USED
+ */
+uint32_t LoadMeter::taskRunTime(TaskHandle_t handle)
+{
+#if defined(LOADMETER_USED)
+    TaskStatus_t status;
+    vTaskGetInfo(handle, &status, pdFALSE, eInvalid);
+    return status.ulRunTimeCounter;
+#else
+    (void)handle;
+    return 0;
+#endif
+}
+#endif
+
+/***************************** END OF FILE ************************************/
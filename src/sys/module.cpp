@@ -5,6 +5,9 @@
  ******************************************************************************/
 
 #include "module.h"
+#include "executor.h"
+#include "loadmeter.h"
+#include "scheduler.h"
 
 #if defined(FREERTOS_USED)
 /// Default priority for module tasks
@@ -19,8 +22,11 @@ const int Module::kInited = 0x55AA0000;
  * @brief Construct a new Module object
  */
 Module::Module()
+    : pending_(0)
+    , events_(0)
+    , readyBit_(0)
 #if defined(FREERTOS_USED)
-    : xHandle_(NULL)
+    , xHandle_(NULL)
 #endif
 {
     if (!isInited()) {
@@ -40,7 +46,10 @@ Module::Module()
  * @param prior task priority
  */
 Module::Module(const char* name, uint32_t stack, UBaseType_t prior)
-    : xHandle_(NULL)
+    : pending_(0)
+    , events_(0)
+    , readyBit_(0)
+    , xHandle_(NULL)
 {
     if (!isInited()) {
         flags_ = kInited | kAvailability;
@@ -79,6 +88,26 @@ void Module::taskInit(const char* name, uint32_t stack, UBaseType_t prior, uint3
         xTaskCreatePinnedToCore(task, name, stack, this, prior, &xHandle_, coreId);
 }
 #endif
+
+#endif
+
+#if defined(FREERTOS_USED) || defined(POSIX_USED)
+/**
+ * @brief FreeRTOS or POSIX ONLY. Registers module in the work-sharing
+ *      executor instead of own task creation. Dispatcher will be called on
+ *      any free worker, so it must be short and run to completion without
+ *      blocking waits
+ *
+ * @return true if module registered otherwise false
+ */
+bool Module::shareInit()
+{
+#if defined(FREERTOS_USED)
+    if (xHandle_ != NULL)
+        return false;
+#endif
+    return Executor::add(this);
+}
 #endif
 
 /**
@@ -161,10 +190,20 @@ void Module::dispatcher()
         return;
     }
 
-    // Dispatcher called only if was zero delay or time has come
+    // Dispatcher called only if was zero delay, time has come or some
+    // events were signaled. Events are available inside by events() call
     Time now = Time::now();
-    if (nextCallTime_.isZero() || now >= nextCallTime_) {
+    const uint32_t events = pending_.exchange(0);
+    if (events != 0 || nextCallTime_.isZero() || now >= nextCallTime_) {
+        events_ = events;
+#if defined(LOADMETER_USED) && !defined(FREERTOS_USED)
+        const uint32_t start = Time::nowUs();
+        nextCallTime_ = now + _dispatcher();
+        LoadMeter::busy(this, Time::nowUs() - start);
+#else
         nextCallTime_ = now + _dispatcher();
+#endif
+        events_ = 0;
     }
 }
 
@@ -222,13 +261,95 @@ void Module::resume()
             xTaskNotifyGive(xHandle_);
     } else {
         flags_ &= ~kSuspended;
+        // Shared module needs rescheduling by executor workers
+        Executor::wake();
     }
 #else
     // Reset suspend flag for no RTOS work
     flags_ &= ~kSuspended;
+#if defined(POSIX_USED)
+    Executor::wake();
+#endif
 #endif
 }
 
+/**
+ * @brief Signals events to the module from task or main loop context.
+ *      Next dispatcher call is executed as soon as possible regardless
+ *      of nextCallTime and delayTime
+ *
+ * @param events event flags, available in dispatcher by events() call
+ */
+void Module::signal(uint32_t events)
+{
+    pending_.fetch_or(events);
+#if defined(FREERTOS_USED)
+    if (xHandle_) {
+        xTaskNotifyGive(xHandle_);
+        return;
+    }
+    Executor::wake();
+#elif defined(POSIX_USED)
+    Executor::wake();
+#endif
+    if (readyBit_)
+        Scheduler::setReady(readyBit_);
+}
+
+/**
+ * @brief Signals events to the module from ISR. With FreeRTOS module task
+ *      is notified, without RTOS module is marked in scheduler ready bitmap
+ *
+ * @param events event flags, available in dispatcher by events() call
+ */
+void Module::signalFromIsr(uint32_t events)
+{
+    pending_.fetch_or(events);
+#if defined(FREERTOS_USED)
+    if (xHandle_) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(xHandle_, 0, eIncrement, &woken);
+        portYIELD_FROM_ISR(woken);
+        return;
+    }
+    Executor::wakeFromIsr();
+#elif defined(POSIX_USED)
+    Executor::wakeFromIsr();
+#endif
+    if (readyBit_)
+        Scheduler::setReady(readyBit_);
+}
+
+/**
+ * @brief Signals wake event to the module from ISR. Has no arguments for
+ *      binding to driver delegates
+ */
+void Module::wakeFromIsr()
+{
+    signalFromIsr(kEventWake);
+}
+
+/**
+ * @brief Checks signaled events which were not processed by dispatcher yet
+ *
+ * @return true if some events pending otherwise false
+ */
+bool Module::isSignaled() const
+{
+    return pending_.load() != 0;
+}
+
+/**
+ * @brief Returns events signaled before current dispatcher call. Valid only
+ *      inside of the virtual _dispatcher function
+ *
+ * @return uint32_t event flags
+ */
+uint32_t Module::events() const
+{
+    return events_;
+}
+
 /**
  * @brief Set the availability property of the module
  *
@@ -252,6 +373,9 @@ void Module::task(void *instance)
     if (!instance)
         vTaskDelete(NULL);
 
+#if defined(LOADMETER_USED)
+    LoadMeter::add(static_cast<Module*>(instance));
+#endif
     while (1) {
         Module* mod = static_cast<Module*>(instance);
         mod->dispatcher();
@@ -268,7 +392,13 @@ void Module::task(void *instance)
 void Module::task()
 {
     while (1) {
+#if defined(LOADMETER_USED)
+        const uint32_t start = Time::nowUs();
         _dispatcher();
+        LoadMeter::busy(this, Time::nowUs() - start);
+#else
+        _dispatcher();
+#endif
     }
 }
 #endif
@@ -0,0 +1,301 @@
+/*******************************************************************************
+ * @file    scheduler.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Priority scheduler of module dispatchers for super loop.
+ ******************************************************************************/
+
+#include "scheduler.h"
+
+#if defined(FREERTOS_USED) && defined(ESP_PLATFORM)
+/// Spinlock for ready bits access from different cores
+static portMUX_TYPE schedulerLock = portMUX_INITIALIZER_UNLOCKED;
+#define SCHEDULER_ENTER_CRITICAL() taskENTER_CRITICAL(&schedulerLock)
+#define SCHEDULER_EXIT_CRITICAL() taskEXIT_CRITICAL(&schedulerLock)
+#elif defined(FREERTOS_USED)
+#define SCHEDULER_ENTER_CRITICAL() taskENTER_CRITICAL()
+#define SCHEDULER_EXIT_CRITICAL() taskEXIT_CRITICAL()
+#elif defined(GD32_PLATFORM)
+#include "gd32/gd32.h"
+#define SCHEDULER_ENTER_CRITICAL()            \
+    const uint32_t primask = __get_PRIMASK(); \
+    __disable_irq()
+#define SCHEDULER_EXIT_CRITICAL() __set_PRIMASK(primask)
+#else
+#define SCHEDULER_ENTER_CRITICAL()
+#define SCHEDULER_EXIT_CRITICAL()
+#endif
+
+etl::vector<Scheduler::Entry, SCHEDULER_MODULES_MAX> Scheduler::entries_;
+etl::atomic<uint32_t> Scheduler::ready_(0);
+uint32_t Scheduler::order_ = 0;
+Scheduler::OverrunDelegate Scheduler::overrunCb_;
+
+/**
+ * @brief Registers module in scheduler
+ *
+ * @param mod module instance
+ * @param prior module priority. Higher value means higher priority
+ * @param budgetUs execution budget of one dispatch in microseconds,
+ *      zero disables budget check
+ * @return true if module added otherwise false
+ */
+bool Scheduler::add(Module* mod, uint8_t prior, uint32_t budgetUs)
+{
+    if (mod == nullptr || entries_.full())
+        return false;
+
+    for (const Entry& entry : entries_) {
+        if (entry.mod == mod)
+            return false;
+    }
+
+    entries_.push_back(Entry { mod, prior, budgetUs, 0, 0, false, {} });
+    updateReadyBits();
+    return true;
+}
+
+/**
+ * @brief Unregisters module from scheduler
+ *
+ * @param mod module instance
+ * @return true if module removed otherwise false
+ */
+bool Scheduler::remove(Module* mod)
+{
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->mod == mod) {
+            mod->readyBit_ = 0;
+            entries_.erase(it);
+            updateReadyBits();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Sets the callback for dispatch budget overrun
+ *
+ * @param overrunCb callback delegate
+ */
+void Scheduler::setOverrunDelegate(const OverrunDelegate& overrunCb)
+{
+    overrunCb_ = overrunCb;
+}
+
+/**
+ * @brief Runs single due module with the highest priority. Among due modules
+ *      with equal priority the one that was served earliest is chosen
+ *
+ * @return true if some module was dispatched otherwise false
+ */
+bool Scheduler::dispatcher()
+{
+    const uint32_t nowUs = Time::nowUs();
+    const Time now = Time::now();
+    const uint32_t ready = ready_.load();
+
+    // Choose module by priority and then by last served order
+    Entry* next = nullptr;
+    for (Entry& entry : entries_) {
+        if (!isDue(entry, now, ready))
+            continue;
+
+        // Release of module with call time is its call time, signaled one
+        // is released by the first pass that sees it
+        if (!entry.released) {
+            entry.released = true;
+            entry.releaseUs = nowUs;
+            const Time& callTime = entry.mod->nextCallTime();
+            if ((ready & entry.mod->readyBit_) == 0 && !entry.mod->isSignaled() && !callTime.isZero())
+                entry.releaseUs -= static_cast<uint32_t>((now - callTime).toMsec()) * 1000;
+        }
+
+        if (next == nullptr || entry.prior > next->prior
+            || (entry.prior == next->prior && entry.order < next->order)) {
+            next = &entry;
+        }
+    }
+
+    if (next == nullptr)
+        return false;
+
+    // Ready bit is cleared before dispatch to not lose signal from ISR during it
+    ready_.fetch_and(~next->mod->readyBit_);
+    const uint32_t start = Time::nowUs();
+    next->mod->dispatcher();
+    const uint32_t end = Time::nowUs();
+    const uint32_t elapsed = end - start;
+    const uint32_t response = end - next->releaseUs;
+
+    next->order = ++order_;
+    next->released = false;
+    next->stats.calls++;
+    next->stats.lastUs = elapsed;
+    if (elapsed > next->stats.worstUs)
+        next->stats.worstUs = elapsed;
+    next->stats.lastResponseUs = response;
+    if (response > next->stats.worstResponseUs)
+        next->stats.worstResponseUs = response;
+
+    // Check dispatch budget
+    if (next->budgetUs != 0 && elapsed > next->budgetUs) {
+        next->stats.overruns++;
+        overrunCb_.call_if(next->mod, elapsed);
+    }
+    return true;
+}
+
+/**
+ * @brief Infinite super loop with scheduler dispatcher
+ */
+void Scheduler::run()
+{
+    while (1) {
+        dispatcher();
+    }
+}
+
+/**
+ * @brief Super loop with scheduler dispatcher for chosen time, e.g. for
+ *      replay of modules timing profile
+ *
+ * @param ms loop duration in milliseconds
+ */
+void Scheduler::runFor(uint32_t ms)
+{
+    const uint32_t start = Time::nowUs();
+    const uint32_t durationUs = ms * 1000;
+    while (Time::nowUs() - start < durationUs) {
+        dispatcher();
+    }
+}
+
+/**
+ * @brief Returns the Time object to wait for the nearest module call.
+ *      Can be used for sleep in super loop when nothing to do
+ *
+ * @return Time delay time or zero if some module is due already
+ */
+Time Scheduler::delayTime()
+{
+    if (ready_.load() != 0)
+        return 0;
+
+    Time minDelay = 0;
+    bool found = false;
+    for (const Entry& entry : entries_) {
+        if (entry.mod->isSuspended())
+            continue;
+
+        const Time delay = entry.mod->delayTime();
+        if (!found || delay < minDelay) {
+            minDelay = delay;
+            found = true;
+        }
+    }
+    return minDelay;
+}
+
+/**
+ * @brief Returns dispatch statistics of the module
+ *
+ * @param mod module instance
+ * @param stats statistics structure to fill
+ * @return true if module registered and stats filled otherwise false
+ */
+bool Scheduler::stats(const Module* mod, Stats& stats)
+{
+    for (const Entry& entry : entries_) {
+        if (entry.mod == mod) {
+            stats = entry.stats;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Marks modules as ready in bitmap. Lock-free and ISR safe
+ *
+ * @param bits modules ready bits
+ */
+void Scheduler::setReady(uint32_t bits)
+{
+    ready_.fetch_or(bits);
+}
+
+/**
+ * @brief Assigns ready bits of modules according to entries positions and
+ *      rebuilds bitmap from signaled modules, so signals from ISR are kept.
+ *      ISR reads ready bit of module, so it runs with interrupts masked
+ */
+void Scheduler::updateReadyBits()
+{
+    SCHEDULER_ENTER_CRITICAL();
+    uint32_t ready = 0;
+    for (uint32_t i = 0; i < entries_.size(); ++i) {
+        Module* mod = entries_[i].mod;
+        mod->readyBit_ = 1U << i;
+        if (mod->isSignaled())
+            ready |= mod->readyBit_;
+    }
+    ready_.store(ready);
+    SCHEDULER_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Checks that module needs to be dispatched
+ *
+ * @param entry module entry
+ * @param now current time
+ * @param ready ready bitmap
+ * @return true if module is due otherwise false
+ */
+bool Scheduler::isDue(const Entry& entry, const Time& now, uint32_t ready)
+{
+    if (entry.mod->isSuspended())
+        return false;
+
+    // Signaled from ISR modules are due immediately
+    if ((ready & entry.mod->readyBit_) != 0)
+        return true;
+
+    const Time& next = entry.mod->nextCallTime();
+    return entry.mod->isSignaled() || next.isZero() || now >= next;
+}
+
+/**
+ * @brief Construct a new ProfileModule object
+ *
+ * @param execUs execution times of calls in microseconds, replayed in cycle
+ * @param count execution times count
+ * @param periodMs delay between calls in milliseconds
+ */
+ProfileModule::ProfileModule(const uint32_t* execUs, uint32_t count, uint32_t periodMs)
+    : execUs_(execUs)
+    , count_(count)
+    , index_(0)
+    , periodMs_(periodMs)
+{
+}
+
+/**
+ * @brief Busy waits for the next execution time of profile
+ *
+ * @return Time period of calls
+ */
+Time ProfileModule::_dispatcher()
+{
+    if (count_ != 0) {
+        const uint32_t execUs = execUs_[index_];
+        index_ = index_ + 1 < count_ ? index_ + 1 : 0;
+
+        const uint32_t start = Time::nowUs();
+        while (Time::nowUs() - start < execUs) {
+        }
+    }
+    return Time(static_cast<int32_t>(periodMs_));
+}
+
+/***************************** END OF FILE ************************************/
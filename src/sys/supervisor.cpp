@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * @file    supervisor.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Software watchdog of modules liveness.
+ ******************************************************************************/
+
+#include "supervisor.h"
+#include "system.h"
+
+#if defined(FREERTOS_USED) && defined(ESP_PLATFORM)
+/// Spinlock for entries access from different cores
+static portMUX_TYPE supervisorLock = portMUX_INITIALIZER_UNLOCKED;
+#define SUPERVISOR_ENTER_CRITICAL() taskENTER_CRITICAL(&supervisorLock)
+#define SUPERVISOR_EXIT_CRITICAL() taskEXIT_CRITICAL(&supervisorLock)
+#elif defined(FREERTOS_USED)
+#define SUPERVISOR_ENTER_CRITICAL() taskENTER_CRITICAL()
+#define SUPERVISOR_EXIT_CRITICAL() taskEXIT_CRITICAL()
+#else
+#define SUPERVISOR_ENTER_CRITICAL()
+#define SUPERVISOR_EXIT_CRITICAL()
+#endif
+
+etl::vector<Supervisor::Entry, SUPERVISOR_MODULES_MAX> Supervisor::entries_;
+etl::atomic<bool> Supervisor::updating_(false);
+Supervisor::FeedDelegate Supervisor::feedCb_;
+
+/**
+ * @brief Adds module under supervision
+ *
+ * @param mod module instance
+ * @param name human readable module name for reset report
+ * @param timeout maximum time of dispatcher work after module became due.
+ *      Also covers time when module waits for processing in a busy loop
+ * @return true if module added otherwise false
+ */
+bool Supervisor::add(Module* mod, const char* name, const Time& timeout)
+{
+    if (mod == nullptr)
+        return false;
+
+    const Time now = Time::now();
+    SUPERVISOR_ENTER_CRITICAL();
+    updating_.store(true);
+    bool res = !entries_.full();
+    for (const Entry& entry : entries_) {
+        if (entry.mod == mod)
+            res = false;
+    }
+    if (res)
+        entries_.push_back(Entry { mod, name, timeout, mod->nextCallTime(), now });
+    updating_.store(false);
+    SUPERVISOR_EXIT_CRITICAL();
+    return res;
+}
+
+/**
+ * @brief Removes module from supervision
+ *
+ * @param mod module instance
+ * @return true if module removed otherwise false
+ */
+bool Supervisor::remove(Module* mod)
+{
+    bool res = false;
+    SUPERVISOR_ENTER_CRITICAL();
+    updating_.store(true);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->mod == mod) {
+            entries_.erase(it);
+            res = true;
+            break;
+        }
+    }
+    updating_.store(false);
+    SUPERVISOR_EXIT_CRITICAL();
+    return res;
+}
+
+/**
+ * @brief Sets the callback for hardware watchdog feeding
+ *
+ * @param feedCb callback delegate
+ */
+void Supervisor::setFeedDelegate(const FeedDelegate& feedCb)
+{
+    feedCb_ = feedCb;
+}
+
+/**
+ * @brief Checks heartbeats of all supervised modules. Restarts CPU with
+ *      failed module record when some module hangs. Without RTOS it is
+ *      called from IRQ, which can interrupt add() or remove(), then the pass
+ *      is skipped
+ *
+ * @return true if all modules alive or pass is skipped
+ */
+bool Supervisor::check()
+{
+    if (updating_.load())
+        return true;
+
+    const Time now = Time::now();
+    const char* name = nullptr;
+    bool failed = false;
+
+    SUPERVISOR_ENTER_CRITICAL();
+    for (Entry& entry : entries_) {
+        // Next call time changes only when dispatcher completes, so it is
+        // the heartbeat of module. Module is due since that time
+        const Time& next = entry.mod->nextCallTime();
+        if (next != entry.lastCall) {
+            entry.lastCall = next;
+            entry.dueSince = next.isZero() ? now : next;
+            continue;
+        }
+
+        // Suspended module is not expected to work
+        if (entry.mod->isSuspended()) {
+            entry.dueSince = now;
+            continue;
+        }
+
+        if (now > entry.dueSince + entry.timeout) {
+            name = entry.name;
+            failed = true;
+            break;
+        }
+    }
+    SUPERVISOR_EXIT_CRITICAL();
+
+    if (failed) {
+        System::getInstance().restartByFailure(name);
+        return false;
+    }
+
+    feedCb_.call_if();
+    return true;
+}
+
+/***************************** END OF FILE ************************************/
@@ -96,6 +96,36 @@ System::ResetReason System::resetReason() const
     return resetReason_;
 }
 
+/**
+ * @brief Returns name of the module which hang caused last reset by
+ *      supervisor
+ *
+ * @return const char* module name or nullptr if last reset wasn't caused
+ *      by supervisor
+ */
+const char* System::failedModule() const
+{
+    return resetReason_ == kResetSupervisor ? failedModule_ : nullptr;
+}
+
+/**
+ * @brief Records failed module name in retain memory and restarts CPU.
+ *      After restart reset reason will be kResetSupervisor
+ *
+ * @param name failed module name
+ */
+void System::restartByFailure(const char* name)
+{
+    uint32_t i = 0;
+    if (name != nullptr) {
+        for (; i < kFailedNameSize - 1 && name[i] != '\0'; ++i)
+            systemData.failedName[i] = name[i];
+    }
+    systemData.failedName[i] = '\0';
+    systemData.failedMark = 0x55AA;
+    restart();
+}
+
 /**
  * @brief Returns reason of last wakeup
  *
@@ -154,6 +184,7 @@ int32_t System::wakeupPin() const
 System::System(Version* ver)
     : version(ver)
     , versionStr { 0 }
+    , failedModule_ { 0 }
     , resetReason_(kResetUnknown)
     , wakeupReason_(kWakeupUnknown)
     , wakeupTime_(0)
@@ -173,11 +204,27 @@ System::System(Version* ver)
         systemData.resetCounter++;
     }
 
+    // Data kept from firmware without failure record has random fields
+    if (systemData.failedInit != 0x55AA) {
+        systemData.failedInit = 0x55AA;
+        systemData.failedMark = 0;
+        systemData.failedName[0] = '\0';
+    }
+
     // Software version always updates.
     // It changes when software update for example
     version->getFirmwareVersion(systemData.firmware, versionStr);
 
     platformInit();
+
+    // Supervisor failure overrides platform reset reason
+    if (systemData.failedMark == 0x55AA) {
+        systemData.failedMark = 0;
+        for (int i = 0; i < kFailedNameSize; ++i)
+            failedModule_[i] = systemData.failedName[i];
+        failedModule_[kFailedNameSize - 1] = '\0';
+        setResetReason(kResetSupervisor);
+    }
 }
 
 /**
@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * @file    timerwheel.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Hashed wheel of software timers.
+ ******************************************************************************/
+
+#include "timerwheel.h"
+
+/**
+ * @brief Construct a new inactive SoftTimer object without callback
+ */
+SoftTimer::SoftTimer()
+    : prev_(nullptr)
+    , next_(nullptr)
+    , head_(nullptr)
+    , expiry_(0)
+    , period_(0)
+{
+}
+
+/**
+ * @brief Construct a new inactive SoftTimer object
+ *
+ * @param cb expiration callback
+ */
+SoftTimer::SoftTimer(const Delegate& cb)
+    : prev_(nullptr)
+    , next_(nullptr)
+    , head_(nullptr)
+    , expiry_(0)
+    , period_(0)
+    , cb_(cb)
+{
+}
+
+/**
+ * @brief Destroy the SoftTimer object with unlinking from wheel
+ */
+SoftTimer::~SoftTimer()
+{
+    unlink();
+}
+
+/**
+ * @brief Sets the callback for timer expiration
+ *
+ * @param cb callback delegate
+ */
+void SoftTimer::setDelegate(const Delegate& cb)
+{
+    cb_ = cb;
+}
+
+/**
+ * @brief Checks that timer is started and not expired yet
+ *
+ * @return true if active otherwise false
+ */
+bool SoftTimer::isActive() const
+{
+    return head_ != nullptr;
+}
+
+/**
+ * @brief Unlinks timer from current wheel list
+ */
+void SoftTimer::unlink()
+{
+    if (head_ == nullptr)
+        return;
+
+    if (prev_ != nullptr)
+        prev_->next_ = next_;
+    else
+        *head_ = next_;
+    if (next_ != nullptr)
+        next_->prev_ = prev_;
+
+    prev_ = nullptr;
+    next_ = nullptr;
+    head_ = nullptr;
+}
+
+/**
+ * @brief Construct a new empty TimerWheel object
+ */
+TimerWheel::TimerWheel()
+    : slots_ {}
+    , expired_(nullptr)
+    , tick_(0)
+    , last_(Time::now())
+{
+}
+
+/**
+ * @brief Starts or restarts timer. Complexity is O(1). Delay is counted from
+ *      current time, not from the last wheel tick, which lags it until the
+ *      next advance
+ *
+ * @param timer timer instance
+ * @param delay delay before the first expiration, rounded to at least one tick
+ * @param period period of next expirations, zero for one-shot timer
+ */
+void TimerWheel::start(SoftTimer& timer, const Time& delay, const Time& period)
+{
+    timer.unlink();
+
+    const int32_t lagMs = (Time::now() - last_).toMsec();
+    const int32_t delayMs = delay.toMsec();
+    const int32_t periodMs = period.toMsec();
+    timer.expiry_ = tick_ + (lagMs > 0 ? lagMs : 0) + (delayMs > 0 ? delayMs : 1);
+    timer.period_ = periodMs > 0 ? periodMs : 0;
+    link(&slots_[timer.expiry_ & (kSlots - 1)], timer);
+}
+
+/**
+ * @brief Stops timer without callback call. Complexity is O(1)
+ *
+ * @param timer timer instance
+ */
+void TimerWheel::stop(SoftTimer& timer)
+{
+    timer.unlink();
+}
+
+/**
+ * @brief Advances wheel by chosen count of ticks and calls callbacks of
+ *      expired timers. Can be called from SysTick IRQ with one tick
+ *
+ * @param ms ticks count in milliseconds
+ */
+void TimerWheel::advance(uint32_t ms)
+{
+    while (ms-- != 0) {
+        // Time of tick is kept for starts from callbacks of catch-up ticks
+        ++tick_;
+        last_ += 1;
+
+        // Slot holds timers of different wheel rounds, only expired are taken
+        SoftTimer* timer = slots_[tick_ & (kSlots - 1)];
+        while (timer != nullptr) {
+            SoftTimer* next = timer->next_;
+            if (static_cast<int32_t>(tick_ - timer->expiry_) >= 0) {
+                timer->unlink();
+                link(&expired_, *timer);
+            }
+            timer = next;
+        }
+        expire();
+    }
+}
+
+/**
+ * @brief Advances wheel by time elapsed since previous call. Must be called
+ *      periodically from module loop
+ */
+void TimerWheel::dispatcher()
+{
+    const Time now = Time::now();
+    const int32_t elapsedMs = (now - last_).toMsec();
+    if (elapsedMs <= 0)
+        return;
+
+    // Fraction of millisecond is kept for the next call, as advance() moves
+    // time of the last tick by whole milliseconds
+    advance(elapsedMs);
+}
+
+/**
+ * @brief Returns current wheel tick
+ *
+ * @return uint32_t ticks count in milliseconds
+ */
+uint32_t TimerWheel::tick() const
+{
+    return tick_;
+}
+
+/**
+ * @brief Links timer into the head of chosen list
+ *
+ * @param head list head
+ * @param timer timer instance
+ */
+void TimerWheel::link(SoftTimer** head, SoftTimer& timer)
+{
+    timer.prev_ = nullptr;
+    timer.next_ = *head;
+    timer.head_ = head;
+    if (*head != nullptr)
+        (*head)->prev_ = &timer;
+    *head = &timer;
+}
+
+/**
+ * @brief Calls callbacks of expired timers. Periodic timers are restarted
+ *      before callback call. Callback can stop other expired timer, so it
+ *      is unlinked from expired list one by one
+ */
+void TimerWheel::expire()
+{
+    while (expired_ != nullptr) {
+        SoftTimer& timer = *expired_;
+        timer.unlink();
+        if (timer.period_ != 0) {
+            timer.expiry_ += timer.period_;
+            link(&slots_[timer.expiry_ & (kSlots - 1)], timer);
+        }
+        timer.cb_.call_if();
+    }
+}
+
+/***************************** END OF FILE ************************************/
@@ -27,6 +27,20 @@ Time Time::now()
     return Time(0, tvNow.tv_sec, tvNow.tv_usec / 1000);
 }
 
+/**
+ * @brief Returns current system time from device start in microseconds.
+ *      Overflows every ~71 minutes, so it intended only for measurement of
+ *      short intervals by unsigned subtraction
+ *
+ * @return uint32_t current time in microseconds
+ */
+uint32_t Time::nowUs()
+{
+    struct timeval tvNow;
+    gettimeofday(&tvNow, NULL);
+    return static_cast<uint32_t>(tvNow.tv_sec) * 1000000U + tvNow.tv_usec;
+}
+
 /**
  * @brief Compares current time with start time mark and chosen delay.
  *
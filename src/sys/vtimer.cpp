@@ -0,0 +1,270 @@
+/*******************************************************************************
+ * @file    vtimer.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Virtual timers multiplexed on single hardware timer.
+ ******************************************************************************/
+
+#include "vtimer.h"
+
+/**
+ * @brief Construct a new inactive VTimer object without callback
+ */
+VTimer::VTimer()
+    : next_(nullptr)
+    , service_(nullptr)
+    , deadline_(0)
+    , period_(0)
+    , misses_(0)
+{
+}
+
+/**
+ * @brief Construct a new inactive VTimer object
+ *
+ * @param cb expiration callback
+ */
+VTimer::VTimer(const Delegate& cb)
+    : next_(nullptr)
+    , service_(nullptr)
+    , deadline_(0)
+    , period_(0)
+    , misses_(0)
+    , cb_(cb)
+{
+}
+
+/**
+ * @brief Destroy the VTimer object with stopping in service
+ */
+VTimer::~VTimer()
+{
+    if (service_ != nullptr)
+        service_->stop(*this);
+}
+
+/**
+ * @brief Sets the callback for timer expiration
+ *
+ * @param cb callback delegate
+ */
+void VTimer::setDelegate(const Delegate& cb)
+{
+    cb_ = cb;
+}
+
+/**
+ * @brief Checks that timer is started and not expired yet
+ *
+ * @return true if active otherwise false
+ */
+bool VTimer::isActive() const
+{
+    return service_ != nullptr;
+}
+
+/**
+ * @brief Construct a new VTimerService object without timers
+ */
+VTimerService::VTimerService()
+    : head_(nullptr)
+    , inAlarm_(false)
+{
+}
+
+/**
+ * @brief Starts or restarts timer. Complexity is O(n) of active timers
+ *
+ * @param timer timer instance
+ * @param delayUs delay before the first expiration in microseconds
+ * @param periodUs period of next expirations, zero for one-shot timer
+ */
+void VTimerService::start(VTimer& timer, uint32_t delayUs, uint32_t periodUs)
+{
+    lock();
+    if (timer.service_ == this)
+        unlink(timer);
+    timer.deadline_ = now() + delayUs;
+    timer.period_ = periodUs;
+    timer.misses_ = 0;
+    insert(timer);
+
+    // Alarm is changed only by new nearest deadline, callbacks of alarm
+    // leave it to the end of alarm processing
+    if (head_ == &timer && !inAlarm_)
+        rearm();
+    unlock();
+}
+
+/**
+ * @brief Stops timer without callback call. Alarm is left as is, so it may
+ *      happen once without expired timers
+ *
+ * @param timer timer instance
+ */
+void VTimerService::stop(VTimer& timer)
+{
+    lock();
+    if (timer.service_ == this)
+        unlink(timer);
+    unlock();
+}
+
+/**
+ * @brief Calls callbacks of expired timers and sets alarm to the next
+ *      deadline. Must be called from alarm IRQ of realization. Periodic
+ *      timers are restarted from their deadline before callback call, so
+ *      period doesn't drift with IRQ latency. Timer late for more than
+ *      VTIMER_MISSES_MAX periods in a row is restarted from current time
+ *      instead of catching up. Only timers expired before the call are
+ *      processed, so the call ends even when callback is longer than period
+ */
+void VTimerService::alarm()
+{
+    lock();
+    inAlarm_ = true;
+    const uint32_t start = now();
+    while (head_ != nullptr && static_cast<int32_t>(start - head_->deadline_) >= 0) {
+        VTimer& timer = *head_;
+        unlink(timer);
+        if (timer.period_ != 0) {
+            const uint32_t current = now();
+            timer.deadline_ += timer.period_;
+            if (static_cast<int32_t>(current - timer.deadline_) < 0) {
+                timer.misses_ = 0;
+            } else if (++timer.misses_ >= VTIMER_MISSES_MAX) {
+                timer.deadline_ = current + timer.period_;
+                timer.misses_ = 0;
+            }
+            insert(timer);
+        }
+
+        // Callback can start and stop timers, so list is unlocked
+        unlock();
+        timer.cb_.call_if();
+        lock();
+    }
+    inAlarm_ = false;
+    rearm();
+    unlock();
+}
+
+/**
+ * @brief Inserts timer into list after timers with the same or earlier
+ *      deadline
+ *
+ * @param timer timer instance
+ */
+void VTimerService::insert(VTimer& timer)
+{
+    VTimer** link = &head_;
+    while (*link != nullptr && static_cast<int32_t>(timer.deadline_ - (*link)->deadline_) >= 0) {
+        link = &(*link)->next_;
+    }
+    timer.next_ = *link;
+    timer.service_ = this;
+    *link = &timer;
+}
+
+/**
+ * @brief Unlinks timer from list
+ *
+ * @param timer timer instance
+ */
+void VTimerService::unlink(VTimer& timer)
+{
+    VTimer** link = &head_;
+    while (*link != nullptr && *link != &timer) {
+        link = &(*link)->next_;
+    }
+    if (*link != nullptr)
+        *link = timer.next_;
+
+    timer.next_ = nullptr;
+    timer.service_ = nullptr;
+}
+
+/**
+ * @brief Sets alarm to the nearest deadline or cancels it without timers
+ */
+void VTimerService::rearm()
+{
+    if (head_ == nullptr) {
+        cancelAlarm();
+        return;
+    }
+
+    const int32_t delay = static_cast<int32_t>(head_->deadline_ - now());
+    setAlarm(delay > 0 ? delay : 0);
+}
+
+/**
+ * @brief Construct a new VTimerSim object with zero time
+ *
+ * @param maxAlarmUs the longest alarm delay, like of hardware counter range
+ */
+VTimerSim::VTimerSim(uint32_t maxAlarmUs)
+    : maxAlarmUs_(maxAlarmUs)
+    , now_(0)
+    , alarmAt_(0)
+    , armed_(false)
+    , alarms_(0)
+{
+}
+
+/**
+ * @brief Returns simulated time
+ *
+ * @return uint32_t time in microseconds
+ */
+uint32_t VTimerSim::now()
+{
+    return now_;
+}
+
+/**
+ * @brief Moves simulated time and calls alarms at their exact time
+ *
+ * @param us time step in microseconds
+ */
+void VTimerSim::advance(uint32_t us)
+{
+    const uint32_t end = now_ + us;
+    while (armed_ && static_cast<int32_t>(end - alarmAt_) >= 0) {
+        now_ = alarmAt_;
+        armed_ = false;
+        ++alarms_;
+        alarm();
+    }
+    now_ = end;
+}
+
+/**
+ * @brief Returns count of happened alarms, i.e. hardware interrupts
+ *
+ * @return uint32_t alarms count
+ */
+uint32_t VTimerSim::alarms() const
+{
+    return alarms_;
+}
+
+void VTimerSim::setAlarm(uint32_t delayUs)
+{
+    alarmAt_ = now_ + (delayUs < maxAlarmUs_ ? delayUs : maxAlarmUs_);
+    armed_ = true;
+}
+
+void VTimerSim::cancelAlarm()
+{
+    armed_ = false;
+}
+
+void VTimerSim::lock()
+{
+}
+
+void VTimerSim::unlock()
+{
+}
+
+/***************************** END OF FILE ************************************/
@@ -0,0 +1,244 @@
+/*******************************************************************************
+ * @file    dmaring_test.cpp
+ * @author  garou (xgaroux@gmail.com)
+ * @brief   Host test of circular DMA buffer reader on simulated DMA channel.
+ ******************************************************************************/
+
+#include "periph/dmaring.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                                 \
+        }                                                               \
+    } while (0)
+
+/**
+ * @brief Reader like UART with DMA reception: updated on half and full
+ *      events from DMA IRQ and on line idle from UART IRQ
+ */
+class Reader {
+public:
+    Reader(DmaSim& dma, const uint8_t* buf, uint32_t size)
+        : dma_(dma)
+        , buf_(buf)
+        , ring_(size)
+    {
+        dma_.setDelegate(DmaSim::Delegate::create<Reader, &Reader::dmaHandler>(*this));
+    }
+
+    void restart(uint32_t size)
+    {
+        ring_.reset(size);
+    }
+
+    void idle()
+    {
+        update();
+    }
+
+    std::vector<uint8_t> data;
+    bool masked = false;    // DMA IRQ is late, e.g. by higher priority one
+    uint32_t wraps = 0;
+
+private:
+    void dmaHandler(uint32_t events)
+    {
+        if (!masked && (events & (DmaSim::kHalf | DmaSim::kFull)))
+            update();
+    }
+
+    void update()
+    {
+        DmaRing::Block first, second;
+        if (ring_.update(dma_.remaining(), first, second) == 0)
+            return;
+
+        data.insert(data.end(), &buf_[first.offset], &buf_[first.offset + first.len]);
+        if (second.len != 0) {
+            data.insert(data.end(), &buf_[second.offset], &buf_[second.offset + second.len]);
+            ++wraps;
+        }
+    }
+
+    DmaSim& dma_;
+    const uint8_t* buf_;
+    DmaRing ring_;
+};
+
+/**
+ * @brief Bursts of random length with idle after each are received in order
+ *      without losses, including bursts wrapped over buffer end
+ */
+static void testBursts()
+{
+    constexpr uint32_t kSize = 16;
+    uint8_t buf[kSize] = {};
+    DmaSim dma(buf, kSize);
+    Reader reader(dma, buf, kSize);
+
+    std::vector<uint8_t> sent;
+    srand(1);
+    for (int burst = 0; burst < 1000; ++burst) {
+        const uint32_t len = 1 + rand() % (kSize * 2);
+        for (uint32_t i = 0; i < len; ++i) {
+            const uint8_t byte = static_cast<uint8_t>(sent.size());
+            sent.push_back(byte);
+            dma.receive(&byte, 1);
+        }
+        reader.idle();
+    }
+    CHECK(reader.data == sent);
+}
+
+/**
+ * @brief Bursts shorter than buffer with late DMA events are taken by idle
+ *      only, so data wrapped over buffer end is read by two blocks
+ */
+static void testIdleWraps()
+{
+    constexpr uint32_t kSize = 16;
+    uint8_t buf[kSize] = {};
+    DmaSim dma(buf, kSize);
+    Reader reader(dma, buf, kSize);
+    reader.masked = true;
+
+    std::vector<uint8_t> sent;
+    srand(2);
+    for (int burst = 0; burst < 1000; ++burst) {
+        const uint32_t len = 1 + rand() % (kSize - 1);
+        for (uint32_t i = 0; i < len; ++i) {
+            const uint8_t byte = static_cast<uint8_t>(sent.size());
+            sent.push_back(byte);
+            dma.receive(&byte, 1);
+        }
+        reader.idle();
+    }
+    CHECK(reader.data == sent);
+    CHECK(reader.wraps > 0);
+}
+
+/**
+ * @brief Burst ending exactly at half and at buffer end, idle after them
+ *      finds no new data
+ */
+static void testEventBoundaries()
+{
+    constexpr uint32_t kSize = 8;
+    uint8_t buf[kSize] = {};
+    const uint8_t data[kSize] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    DmaSim dma(buf, kSize);
+    Reader reader(dma, buf, kSize);
+
+    dma.receive(data, kSize / 2);
+    CHECK(reader.data.size() == kSize / 2);
+    reader.idle();
+    CHECK(reader.data.size() == kSize / 2);
+
+    dma.receive(&data[kSize / 2], kSize / 2);
+    CHECK(reader.data.size() == kSize);
+    reader.idle();
+    CHECK(reader.data.size() == kSize);
+    CHECK(reader.data == std::vector<uint8_t>(data, data + kSize));
+}
+
+/**
+ * @brief Counter is read as zero before reload or as buffer size after it,
+ *      both mean position at buffer beginning
+ */
+static void testReloadCounter()
+{
+    DmaRing ring(8);
+    DmaRing::Block first, second;
+
+    CHECK(ring.update(3, first, second) == 5);
+    CHECK(first.offset == 0 && first.len == 5 && second.len == 0);
+
+    CHECK(ring.update(0, first, second) == 3);
+    CHECK(first.offset == 5 && first.len == 3 && second.len == 0);
+    CHECK(ring.pos() == 0);
+
+    CHECK(ring.update(8, first, second) == 0);
+
+    CHECK(ring.update(6, first, second) == 2);
+    CHECK(ring.update(4, first, second) == 2);
+    CHECK(ring.update(6, first, second) == 6);
+    CHECK(first.offset == 4 && first.len == 4);
+    CHECK(second.offset == 0 && second.len == 2);
+}
+
+/**
+ * @brief Restarted DMA writes from buffer beginning, so reader position is
+ *      reset with it
+ */
+static void testRestart()
+{
+    constexpr uint32_t kSize = 8;
+    uint8_t buf[kSize] = {};
+    const uint8_t data[] = { 1, 2, 3, 4, 5 };
+    DmaSim dma(buf, kSize);
+    Reader reader(dma, buf, kSize);
+
+    dma.receive(data, 3);
+    reader.idle();
+
+    DmaSim restarted(buf, kSize);
+    Reader next(restarted, buf, kSize);
+    next.restart(kSize);
+    restarted.receive(&data[3], 2);
+    next.idle();
+    CHECK(next.data == std::vector<uint8_t>({ 4, 5 }));
+}
+
+/**
+ * @brief Written count of capture ring is kept by events and counter, also
+ *      when full event is still pending after reload
+ */
+static void testWrittenCount()
+{
+    constexpr uint32_t kSize = 8;
+    uint8_t buf[kSize] = {};
+    DmaSim dma(buf, kSize);
+    uint32_t counted = 0;
+    uint32_t total = 0;
+
+    for (uint32_t i = 0; i < kSize * 5; ++i) {
+        const uint8_t byte = 0;
+        dma.receive(&byte, 1);
+        ++total;
+        const uint32_t remaining = dma.remaining();
+
+        // Pending event: counter is reloaded, count isn't updated yet
+        CHECK(DmaRing::written(counted, remaining, kSize) == total);
+        if (remaining == kSize / 2 || remaining == kSize)
+            counted += kSize / 2;
+        CHECK(DmaRing::written(counted, remaining, kSize) == total);
+    }
+    CHECK(DmaRing::written(kSize / 2, 0, kSize) == kSize);
+}
+
+int main()
+{
+    testBursts();
+    testIdleWraps();
+    testEventBoundaries();
+    testReloadCounter();
+    testRestart();
+    testWrittenCount();
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("All checks passed\n");
+    return EXIT_SUCCESS;
+}
+
+/***************************** END OF FILE ************************************/